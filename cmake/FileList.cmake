@@ -8,10 +8,12 @@ set(DUNEDYNASTY_SRC_FILES
 	src/audio/audio.c
 	src/audio/audio_a5.cpp
 	src/audio/mt32mpu.c
+	src/autosave.c
 	src/binheap.c
 	src/buildqueue.c
 	src/codec/format40.c
 	src/codec/format80.c
+	src/codec/lzblock.c
 	src/common_a5.c
 	src/config_a5.c
 	src/crashlog/crashlog_none.c
@@ -40,6 +42,7 @@ set(DUNEDYNASTY_SRC_FILES
 	src/mods/multiplayer.c
 	src/mods/skirmish.c
 	src/net/client.c
+	src/net/lockstep.c
 	src/net/message.c
 	src/net/net_enet.c
 	src/net/server.c
@@ -60,10 +63,13 @@ set(DUNEDYNASTY_SRC_FILES
 	src/object.c
 	src/opendune.c
 	src/os/endian.c
+	src/pathfinder.c
 	src/pool/pool_house.c
 	src/pool/pool_structure.c
 	src/pool/pool_team.c
 	src/pool/pool_unit.c
+	src/profile.c
+	src/replay.c
 	src/save.c
 	src/saveload/house.c
 	src/saveload/info.c
@@ -82,6 +88,7 @@ set(DUNEDYNASTY_SRC_FILES
 	src/script/team.c
 	src/script/unit.c
 	src/shape.c
+	src/snapshot.c
 	src/sprites.c
 	src/string.c
 	src/structure.c
@@ -115,6 +122,7 @@ set(DUNEDYNASTY_SRC_FILES
 	src/unit.c
 	src/video/prim_a5.c
 	src/video/video_a5.c
+	src/worldhash.c
 	src/wsa.c
 	)
 
@@ -158,6 +166,12 @@ else(WIN32)
 	${DUNEDYNASTY_SRC_FILES} src/crashlog/errorlog_std.c)
 endif(WIN32)
 
+# The headless simulator shares the game sources, but brings its own
+# main and replaces the Allegro timers with manually advanced ones.
+set(DUNEDYNASTY_SIM_SRC_FILES ${DUNEDYNASTY_SRC_FILES})
+list(REMOVE_ITEM DUNEDYNASTY_SIM_SRC_FILES src/timer/timer_a5.c)
+list(APPEND DUNEDYNASTY_SIM_SRC_FILES src/sim.c src/timer/timer_sim.c)
+
 set(OPENDUNE_UNUSED_SRC_FILES
 	src/audio/driver.c
 	src/audio/sound.c
@@ -37,6 +37,9 @@ enum {
 	CC_DDS3 = FOURCC('D','D','S','3'), /* Dune Dynasty Scenario 3 (stats). */
 	CC_DDU2 = FOURCC('D','D','U','2'), /* Dune Dynasty Unit 2. */
 	CC_DDS4 = FOURCC('D','D','S','4'), /* Dune Dynasty Scenario 4 (skirmish alliances). */
+	CC_DDZD = FOURCC('D','D','Z','D'), /* Dune Dynasty compressed chunk data. */
+	CC_DDZI = FOURCC('D','D','Z','I'), /* Dune Dynasty compressed chunk index. */
+	CC_DDZS = FOURCC('D','D','Z','S'), /* Dune Dynasty compressed savegame. */
 };
 
 #undef FOURCC
@@ -5,12 +5,15 @@
 
 #include <assert.h>
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 #include "os/math.h"
 
 #include "ai.h"
 
 #include "enhancement.h"
 #include "map.h"
+#include "net/lockstep.h"
 #include "pool/pool.h"
 #include "pool/pool_house.h"
 #include "pool/pool_structure.h"
@@ -74,6 +77,10 @@ typedef struct AISquad {
 	int64_t formation_timeout;
 } AISquad;
 
+typedef struct AISquadPool {
+	AISquad pool[SQUADID_MAX + 1];
+} AISquadPool;
+
 typedef struct AISquadPlan {
 	float distance1, angle1;
 	float distance2, angle2;
@@ -107,7 +114,25 @@ static Unit *UnitAI_SquadFindNext(PoolFindStruct *find, const AISquad *squad);
 bool
 AI_IsBrutalAI(enum HouseType houseID)
 {
-	return (enhancement_brutal_ai && !House_AreAllied(houseID, g_playerHouseID));
+	if (!enhancement_brutal_ai)
+		return false;
+
+	/* Every lockstep peer runs the AI, so do not depend on the local
+	 * player.  An AI opposing any human house is brutal.
+	 */
+	if (Lockstep_IsRunning()) {
+		if (House_IsHuman(houseID))
+			return false;
+
+		for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+			if (House_IsHuman(h) && !House_AreAllied(houseID, h))
+				return true;
+		}
+
+		return false;
+	}
+
+	return !House_AreAllied(houseID, g_playerHouseID);
 }
 
 /*--------------------------------------------------------------*/
@@ -415,9 +440,15 @@ UnitAI_GetAnyEnemyInRange(const Unit *unit)
 	const int dist = max(4, ui->fireDistance);
 	PoolFindStruct find;
 
-	for (const Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
-			u != NULL;
-			u = Unit_FindNext(&find)) {
+	/* Tile_GetDistanceRoundedUp(a, b) <= dist when
+	 * Tile_GetDistance(a, b) <= dist * 256 + 0x7F.
+	 */
+	Unit *candidate[UNIT_INDEX_MAX_RAISED];
+	const uint16 count = Unit_FindInRadius(unit->o.position, (dist << 8) + 0x7F, candidate);
+
+	for (uint16 i = 0; i < count; i++) {
+		const Unit *u = candidate[i];
+
 		if (u->o.type == UNIT_SANDWORM) {
 		} else if (House_AreAllied(houseID, Unit_GetHouseID(u))) {
 		} else if (!g_table_unitInfo[u->o.type].flags.isGroundUnit) {
@@ -994,10 +1025,10 @@ SaveLoad_BrutalAI_FormationTimeout(void *object, uint32 value, bool loading)
 }
 
 bool
-BrutalAI_Load(FILE *fp, uint32 length)
+BrutalAI_Load(SaveBuffer *sb, uint32 length)
 {
 	for (int i = 0; (i < SQUADID_MAX + 1) && (length > 0); i++) {
-		if (!SaveLoad_Load(s_saveBrutalAISquad, fp, &s_aisquad[i]))
+		if (!SaveLoad_Load(s_saveBrutalAISquad, sb, &s_aisquad[i]))
 			return false;
 
 		length -= SaveLoad_GetLength(s_saveBrutalAISquad);
@@ -1007,12 +1038,58 @@ BrutalAI_Load(FILE *fp, uint32 length)
 }
 
 bool
-BrutalAI_Save(FILE *fp)
+BrutalAI_Save(SaveBuffer *sb)
 {
 	for (int i = 0; i < SQUADID_MAX + 1; i++) {
-		if (!SaveLoad_Save(s_saveBrutalAISquad, fp, &s_aisquad[i]))
+		if (!SaveLoad_Save(s_saveBrutalAISquad, sb, &s_aisquad[i]))
 			return false;
 	}
 
 	return true;
 }
+
+/*--------------------------------------------------------------*/
+
+/**
+ * Allocate an AISquadPool for a world snapshot.
+ */
+AISquadPool *
+AISquadPool_Alloc(void)
+{
+	AISquadPool *pool = calloc(1, sizeof(*pool));
+	assert(pool != NULL);
+
+	return pool;
+}
+
+void
+AISquadPool_Free(AISquadPool *pool)
+{
+	free(pool);
+}
+
+void
+AISquadPool_SaveTo(AISquadPool *pool)
+{
+	memcpy(pool->pool, s_aisquad, sizeof(s_aisquad));
+}
+
+/**
+ * Restore the squads from a world snapshot, delaying their timeouts by
+ *  dt ticks to account for the time passed since it was taken.
+ */
+void
+AISquadPool_LoadFrom(const AISquadPool *pool, int64_t dt)
+{
+	memcpy(s_aisquad, pool->pool, sizeof(s_aisquad));
+
+	for (int i = 0; i < SQUADID_MAX + 1; i++) {
+		AISquad *squad = &s_aisquad[i];
+
+		if (squad->recruitment_timeout != 0)
+			squad->recruitment_timeout += dt;
+
+		if (squad->formation_timeout != 0)
+			squad->formation_timeout += dt;
+	}
+}
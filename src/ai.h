@@ -1,11 +1,14 @@
 #ifndef BRUTAL_AI_H
 #define BRUTAL_AI_H
 
-#include <stdio.h>
+#include <inttypes.h>
 #include "house.h"
 #include "structure.h"
 #include "unit.h"
 
+struct AISquadPool;
+struct SaveBuffer;
+
 extern bool AI_IsBrutalAI(enum HouseType houseID);
 
 extern uint16 StructureAI_PickNextToBuild(const Structure *s);
@@ -20,7 +23,12 @@ extern void UnitAI_AbortMission(Unit *unit, uint16 enemy);
 extern uint16 UnitAI_GetSquadDestination(Unit *unit, uint16 destination);
 extern void UnitAI_SquadLoop(void);
 
-extern bool BrutalAI_Load(FILE *fp, uint32 length);
-extern bool BrutalAI_Save(FILE *fp);
+extern bool BrutalAI_Load(struct SaveBuffer *sb, uint32 length);
+extern bool BrutalAI_Save(struct SaveBuffer *sb);
+
+extern struct AISquadPool *AISquadPool_Alloc(void);
+extern void AISquadPool_Free(struct AISquadPool *pool);
+extern void AISquadPool_SaveTo(struct AISquadPool *pool);
+extern void AISquadPool_LoadFrom(const struct AISquadPool *pool, int64_t dt);
 
 #endif
@@ -49,6 +49,8 @@ static void Animation_Func_Stop(Animation *animation, int16 parameter)
 		uint16 position = packed + (*layout++);
 		Tile *t = &g_map[position];
 
+		Map_MarkDirty(position);
+
 		if (animation->tileLayout != 0) {
 			t->groundSpriteID = g_mapSpriteID[position];
 		}
@@ -96,6 +98,7 @@ static void Animation_Func_SetOverlaySprite(Animation *animation, int16 paramete
 	assert(parameter >= 0);
 
 	Tile *t = &g_map[packed];
+	Map_MarkDirty(packed);
 	t->overlaySpriteID = g_iconMap[g_iconMap[animation->iconGroup] + parameter];
 	t->houseID = animation->houseID;
 }
@@ -146,6 +149,7 @@ static void Animation_Func_SetGroundSprite(Animation *animation, int16 parameter
 		Tile *t = &g_map[position];
 
 		if (t->groundSpriteID == spriteID) continue;
+		Map_MarkDirty(position);
 		t->groundSpriteID = spriteID;
 		t->overlaySpriteID = 0;
 		t->houseID = animation->houseID;
@@ -197,6 +201,31 @@ Animation_Uninit(void)
 	BinHeap_Free(&s_animations);
 }
 
+/**
+ * Copy the active animations into a world snapshot.
+ */
+void
+Animation_SaveTo(BinHeap *heap)
+{
+	BinHeap_Copy(heap, &s_animations);
+}
+
+/**
+ * Restore the active animations from a world snapshot, delaying them by dt
+ *  ticks to account for the time passed since it was taken.
+ */
+void
+Animation_LoadFrom(const BinHeap *heap, int64_t dt)
+{
+	BinHeap_Copy(&s_animations, heap);
+
+	for (int i = 1; i < s_animations.num_elem; i++) {
+		Animation *animation = (Animation *)BinHeap_GetElem(&s_animations, i);
+
+		animation->tickNext += dt;
+	}
+}
+
 /**
  * Start an Animation.
  * @param commands List of commands for the Animation.
@@ -219,6 +248,7 @@ void Animation_Start(const AnimationCommandStruct *commands, tile32 tile, uint16
 		animation->commands   = commands;
 		animation->tile       = tile;
 
+		Map_MarkDirty(packed);
 		g_map[packed].houseID = houseID;
 		g_map[packed].hasAnimation = true;
 	}
@@ -3,6 +3,8 @@
 #ifndef ANIMATE_H
 #define ANIMATE_H
 
+#include <inttypes.h>
+
 /**
  * The valid types for command in AnimationCommandStruct.
  */
@@ -26,6 +28,8 @@ typedef struct AnimationCommandStruct {
 	int16 parameter;                                        /*!< The parameter for this command. */
 } AnimationCommandStruct;
 
+struct BinHeap;
+
 extern const AnimationCommandStruct g_table_animation_unitMove[8][8];
 extern const AnimationCommandStruct g_table_animation_unitScript1[4][8];
 extern const AnimationCommandStruct g_table_animation_unitScript2[4][8];
@@ -34,6 +38,8 @@ extern const AnimationCommandStruct g_table_animation_structure[29][16];
 
 extern void Animation_Init(void);
 extern void Animation_Uninit(void);
+extern void Animation_SaveTo(struct BinHeap *heap);
+extern void Animation_LoadFrom(const struct BinHeap *heap, int64_t dt);
 extern void Animation_Start(const AnimationCommandStruct *commands, tile32 tile, uint16 tileLayout, uint8 houseID, uint8 iconGroup);
 extern void Animation_Stop_ByTile(uint16 packed);
 extern void Animation_Tick(void);
@@ -359,7 +359,7 @@ Audio_IsPositionAudible(uint16 packed)
 			&& (g_host_type == HOSTTYPE_CLIENT_SERVER
 			 || g_host_type == HOSTTYPE_DEDICATED_CLIENT)) {
 		return Map_IsUnveiledToHouse(g_playerHouseID, packed)
-			&& (g_mapVisible[packed].timeout[g_playerHouseID] > g_timerGame);
+			&& !Map_HasFogTimedOut(g_playerHouseID, packed);
 	}
 
 	return true;
@@ -0,0 +1,276 @@
+/**
+ * @file src/autosave.c
+ *
+ * Periodic autosave of single player games.  The savegame is built in
+ * memory on the game thread, which is a single pass over the pools, and
+ * a worker thread writes it to disk, so a slow disk or a network home
+ * directory does not stall the game.  Autosaves rotate through the
+ * files _AUTO001.DAT to _AUTOnnn.DAT, replacing the oldest one.
+ */
+
+#include <allegro5/allegro.h>
+#include <stdio.h>
+#include <time.h>
+#include "errorlog.h"
+#include "os/math.h"
+
+#include "autosave.h"
+
+#include "file.h"
+#include "save.h"
+#include "saveload/saveload.h"
+#include "timer/timer.h"
+
+typedef struct AutosaveJob {
+	SaveBuffer sb;
+	char dirname[1024];
+	int slots;
+} AutosaveJob;
+
+int g_autosave_interval = 5;            /*!< Minutes between autosaves, or 0 to disable them. */
+int g_autosave_slots = 3;               /*!< Number of autosave files to rotate through. */
+
+static ALLEGRO_THREAD *s_thread;
+static ALLEGRO_MUTEX *s_mutex;
+static ALLEGRO_COND *s_cond;
+static AutosaveJob s_job;               /*!< Owned by the worker while s_pending is set. */
+static bool s_pending;
+static int s_slot = -1;                 /*!< Slot last written by the worker, or -1. */
+static int64_t s_timerNext;
+
+/*--------------------------------------------------------------*/
+
+/**
+ * @return False if the filename does not fit in the buffer.
+ */
+static bool
+Autosave_MakeFilename(char *buf, size_t len, const char *dirname, int slot)
+{
+	const int n = snprintf(buf, len, "%s_AUTO%03d.DAT", dirname, slot + 1);
+
+	return (0 <= n && (size_t)n < len);
+}
+
+/**
+ * Find a free slot, or the slot with the oldest autosave.  Only used
+ *  for the first autosave of the session; after that the slots are
+ *  used in turn.
+ */
+static int
+Autosave_FindOldestSlot(const char *dirname, int slots)
+{
+	char filename[1024];
+	time_t oldest = 0;
+	int slot = 0;
+
+	for (int i = 0; i < slots; i++) {
+		if (!Autosave_MakeFilename(filename, sizeof(filename), dirname, i))
+			return i;
+
+		ALLEGRO_FS_ENTRY *e = al_create_fs_entry(filename);
+		if (e == NULL)
+			return i;
+
+		const bool exists = al_fs_entry_exists(e);
+		const time_t mtime = al_get_fs_entry_mtime(e);
+		al_destroy_fs_entry(e);
+
+		if (!exists)
+			return i;
+
+		if (i == 0 || mtime < oldest) {
+			oldest = mtime;
+			slot = i;
+		}
+	}
+
+	return slot;
+}
+
+static void
+Autosave_Write(const AutosaveJob *job)
+{
+	char filename[1024];
+
+	if (!al_make_directory(job->dirname)) {
+		Error("Failed to create directory '%s'.\n", job->dirname);
+		return;
+	}
+
+	if (s_slot < 0 || s_slot >= job->slots) {
+		s_slot = Autosave_FindOldestSlot(job->dirname, job->slots);
+	} else {
+		s_slot = (s_slot + 1) % job->slots;
+	}
+
+	if (!Autosave_MakeFilename(filename, sizeof(filename), job->dirname, s_slot)) {
+		Error("Autosave path too long in '%s'.\n", job->dirname);
+		return;
+	}
+
+	FILE *fp = fopen(filename, "wb");
+	if (fp == NULL) {
+		Error("Failed to open file '%s' for writing.\n", filename);
+		return;
+	}
+
+	bool res = SaveBuffer_WriteFile(&job->sb, fp);
+	res = (fclose(fp) == 0) && res;
+
+	if (!res)
+		Error("Error while writing autosave '%s'.\n", filename);
+}
+
+static void *
+Autosave_ThreadProc(ALLEGRO_THREAD *thread, void *arg)
+{
+	(void)arg;
+
+	al_lock_mutex(s_mutex);
+
+	for (;;) {
+		while (!s_pending && !al_get_thread_should_stop(thread))
+			al_wait_cond(s_cond, s_mutex);
+
+		/* Finish a pending write before stopping. */
+		if (!s_pending)
+			break;
+
+		al_unlock_mutex(s_mutex);
+		Autosave_Write(&s_job);
+		SaveBuffer_Free(&s_job.sb);
+		al_lock_mutex(s_mutex);
+
+		s_pending = false;
+	}
+
+	al_unlock_mutex(s_mutex);
+	return NULL;
+}
+
+static bool
+Autosave_StartThread(void)
+{
+	if (s_thread != NULL)
+		return true;
+
+	s_mutex = al_create_mutex();
+	s_cond = al_create_cond();
+	if (s_mutex != NULL && s_cond != NULL)
+		s_thread = al_create_thread(Autosave_ThreadProc, NULL);
+
+	if (s_thread == NULL) {
+		if (s_cond != NULL)
+			al_destroy_cond(s_cond);
+
+		if (s_mutex != NULL)
+			al_destroy_mutex(s_mutex);
+
+		s_cond = NULL;
+		s_mutex = NULL;
+		return false;
+	}
+
+	al_start_thread(s_thread);
+	return true;
+}
+
+/**
+ * Build the savegame and hand it to the worker.  If the previous
+ *  autosave is still being written, this one is skipped.
+ */
+static void
+Autosave_Start(void)
+{
+	char description[51];
+
+	if (!Autosave_StartThread()) {
+		Error("Failed to start the autosave thread.\n");
+		return;
+	}
+
+	al_lock_mutex(s_mutex);
+	const bool busy = s_pending;
+	al_unlock_mutex(s_mutex);
+
+	if (busy)
+		return;
+
+	const int64_t seconds = (g_timerGame - g_tickScenarioStart) / 60;
+	snprintf(description, sizeof(description), "Autosave %d:%02d:%02d",
+			(int)(seconds / 3600), (int)(seconds / 60 % 60), (int)(seconds % 60));
+
+	SaveBuffer_Init(&s_job.sb);
+	if (!SaveFile_ToBuffer(&s_job.sb, description)) {
+		SaveBuffer_Free(&s_job.sb);
+		Error("Error while building autosave.\n");
+		return;
+	}
+
+	File_MakeCompleteFilename(s_job.dirname, sizeof(s_job.dirname), SEARCHDIR_PERSONAL_DATA_DIR, "", false);
+	s_job.slots = clamp(1, g_autosave_slots, AUTOSAVE_SLOTS_MAX);
+
+	al_lock_mutex(s_mutex);
+	s_pending = true;
+	al_signal_cond(s_cond);
+	al_unlock_mutex(s_mutex);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+ * Restart the autosave interval, for a new or loaded game.
+ */
+void
+Autosave_Reset(void)
+{
+	s_timerNext = 0;
+}
+
+/**
+ * Autosave once g_autosave_interval minutes of game time have passed.
+ *  Should only be called in single player games.
+ */
+void
+Autosave_Tick(void)
+{
+	if (g_autosave_interval <= 0)
+		return;
+
+	const int64_t interval = (int64_t)g_autosave_interval * 60 * 60;
+
+	if (s_timerNext == 0 || s_timerNext > g_timerGame + interval) {
+		s_timerNext = g_timerGame + interval;
+		return;
+	}
+
+	if (g_timerGame < s_timerNext)
+		return;
+
+	s_timerNext = g_timerGame + interval;
+	Autosave_Start();
+}
+
+/**
+ * Wait for a pending autosave to be written and stop the worker.
+ */
+void
+Autosave_Uninit(void)
+{
+	if (s_thread == NULL)
+		return;
+
+	al_lock_mutex(s_mutex);
+	al_set_thread_should_stop(s_thread);
+	al_broadcast_cond(s_cond);
+	al_unlock_mutex(s_mutex);
+
+	al_join_thread(s_thread, NULL);
+	al_destroy_thread(s_thread);
+	al_destroy_cond(s_cond);
+	al_destroy_mutex(s_mutex);
+
+	s_thread = NULL;
+	s_cond = NULL;
+	s_mutex = NULL;
+}
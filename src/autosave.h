@@ -0,0 +1,17 @@
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include <stdbool.h>
+
+enum {
+	AUTOSAVE_SLOTS_MAX = 16
+};
+
+extern int g_autosave_interval;
+extern int g_autosave_slots;
+
+extern void Autosave_Reset(void);
+extern void Autosave_Tick(void);
+extern void Autosave_Uninit(void);
+
+#endif
@@ -36,6 +36,27 @@ BinHeap_Free(BinHeap *heap)
 	heap->elem = NULL;
 }
 
+void
+BinHeap_Copy(BinHeap *dst, const BinHeap *src)
+{
+	if (src->elem == NULL) {
+		BinHeap_Free(dst);
+		return;
+	}
+
+	if ((dst->elem == NULL) || (dst->elem_size != src->elem_size) || (dst->max_elem < src->num_elem)) {
+		free(dst->elem);
+		dst->elem = malloc(src->max_elem * src->elem_size);
+		assert(dst->elem != NULL);
+
+		dst->max_elem = src->max_elem;
+		dst->elem_size = src->elem_size;
+	}
+
+	dst->num_elem = src->num_elem;
+	memcpy(dst->elem, src->elem, src->num_elem * src->elem_size);
+}
+
 bool
 BinHeap_Resize(BinHeap *heap, int new_size)
 {
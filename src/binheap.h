@@ -18,6 +18,7 @@ typedef struct BinHeap {
 
 extern void BinHeap_Init(BinHeap *heap, size_t elem_size);
 extern void BinHeap_Free(BinHeap *heap);
+extern void BinHeap_Copy(BinHeap *dst, const BinHeap *src);
 extern bool BinHeap_Resize(BinHeap *heap, int new_size);
 extern BinHeapElem *BinHeap_GetElem(BinHeap *heap, int i);
 
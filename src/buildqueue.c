@@ -44,6 +44,31 @@ BuildQueue_AllocItem(uint16 objectType, int credits)
 	return e;
 }
 
+/**
+ * Copies the items of src into dst, which must not own any items.
+ */
+void
+BuildQueue_Copy(BuildQueue *dst, const BuildQueue *src)
+{
+	BuildQueue_Init(dst);
+
+	for (const BuildQueueItem *e = src->first; e != NULL; e = e->next) {
+		BuildQueueItem *c = BuildQueue_AllocItem(e->objectType, e->credits);
+
+		if (dst->first == NULL)
+			dst->first = c;
+
+		if (dst->last != NULL) {
+			dst->last->next = c;
+			c->prev = dst->last;
+		}
+
+		dst->last = c;
+	}
+
+	memcpy(dst->count, src->count, sizeof(dst->count));
+}
+
 void
 BuildQueue_Add(BuildQueue *queue, uint16 objectType, int credits)
 {
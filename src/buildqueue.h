@@ -29,6 +29,7 @@ typedef struct BuildQueue {
 
 extern void BuildQueue_Init(BuildQueue *queue);
 extern void BuildQueue_Free(BuildQueue *queue);
+extern void BuildQueue_Copy(BuildQueue *dst, const BuildQueue *src);
 
 extern void BuildQueue_Add(BuildQueue *queue, uint16 objectType, int credits);
 extern uint16 BuildQueue_RemoveHead(BuildQueue *queue);
@@ -0,0 +1,213 @@
+/**
+ * @file src/codec/lzblock.c
+ *
+ * Encoder and decoder for 'lzblock', a byte-oriented LZ77 block format
+ * in the style of LZ4, used to compress savegame chunks.
+ *
+ * A block is a list of sequences.  Each sequence starts with a token
+ * whose high nibble is the number of literals and whose low nibble is
+ * the match length minus 4.  A nibble of 15 is followed by extra
+ * length bytes, added up until a byte other than 255.  Then come the
+ * literals, a 16-bit little-endian match offset, and the match, which
+ * may overlap the bytes it produces.  The last sequence ends the block
+ * after its literals and has no match.
+ */
+
+#include <string.h>
+#include "types.h"
+#include "../os/math.h"
+
+#include "lzblock.h"
+
+enum {
+	LZBLOCK_HASH_BITS = 12,
+	LZBLOCK_MIN_MATCH = 4,
+	LZBLOCK_MAX_OFFSET = 0xFFFF
+};
+
+static uint32
+LZBlock_Hash(const uint8 *p)
+{
+	const uint32 v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32)p[3] << 24);
+
+	return (v * 2654435761U) >> (32 - LZBLOCK_HASH_BITS);
+}
+
+static bool
+LZBlock_WriteLength(uint8 *dest, uint32 destLength, uint32 *out, uint32 length)
+{
+	for (;;) {
+		if (*out >= destLength)
+			return false;
+
+		const uint8 b = min(length, 255);
+		dest[(*out)++] = b;
+		length -= b;
+
+		if (b != 255)
+			return true;
+	}
+}
+
+static bool
+LZBlock_WriteSequence(uint8 *dest, uint32 destLength, uint32 *out,
+		const uint8 *literals, uint32 literalLength, uint32 offset, uint32 matchLength)
+{
+	const uint32 extra = (matchLength == 0) ? 0 : matchLength - LZBLOCK_MIN_MATCH;
+
+	if (*out >= destLength)
+		return false;
+
+	dest[(*out)++] = (min(literalLength, 15) << 4) | min(extra, 15);
+
+	if (literalLength >= 15 && !LZBlock_WriteLength(dest, destLength, out, literalLength - 15))
+		return false;
+
+	if (literalLength > destLength - *out)
+		return false;
+
+	memcpy(dest + *out, literals, literalLength);
+	*out += literalLength;
+
+	if (matchLength == 0)
+		return true;
+
+	if (destLength - *out < 2)
+		return false;
+
+	dest[(*out)++] = offset & 0xFF;
+	dest[(*out)++] = offset >> 8;
+
+	if (extra >= 15 && !LZBlock_WriteLength(dest, destLength, out, extra - 15))
+		return false;
+
+	return true;
+}
+
+/**
+ * Compress a memory fragment with 'lzblock'.
+ * @param dest The place the encoded fragment will be stored.
+ * @param destLength The length of the destination buffer.
+ * @param source The fragment to encode.
+ * @param sourceLength The length of the fragment.
+ * @return The length of the encoded data, or 0 if it does not fit in
+ *  the destination buffer.
+ */
+uint32
+LZBlock_Encode(uint8 *dest, uint32 destLength, const uint8 *source, uint32 sourceLength)
+{
+	uint32 table[1 << LZBLOCK_HASH_BITS];
+	uint32 anchor = 0;
+	uint32 pos = 0;
+	uint32 out = 0;
+
+	memset(table, 0, sizeof(table));
+
+	while (sourceLength - pos >= LZBLOCK_MIN_MATCH) {
+		const uint32 hash = LZBlock_Hash(source + pos);
+		const uint32 candidate = table[hash];
+		table[hash] = pos;
+
+		if (candidate >= pos
+				|| pos - candidate > LZBLOCK_MAX_OFFSET
+				|| memcmp(source + candidate, source + pos, LZBLOCK_MIN_MATCH) != 0) {
+			pos++;
+			continue;
+		}
+
+		uint32 length = LZBLOCK_MIN_MATCH;
+		while (pos + length < sourceLength && source[candidate + length] == source[pos + length])
+			length++;
+
+		if (!LZBlock_WriteSequence(dest, destLength, &out, source + anchor, pos - anchor, pos - candidate, length))
+			return 0;
+
+		pos += length;
+		anchor = pos;
+	}
+
+	if (!LZBlock_WriteSequence(dest, destLength, &out, source + anchor, sourceLength - anchor, 0, 0))
+		return 0;
+
+	return out;
+}
+
+static bool
+LZBlock_ReadLength(const uint8 *source, uint32 sourceLength, uint32 *in, uint32 *length, uint32 limit)
+{
+	if (*length != 15)
+		return true;
+
+	for (;;) {
+		if (*in >= sourceLength || *length > limit)
+			return false;
+
+		const uint8 b = source[(*in)++];
+		*length += b;
+
+		if (b != 255)
+			return true;
+	}
+}
+
+/**
+ * Decode a memory fragment which is encoded with 'lzblock'.  Corrupt
+ *  input is rejected rather than read or written out of bounds.
+ * @param dest The place the decoded fragment will be stored.
+ * @param destLength The exact length of the decoded fragment.
+ * @param source The encoded fragment.
+ * @param sourceLength The length of the encoded fragment.
+ * @return True if and only if the fragment decoded to destLength bytes.
+ */
+bool
+LZBlock_Decode(uint8 *dest, uint32 destLength, const uint8 *source, uint32 sourceLength)
+{
+	uint32 in = 0;
+	uint32 out = 0;
+
+	while (in < sourceLength) {
+		const uint8 token = source[in++];
+		uint32 length;
+
+		/* Literals */
+		length = token >> 4;
+		if (!LZBlock_ReadLength(source, sourceLength, &in, &length, destLength))
+			return false;
+
+		if (length > sourceLength - in || length > destLength - out)
+			return false;
+
+		memcpy(dest + out, source + in, length);
+		in += length;
+		out += length;
+
+		if (in == sourceLength)
+			break;
+
+		/* Match */
+		if (sourceLength - in < 2)
+			return false;
+
+		const uint32 offset = source[in] | (source[in + 1] << 8);
+		in += 2;
+
+		if (offset == 0 || offset > out)
+			return false;
+
+		length = token & 0xF;
+		if (!LZBlock_ReadLength(source, sourceLength, &in, &length, destLength))
+			return false;
+
+		length += LZBLOCK_MIN_MATCH;
+		if (length > destLength - out)
+			return false;
+
+		/* The match may overlap the bytes it produces, so copy byte by byte. */
+		for (; length > 0; length--) {
+			dest[out] = dest[out - offset];
+			out++;
+		}
+	}
+
+	return (out == destLength);
+}
@@ -0,0 +1,9 @@
+/** @file src/codec/lzblock.h Function signatures for 'lzblock' compression. */
+
+#ifndef CODEC_LZBLOCK_H
+#define CODEC_LZBLOCK_H
+
+extern uint32 LZBlock_Encode(uint8 *dest, uint32 destLength, const uint8 *source, uint32 sourceLength);
+extern bool LZBlock_Decode(uint8 *dest, uint32 destLength, const uint8 *source, uint32 sourceLength);
+
+#endif /* CODEC_LZBLOCK_H */
@@ -12,11 +12,14 @@
 #include "config.h"
 
 #include "audio/audio.h"
+#include "autosave.h"
 #include "enhancement.h"
 #include "file.h"
 #include "gfx.h"
 #include "net/net.h"
 #include "opendune.h"
+#include "replay.h"
+#include "save.h"
 #include "scenario.h"
 #include "string.h"
 #include "table/locale.h"
@@ -105,6 +108,10 @@ static const GameOption s_game_option[] = {
 	{ "game",   "game_speed",       CONFIG_INT_0_4, .d._int = &g_gameConfig.gameSpeed },
 	{ "game",   "hints",            CONFIG_BOOL,    .d._bool = &g_gameConfig.hints },
 	{ "game",   "campaign",         CONFIG_CAMPAIGN,.d._int = &g_campaign_selected },
+	{ "game",   "record_replay",    CONFIG_BOOL,    .d._bool = &g_replay_record },
+	{ "game",   "autosave_interval",CONFIG_INT,     .d._int = &g_autosave_interval },
+	{ "game",   "autosave_slots",   CONFIG_INT_1_16,.d._int = &g_autosave_slots },
+	{ "game",   "compress_savegames",CONFIG_BOOL,   .d._bool = &g_savegame_compress },
 
 	{ "graphics",   "driver",           CONFIG_GRAPHICS_DRIVER, .d._graphics_driver = &g_graphics_driver },
 	{ "graphics",   "window_mode",      CONFIG_WINDOW_MODE,     .d._window_mode = &g_gameConfig.windowMode },
@@ -158,6 +165,8 @@ static const GameOption s_game_option[] = {
 	{ "music",  "dune_part_two_ost", 	CONFIG_BOOL,    .d._bool = &g_table_music_set[MUSICSET_DUNE_PART_TWO_OST].enable },
 	{ "music",  "default",          	CONFIG_MUSIC_PACK,  .d._music_set = &default_music_pack },
 
+	{ "enhancement",    "astar_pathfinder",         CONFIG_BOOL,.d._bool = &enhancement_astar_pathfinder },
+	{ "enhancement",    "astar_pathfinder_budget",  CONFIG_INT, .d._int = &enhancement_astar_pathfinder_budget },
 	{ "enhancement",    "brutal_ai",                CONFIG_BOOL,.d._bool = &enhancement_brutal_ai },
 	{ "enhancement",    "fog_of_war",               CONFIG_BOOL,.d._bool = &enhancement_fog_of_war },
 	{ "enhancement",    "health_bars",              CONFIG_HEALTH_BAR,  .d._health_bar = &enhancement_draw_health_bars },
@@ -181,6 +190,8 @@ static const GameOption s_game_option[] = {
 	{ "multiplayer",    "host_port",    CONFIG_STRING_PORT, .d._string = g_host_port },
 	{ "multiplayer",    "join_address", CONFIG_STRING,      .d._string = g_join_addr },
 	{ "multiplayer",    "join_port",    CONFIG_STRING_PORT, .d._string = g_join_port },
+	{ "multiplayer",    "compression",  CONFIG_BOOL,        .d._bool = &g_net_compression },
+	{ "multiplayer",    "lockstep",     CONFIG_BOOL,        .d._bool = &g_net_lockstep },
 
 	{ NULL, NULL, CONFIG_BOOL, .d._bool = NULL }
 };
@@ -17,6 +17,19 @@ bool const g_dune2_enhanced = true;
  */
 bool enhancement_ai_respects_structure_placement = true;
 
+/**
+ * Dune II's pathfinder walks straight towards the destination and
+ * follows obstacles for a short distance, so units often get stuck
+ * behind walls and cliffs.  Use an A* search instead.
+ */
+bool enhancement_astar_pathfinder = false;
+
+/**
+ * With the A* pathfinder, the number of nodes searched per game tick.
+ * Units wait for their route when the budget has been spent.
+ */
+int enhancement_astar_pathfinder_budget = 4096;
+
 /**
  * Various AI changes to make the game tougher.  Includes double
  * production rate, half cost, flanking attacks, etc.
@@ -47,6 +47,8 @@ extern bool const enhancement_fix_selection_after_entering_structure;
 extern bool const enhancement_fix_typos;
 
 extern bool enhancement_ai_respects_structure_placement;
+extern bool enhancement_astar_pathfinder;
+extern int enhancement_astar_pathfinder_budget;
 extern bool enhancement_brutal_ai;
 extern bool enhancement_construction_does_not_pause;
 extern enum HealthBarMode enhancement_draw_health_bars;
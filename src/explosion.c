@@ -54,6 +54,7 @@ static void Explosion_Func_TileDamage(Explosion *e, uint16 parameter)
 	if (type == LST_STRUCTURE || type == LST_DESTROYED_WALL) return;
 
 	t = &g_map[packed];
+	Map_MarkDirty(packed);
 
 	if (type == LST_CONCRETE_SLAB) {
 		t->groundSpriteID = g_mapSpriteID[packed];
@@ -232,6 +233,31 @@ Explosion_Uninit(void)
 	BinHeap_Free(&s_explosions);
 }
 
+/**
+ * Copy the active explosions into a world snapshot.
+ */
+void
+Explosion_SaveTo(BinHeap *heap)
+{
+	BinHeap_Copy(heap, &s_explosions);
+}
+
+/**
+ * Restore the active explosions from a world snapshot, delaying them by dt
+ *  ticks to account for the time passed since it was taken.
+ */
+void
+Explosion_LoadFrom(const BinHeap *heap, int64_t dt)
+{
+	BinHeap_Copy(&s_explosions, heap);
+
+	for (int i = 1; i < s_explosions.num_elem; i++) {
+		Explosion *e = (Explosion *)BinHeap_GetElem(&s_explosions, i);
+
+		e->timeOut += dt;
+	}
+}
+
 /**
  * Start a Explosion on a tile.
  * @param explosionType Type of Explosion.
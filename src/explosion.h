@@ -60,6 +60,8 @@ typedef struct ExplosionCommandStruct {
 	uint16 parameter;                                       /*!< The parameter of the Explosion. */
 } ExplosionCommandStruct;
 
+struct BinHeap;
+
 typedef struct Explosion {
 	/* Heap key. */
 	int64_t timeOut;                        /*!< Time out for the next command. */
@@ -73,6 +75,8 @@ typedef struct Explosion {
 
 extern void Explosion_Init(void);
 extern void Explosion_Uninit(void);
+extern void Explosion_SaveTo(struct BinHeap *heap);
+extern void Explosion_LoadFrom(const struct BinHeap *heap, int64_t dt);
 extern void Explosion_Start(uint16 explosionType, tile32 position, uint8 houseID);
 extern void Explosion_Tick(void);
 extern void Explosion_Draw(void);
@@ -11,6 +11,7 @@
 #include "ai.h"
 #include "animation.h"
 #include "audio/audio.h"
+#include "autosave.h"
 #include "common_a5.h"
 #include "config.h"
 #include "enhancement.h"
@@ -21,6 +22,7 @@
 #include "input/mouse.h"
 #include "map.h"
 #include "net/client.h"
+#include "net/lockstep.h"
 #include "net/net.h"
 #include "net/server.h"
 #include "newui/actionpanel.h"
@@ -29,9 +31,13 @@
 #include "newui/menubar.h"
 #include "newui/viewport.h"
 #include "opendune.h"
+#include "pathfinder.h"
 #include "pool/pool.h"
 #include "pool/pool_structure.h"
 #include "pool/pool_unit.h"
+#include "profile.h"
+#include "replay.h"
+#include "snapshot.h"
 #include "sprites.h"
 #include "structure.h"
 #include "team.h"
@@ -40,6 +46,7 @@
 #include "tools/coord.h"
 #include "unit.h"
 #include "video/video.h"
+#include "worldhash.h"
 
 /*--------------------------------------------------------------*/
 
@@ -71,21 +78,51 @@ GameLoop_Client_Unit(void)
 			u = Unit_FindNext(&find)) {
 		const UnitInfo *ui = &g_table_unitInfo[u->o.type];
 
-		Unit_RefreshFog(UNVEILCAUSE_UNIT_VISION, u, ui->flags.isGroundUnit);
+		Unit_RefreshVision(u, ui->flags.isGroundUnit);
 	}
 }
 
-static void
+void
 GameLoop_Server_Logic(void)
 {
+	Replay_Record_Step();
+
+	Profile_Begin(PROFILE_SQUAD);
 	UnitAI_SquadLoop();
+	Profile_End(PROFILE_SQUAD);
+
+	Profile_Begin(PROFILE_TEAM);
 	GameLoop_Team();
+	Profile_End(PROFILE_TEAM);
+
+	if (enhancement_astar_pathfinder) {
+		Profile_Begin(PROFILE_PATHFINDER);
+		Pathfinder_ProcessQueue();
+		Profile_End(PROFILE_PATHFINDER);
+	}
+
+	Profile_Begin(PROFILE_UNIT);
 	GameLoop_Unit();
+	Profile_End(PROFILE_UNIT);
+
+	Profile_Begin(PROFILE_STRUCTURE);
 	GameLoop_Structure();
+	Profile_End(PROFILE_STRUCTURE);
+
+	Profile_Begin(PROFILE_HOUSE);
 	GameLoop_House();
+	Profile_End(PROFILE_HOUSE);
+
+	Profile_Begin(PROFILE_EXPLOSION);
 	Explosion_Tick();
+	Profile_End(PROFILE_EXPLOSION);
+
+	Profile_Begin(PROFILE_ANIMATION);
 	Animation_Tick();
+	Profile_End(PROFILE_ANIMATION);
+
 	Unit_Sort();
+	WorldHash_Tick();
 }
 
 static void
@@ -199,6 +236,27 @@ GameLoop_Client_ProcessGameInput(bool init_transform, uint16 key)
 			}
 			break;
 
+		case SCANCODE_F8:
+			/* Structures being placed live outside the snapshot. */
+			if (g_host_type == HOSTTYPE_NONE && g_selectionType != SELECTIONTYPE_PLACE) {
+				if (!Input_Test(SCANCODE_LSHIFT)) {
+					WorldSnapshot_QuickSave();
+					GUI_DisplayText("Quicksaved.", 0);
+				} else if (WorldSnapshot_QuickLoad()) {
+					/* Commands after this point no longer reproduce the game. */
+					Replay_Record_Stop();
+
+					Unit_UnselectAll();
+					g_unitActive = NULL;
+					g_activeAction = 0xFFFF;
+					if (g_selectionType == SELECTIONTYPE_TARGET)
+						GUI_ChangeSelectionType(SELECTIONTYPE_STRUCTURE);
+
+					GUI_DisplayText("Quickloaded.", 0);
+				}
+			}
+			break;
+
 		case SCANCODE_OPENBRACE:
 		case SCANCODE_CLOSEBRACE:
 			{
@@ -435,9 +493,28 @@ GameLoop_ProcessGUITimer(void)
 	}
 }
 
+/**
+ * In lockstep games, every peer runs the game logic once the commands
+ *  for the turn have arrived from every player.
+ */
+static void
+GameLoop_Lockstep_Logic(void)
+{
+	Server_RecvMessages();
+
+	if (Lockstep_NextTurn()) {
+		GameLoop_Server_Logic();
+		GameLoop_LevelEnd();
+
+		Client_Send_WorldHash();
+		Server_CheckWorldHashes();
+	}
+}
+
 static void
 GameLoop_ProcessGameTimer(void)
 {
+	static int64_t l_timerLockstep = 0;
 	static int64_t l_timerUnitStatus = 0;
 	static int16 l_selectionState = -2;
 
@@ -445,7 +522,13 @@ GameLoop_ProcessGameTimer(void)
 			|| (g_host_type != HOSTTYPE_NONE)) {
 		const int64_t curr_ticks = Timer_GameTicks();
 
-		if (g_timerGame != curr_ticks) {
+		/* In lockstep games, g_timerGame advances with each turn. */
+		if (Lockstep_IsRunning()) {
+			if (l_timerLockstep == curr_ticks)
+				return;
+
+			l_timerLockstep = curr_ticks;
+		} else if (g_timerGame != curr_ticks) {
 			g_timerGame = curr_ticks;
 		} else {
 			return;
@@ -479,7 +562,16 @@ GameLoop_ProcessGameTimer(void)
 			}
 		}
 
+		if (Lockstep_IsRunning()) {
+			GameLoop_Lockstep_Logic();
+			Client_SendMessages();
+			return;
+		}
+
 		if (g_host_type != HOSTTYPE_DEDICATED_SERVER) {
+			if (g_host_type != HOSTTYPE_NONE)
+				Client_Send_Viewport();
+
 			Client_SendMessages();
 		}
 
@@ -489,12 +581,18 @@ GameLoop_ProcessGameTimer(void)
 		} else {
 			GameLoop_Client_Logic();
 		}
+	} else if (Lockstep_IsRunning()) {
+		GameLoop_Lockstep_Logic();
+		return;
 	} else if (g_host_type == HOSTTYPE_DEDICATED_SERVER
 	        || g_host_type == HOSTTYPE_CLIENT_SERVER) {
 		Server_RecvMessages();
 		GameLoop_Server_Logic();
 	}
 
+	if (g_host_type == HOSTTYPE_NONE && g_gameOverlay == GAMEOVERLAY_NONE)
+		Autosave_Tick();
+
 	if (g_host_type != HOSTTYPE_DEDICATED_CLIENT) {
 		GameLoop_LevelEnd();
 	}
@@ -523,18 +621,29 @@ GameLoop_Loop(void)
 			GameLoop_ProcessGameTimer();
 		}
 
+		Profile_Begin(PROFILE_SEND_MESSAGES);
 		Server_SendMessages();
+		Profile_End(PROFILE_SEND_MESSAGES);
 
 		if (redraw && Timer_QueueIsEmpty()) {
 			redraw = false;
 			GUI_PaletteAnimate();
+
+			Profile_Begin(PROFILE_DRAW);
 			GameLoop_Client_Draw();
+			Profile_End(PROFILE_DRAW);
 		}
 	}
 
 	if (g_host_type != HOSTTYPE_NONE) {
+		Lockstep_Stop();
+
 		if (g_host_type == HOSTTYPE_CLIENT_SERVER) {
-			Server_Recv_ReturnToLobby(g_playerHouseID, true);
+			if (Lockstep_IsRelaying()) {
+				Lockstep_Server_DropHouse(g_playerHouseID);
+			} else {
+				Server_Recv_ReturnToLobby(g_playerHouseID, true);
+			}
 		} else if (g_host_type == HOSTTYPE_DEDICATED_CLIENT) {
 			Client_Send_ReturnToLobby();
 		}
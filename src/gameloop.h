@@ -1,6 +1,7 @@
 #ifndef GAMELOOP_H
 #define GAMELOOP_H
 
+extern void GameLoop_Server_Logic(void);
 extern void GameLoop_Loop(void);
 
 #endif
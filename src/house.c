@@ -268,6 +268,7 @@ void GameLoop_House(void)
 				}
 
 				if (u != NULL) {
+					UnitPool_MarkDirty(u);
 					u->o.linkedID = (uint8)h->starportLinkedID;
 					h->starportLinkedID = UNIT_INDEX_INVALID;
 					u->o.flags.s.inTransport = true;
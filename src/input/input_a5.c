@@ -13,6 +13,7 @@
 #include "../input/input.h"
 #include "../input/mouse.h"
 #include "../opendune.h"
+#include "../profile.h"
 #include "../video/video_a5.h"
 #include "scancode.h"
 
@@ -153,7 +154,13 @@ InputA5_ProcessEvent(ALLEGRO_EVENT *event, bool apply_mouse_transform)
 				VideoA5_ToggleFullscreen();
 				return true;
 			} else if (event->keyboard.keycode == ALLEGRO_KEY_F10) {
-				VideoA5_ToggleFPS();
+				if (event->keyboard.modifiers & ALLEGRO_KEYMOD_CTRL) {
+					Profile_ToggleCSV();
+				} else if (event->keyboard.modifiers & ALLEGRO_KEYMOD_SHIFT) {
+					VideoA5_ToggleProfile();
+				} else {
+					VideoA5_ToggleFPS();
+				}
 				return true;
 			} else if (event->keyboard.keycode == ALLEGRO_KEY_F12) {
 				VideoA5_CaptureScreenshot();
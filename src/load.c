@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "enum_string.h"
 #include "errorlog.h"
 #include "multichar.h"
@@ -13,6 +14,7 @@
 
 #include "ai.h"
 #include "audio/audio.h"
+#include "codec/lzblock.h"
 #include "file.h"
 #include "map.h"
 #include "mods/skirmish.h"
@@ -27,16 +29,17 @@
 #include "unit.h"
 
 
-static uint32 Load_FindChunk(FILE *fp, uint32 chunk)
+static uint32 Load_FindChunk(SaveBuffer *sb, uint32 chunk)
 {
 	uint32 header;
 	uint32 length;
 
-	while (fread(&header, sizeof(uint32), 1, fp) == 1) {
-		if (fread(&length, sizeof(uint32), 1, fp) != 1) return 0;
+	while (SaveBuffer_Read(sb, &header, sizeof(uint32))) {
+		if (!SaveBuffer_Read(sb, &length, sizeof(uint32))) return 0;
 		length = BETOH32(length);
+		if (length > sb->length) return 0;
 		if (BETOH32(header) != chunk) {
-			fseek(fp, length + (length & 1), SEEK_CUR);
+			sb->position += length + (length & 1);
 			continue;
 		}
 		return length;
@@ -44,7 +47,101 @@ static uint32 Load_FindChunk(FILE *fp, uint32 chunk)
 	return 0;
 }
 
-static bool Load_Main(FILE *fp)
+/**
+ * Unpack a compressed savegame, described in saveload.h, into the chunk
+ *  layout read by Load_Main.
+ *
+ * @param raw The buffer to unpack into, initialised by the caller.
+ * @param sb The compressed savegame, positioned after the 'DDZS' type.
+ * @return True if and only if all chunks were unpacked.
+ */
+static bool Load_Decompress(SaveBuffer *raw, SaveBuffer *sb)
+{
+	uint32 position;
+	uint32 indexPosition;
+	uint32 length;
+	uint32 offset;
+	uint16 version;
+	uint16 count;
+
+	if (!SaveBuffer_Write(raw, "FORM", 4)) return false;
+	if (!SaveBuffer_Write_le_uint32(raw, 0)) return false;
+	if (!SaveBuffer_Write(raw, "SCEN", 4)) return false;
+
+	/* Copy the 'NAME' chunk, which is not compressed */
+	position = sb->position;
+	length = Load_FindChunk(sb, CC_NAME);
+	if (length == 0 || length > sb->length - sb->position) return false;
+	if (!SaveBuffer_Write(raw, sb->data + sb->position - 8, 8 + length)) return false;
+	if ((length & 1) == 1) {
+		uint8 empty = 0;
+		if (!SaveBuffer_Write(raw, &empty, 1)) return false;
+	}
+
+	/* Find the 'DDZI' index */
+	sb->position = position;
+	length = Load_FindChunk(sb, CC_DDZI);
+	if (length < 4) return false;
+	if (!SaveBuffer_Read_le_uint16(sb, &version)) return false;
+	if (!SaveBuffer_Read_le_uint16(sb, &count)) return false;
+
+	if (version != SAVEGAME_CONTAINER_VERSION) {
+		Warning("Unsupported compressed savegame version %d.\n", version);
+		return false;
+	}
+
+	if (count > SAVEGAME_CONTAINER_CHUNKS_MAX || length < 4 + 12 * (uint32)count) return false;
+	indexPosition = sb->position;
+
+	/* Find the 'DDZD' data */
+	sb->position = position;
+	length = Load_FindChunk(sb, CC_DDZD);
+	if (length == 0 || length > sb->length - sb->position) return false;
+	position = sb->position;
+
+	/* Unpack the chunks in the order of the index */
+	offset = 0;
+	for (uint16 i = 0; i < count; i++) {
+		uint8 header[4];
+		uint32 rawLength;
+		uint32 storedLength;
+
+		sb->position = indexPosition + 12 * i;
+		if (!SaveBuffer_Read(sb, header, 4)) return false;
+		if (!SaveBuffer_Read_le_uint32(sb, &rawLength)) return false;
+		if (!SaveBuffer_Read_le_uint32(sb, &storedLength)) return false;
+
+		if (rawLength > SAVEGAME_CONTAINER_CHUNK_LENGTH_MAX) return false;
+		if (storedLength > rawLength || storedLength > length - offset) return false;
+
+		if (!SaveBuffer_Write(raw, header, 4)) return false;
+		if (!SaveBuffer_Write_le_uint32(raw, 0)) return false;
+		SaveBuffer_Patch_be_uint32(raw, raw->length - 4, rawLength);
+
+		/* Reserve room for the chunk, and keep ourself word aligned */
+		if (!SaveBuffer_Reserve(raw, rawLength + 1)) return false;
+
+		const uint8 *source = sb->data + position + offset;
+		uint8 *dest = raw->data + raw->length;
+		if (storedLength == rawLength) {
+			memcpy(dest, source, rawLength);
+		} else if (!LZBlock_Decode(dest, rawLength, source, storedLength)) {
+			return false;
+		}
+
+		raw->length += rawLength;
+		if ((rawLength & 1) == 1) raw->data[raw->length++] = 0;
+
+		offset += storedLength;
+	}
+
+	/* Fill in the total length of all data in the FORM chunk */
+	SaveBuffer_Patch_be_uint32(raw, 4, raw->length - 8);
+
+	return true;
+}
+
+static bool Load_Main(SaveBuffer *sb)
 {
 	uint32 position;
 	uint32 length;
@@ -52,17 +149,17 @@ static bool Load_Main(FILE *fp)
 	uint16 version;
 
 	/* All Dune II savegames should start with 'FORM'. */
-	if (fread(&header, sizeof(uint32), 1, fp) != 1) return false;
+	if (!SaveBuffer_Read(sb, &header, sizeof(uint32))) return false;
 	if (BETOH32(header) != CC_FORM) {
 		Warning("Invalid magic header in savegame.  Not a Dune II savegame.");
 		return false;
 	}
 
 	/* The total length field, which is ignored */
-	if (fread(&length, sizeof(uint32), 1, fp) != 1) return false;
+	if (!SaveBuffer_Read(sb, &length, sizeof(uint32))) return false;
 
 	/* The next 'chunk' is fake, and has no length field */
-	if (fread(&header, sizeof(uint32), 1, fp) != 1) return false;
+	if (!SaveBuffer_Read(sb, &header, sizeof(uint32))) return false;
 	if (BETOH32(header) != CC_SCEN) return false;
 
 	if (g_campaign_selected == CAMPAIGNID_SKIRMISH) {
@@ -71,31 +168,31 @@ static bool Load_Main(FILE *fp)
 		}
 	}
 
-	position = ftell(fp);
+	position = sb->position;
 
 	/* Find the 'INFO' chunk, as it contains the savegame version */
 	version = 0;
-	length = Load_FindChunk(fp, CC_INFO);
+	length = Load_FindChunk(sb, CC_INFO);
 	if (length == 0) return false;
 
 	/* Read the savegame version */
-	if (!fread_le_uint16(&version, fp)) return false;
+	if (!SaveBuffer_Read_le_uint16(sb, &version)) return false;
 	length -= 2;
 	if (version == 0) return false;
 
 	if (version != 0x0290) {
 		/* Get the scenarioID / campaignID */
-		if (!Info_LoadOld(fp, length)) return false;
+		if (!Info_LoadOld(sb, length)) return false;
 
 		g_gameMode = GM_RESTART;
 
 		/* Find the 'PLYR' chunk */
-		fseek(fp, position, SEEK_SET);
-		length = Load_FindChunk(fp, CC_PLYR);
+		sb->position = position;
+		length = Load_FindChunk(sb, CC_PLYR);
 		if (length == 0) return false;
 
 		/* Find the human player */
-		if (!House_LoadOld(fp, length)) return false;
+		if (!House_LoadOld(sb, length)) return false;
 
 		GUI_DisplayModalMessage(String_Get_ByIndex(STR_WARNING_ORIGINAL_SAVED_GAMES_ARE_INCOMPATIBLE_WITH_THE_NEW_VERSION_THE_BATTLE_WILL_BE_RESTARTED), 0xFFFF);
 
@@ -103,72 +200,73 @@ static bool Load_Main(FILE *fp)
 	}
 
 	/* Load the 'INFO' chunk'. It has to be the first chunk loaded */
-	if (!Info_Load(fp, length)) return false;
+	if (!Info_Load(sb, length)) return false;
 
 	/* Rewind, and read other chunks */
 	bool load_bldg = false;
 	bool load_plyr = false;
 	bool load_unit = false;
 	bool load_map  = false;
-	fseek(fp, position, SEEK_SET);
-	while (fread(&header, sizeof(uint32), 1, fp) == 1) {
+	sb->position = position;
+	while (SaveBuffer_Read(sb, &header, sizeof(uint32))) {
 		bool abort = false;
 		bool skip = false;
 
-		if (fread(&length, sizeof(uint32), 1, fp) != 1) return false;
+		if (!SaveBuffer_Read(sb, &length, sizeof(uint32))) return false;
 		length = BETOH32(length);
+		if (length > sb->length) return false;
 
 		switch (BETOH32(header)) {
 			case CC_NAME: break; /* 'NAME' chunk is of no interest to us */
 			case CC_INFO: break; /* 'INFO' chunk is already read */
-			case CC_MAP : if (!Map_Load      (fp, length)) return false; load_map  = true; Map_Load2Fallback(); break;
-			case CC_PLYR: if (!House_Load    (fp, length)) return false; load_plyr = true; break;
-			case CC_UNIT: if (!Unit_Load     (fp, length)) return false; load_unit = true; break;
-			case CC_BLDG: if (!Structure_Load(fp, length)) return false; load_bldg = true; break;
-			case CC_TEAM: if (!Team_Load     (fp, length)) return false; break;
-			case CC_ODUN: if (!UnitNew_Load  (fp, length)) return false; break;
+			case CC_MAP : if (!Map_Load      (sb, length)) return false; load_map  = true; Map_Load2Fallback(); break;
+			case CC_PLYR: if (!House_Load    (sb, length)) return false; load_plyr = true; break;
+			case CC_UNIT: if (!Unit_Load     (sb, length)) return false; load_unit = true; break;
+			case CC_BLDG: if (!Structure_Load(sb, length)) return false; load_bldg = true; break;
+			case CC_TEAM: if (!Team_Load     (sb, length)) return false; break;
+			case CC_ODUN: if (!UnitNew_Load  (sb, length)) return false; break;
 
 			/* Dune Dynasty extensions.  Note: must come AFTER CC_BLDG, CC_UNIT, etc. */
-			case CC_DDAI: if (!BrutalAI_Load (fp, length)) return false; break;
+			case CC_DDAI: if (!BrutalAI_Load (sb, length)) return false; break;
 
 			case CC_DDB2:
 				skip  = !load_bldg;
-				abort = !skip && !Structure_Load2(fp, length);
+				abort = !skip && !Structure_Load2(sb, length);
 				break;
 
 			case CC_DDH2:
 				skip  = !load_plyr;
-				abort = !skip && !House_Load2(fp, length);
+				abort = !skip && !House_Load2(sb, length);
 				break;
 
 			case CC_DDI2:
 				skip  = !load_unit;
-				abort = !skip && !Info_Load2(fp, length);
+				abort = !skip && !Info_Load2(sb, length);
 				break;
 
 			case CC_DDM2:
 				skip  = !load_map;
-				abort = !skip && !Map_Load2(fp, length);
+				abort = !skip && !Map_Load2(sb, length);
 				break;
 
 			case CC_DDS2:
 				skip  = g_campaign_selected != CAMPAIGNID_SKIRMISH;
-				abort = !skip && !Scenario_Load2(fp, length);
+				abort = !skip && !Scenario_Load2(sb, length);
 				break;
 
 			case CC_DDS3:
 				skip  = !load_plyr;
-				abort = !skip && !Scenario_Load3(fp, length);
+				abort = !skip && !Scenario_Load3(sb, length);
 				break;
 
 			case CC_DDU2:
 				skip  = !load_unit;
-				abort = !skip && !Unit_Load2(fp, length);
+				abort = !skip && !Unit_Load2(sb, length);
 				break;
 
 			case CC_DDS4:
 				skip  = g_campaign_selected != CAMPAIGNID_SKIRMISH;
-				abort = !skip && !Scenario_Load4(fp, length);
+				abort = !skip && !Scenario_Load4(sb, length);
 				break;
 
 			default:
@@ -188,7 +286,7 @@ static bool Load_Main(FILE *fp)
 
 		/* Savegames are word aligned */
 		position += length + 8 + (length & 1);
-		fseek(fp, position, SEEK_SET);
+		sb->position = position;
 	}
 
 	if (g_campaign_selected == CAMPAIGNID_SKIRMISH) {
@@ -206,6 +304,7 @@ static bool Load_Main(FILE *fp)
 bool
 LoadFile(const char *filename)
 {
+	SaveBuffer sb;
 	FILE *fp;
 	bool res;
 
@@ -223,13 +322,32 @@ LoadFile(const char *filename)
 		return false;
 	}
 
+	/* Read the whole savegame at once, then parse it from memory. */
+	SaveBuffer_Init(&sb);
+	res = SaveBuffer_ReadFile(&sb, fp);
+	fclose(fp);
+
 	Sprites_LoadTiles();
 
-	g_validateStrictIfZero++;
-	res = Load_Main(fp);
-	g_validateStrictIfZero--;
+	/* Unpack compressed savegames before parsing them */
+	if (res && sb.length >= 12 && memcmp(sb.data, "FORM", 4) == 0 && memcmp(sb.data + 8, "DDZS", 4) == 0) {
+		SaveBuffer raw;
 
-	fclose(fp);
+		SaveBuffer_Init(&raw);
+		sb.position = 12;
+		res = Load_Decompress(&raw, &sb);
+
+		SaveBuffer_Free(&sb);
+		sb = raw;
+	}
+
+	if (res) {
+		g_validateStrictIfZero++;
+		res = Load_Main(&sb);
+		g_validateStrictIfZero--;
+	}
+
+	SaveBuffer_Free(&sb);
 
 	if (!res) {
 		Error("Error while loading savegame.\n");
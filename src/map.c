@@ -21,6 +21,7 @@
 #include "newui/actionpanel.h"
 #include "newui/menubar.h"
 #include "opendune.h"
+#include "pathfinder.h"
 #include "pool/pool.h"
 #include "pool/pool_house.h"
 #include "pool/pool_structure.h"
@@ -48,9 +49,34 @@ uint16 g_mapSpriteID[64 * 64];
  */
 Tile g_map[MAP_SIZE_MAX * MAP_SIZE_MAX];
 FogOfWarTile g_mapVisible[MAP_SIZE_MAX * MAP_SIZE_MAX];
+FogOfWarHouse g_mapFog[HOUSE_MAX];
+
+enum {
+	LANDSCAPE_TYPE_SPRITES = 512                            /*!< Ground sprite IDs are 9 bits. */
+};
+
+static uint8 s_landscapeTypeBySpriteID[2][LANDSCAPE_TYPE_SPRITES]; /*!< Landscape type by hasStructure and ground sprite. */
 
 const uint8 g_functions[3][3] = {{0, 1, 0}, {2, 3, 0}, {0, 1, 0}};
 
+/* Journal of changed tiles.  Each reader keeps a cursor into the ring;
+ * a tile is only appended again once the furthest reader has passed its
+ * previous entry, so a tile changing every tick costs one entry per read.
+ */
+static uint16 s_journal[MAP_JOURNAL_SIZE];
+static uint32 s_journalHead;                                /*!< Number of entries ever appended. */
+static uint32 s_journalLead;                                /*!< Furthest position read by any cursor. */
+static uint32 s_journalTileEntry[MAP_SIZE_MAX * MAP_SIZE_MAX]; /*!< Per tile, one past its most recent journal entry. */
+
+/* Per MovementType the speed on each tile, from its landscape type.
+ * Map_MarkDirty queues the tile, and queued tiles are recomputed before
+ * the next read, as writers mark tiles before or after changing them.
+ */
+static uint8 s_movementSpeed[MOVEMENT_MAX][MAP_SIZE_MAX * MAP_SIZE_MAX];
+static uint16 s_movementStale[MAP_SIZE_MAX * MAP_SIZE_MAX];
+static bool s_movementStaleTile[MAP_SIZE_MAX * MAP_SIZE_MAX];
+static int s_movementStaleCount = -1;                       /*!< Number of queued tiles, or -1 to recompute the whole map. */
+
 static bool s_debugNoExplosionDamage = false;               /*!< When non-zero, explosions do no damage to their surrounding. */
 
 /**
@@ -310,10 +336,112 @@ uint16 Map_Clamp_Packed(uint16 position)
 	return Tile_PackXY(x, y);
 }
 
+/**
+ * Record that a tile may have changed, for the network, minimap, fog
+ *  of war and movement speeds to pick up.  Call before or after writing
+ *  to g_map[packed].
+ */
+void
+Map_MarkDirty(uint16 packed)
+{
+	if (s_movementStaleCount >= 0 && !s_movementStaleTile[packed]) {
+		s_movementStaleTile[packed] = true;
+		s_movementStale[s_movementStaleCount++] = packed;
+	}
+
+	if (s_journalTileEntry[packed] > s_journalLead)
+		return;
+
+	s_journal[s_journalHead % MAP_JOURNAL_SIZE] = packed;
+	s_journalHead++;
+	s_journalTileEntry[packed] = s_journalHead;
+}
+
+/**
+ * Make every cursor do a pass over the whole map, e.g. after loading.
+ */
+void
+Map_Journal_Invalidate(void)
+{
+	s_journalHead += MAP_JOURNAL_SIZE + 1;
+	s_journalLead = s_journalHead;
+	s_movementStaleCount = -1;
+}
+
+void
+Map_Journal_ResetCursor(MapJournalCursor *cursor)
+{
+	cursor->position = s_journalHead;
+	cursor->scan = 0;
+
+	if (s_journalLead < s_journalHead)
+		s_journalLead = s_journalHead;
+}
+
+/**
+ * Get the next tile changed since the cursor last read the journal.
+ *  Tiles may be returned more than once.
+ *
+ * @return The packed tile, or MAP_JOURNAL_END.
+ */
+uint16
+Map_Journal_Next(MapJournalCursor *cursor)
+{
+	/* Entries were overwritten before this reader got to them. */
+	if (s_journalHead - cursor->position > MAP_JOURNAL_SIZE)
+		Map_Journal_ResetCursor(cursor);
+
+	if (cursor->scan < MAP_SIZE_MAX * MAP_SIZE_MAX)
+		return cursor->scan++;
+
+	if (cursor->position == s_journalHead)
+		return MAP_JOURNAL_END;
+
+	const uint16 packed = s_journal[cursor->position % MAP_JOURNAL_SIZE];
+
+	cursor->position++;
+	if (s_journalLead < cursor->position)
+		s_journalLead = cursor->position;
+
+	return packed;
+}
+
 bool
 Map_IsUnveiledToHouse(enum HouseType houseID, uint16 packed)
 {
-	return (g_mapVisible[packed].isUnveiled & (1 << houseID));
+	return (g_mapFog[houseID].isUnveiled[packed / MAP_SIZE_MAX] >> (packed % MAP_SIZE_MAX)) & 0x1;
+}
+
+static void
+Map_SetUnveiledToHouse(enum HouseType houseID, uint16 packed, bool unveiled)
+{
+	const uint64_t bit = (uint64_t)1 << (packed % MAP_SIZE_MAX);
+
+	if (unveiled) {
+		g_mapFog[houseID].isUnveiled[packed / MAP_SIZE_MAX] |= bit;
+	} else {
+		g_mapFog[houseID].isUnveiled[packed / MAP_SIZE_MAX] &= ~bit;
+	}
+}
+
+/**
+ * Only let one house know about a tile, as in scenario files.
+ */
+void
+Map_SetUnveiledToHouseOnly(enum HouseType houseID, uint16 packed)
+{
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_MAX; h++)
+		Map_SetUnveiledToHouse(h, packed, (h == houseID));
+}
+
+/**
+ * Check whether the fog has returned to an unveiled tile, i.e. the
+ *  house no longer sees what is there.
+ */
+bool
+Map_HasFogTimedOut(enum HouseType houseID, uint16 packed)
+{
+	return g_mapFog[houseID].timeout[packed] <= (uint32)g_timerGame;
 }
 
 bool
@@ -325,14 +453,12 @@ Map_IsPositionUnveiled(enum HouseType houseID, uint16 packed)
 	if (!House_IsHuman(houseID))
 		return true;
 
-	const enum HouseFlag houseIDBit = (1 << houseID);
-
 	return (65 <= packed && packed < MAP_SIZE_MAX * MAP_SIZE_MAX - 65)
-		&& (g_mapVisible[packed].isUnveiled & houseIDBit)
-		&& (g_mapVisible[packed - 1].isUnveiled & houseIDBit)
-		&& (g_mapVisible[packed + 1].isUnveiled & houseIDBit)
-		&& (g_mapVisible[packed - MAP_SIZE_MAX].isUnveiled & houseIDBit)
-		&& (g_mapVisible[packed + MAP_SIZE_MAX].isUnveiled & houseIDBit);
+		&& Map_IsUnveiledToHouse(houseID, packed)
+		&& Map_IsUnveiledToHouse(houseID, packed - 1)
+		&& Map_IsUnveiledToHouse(houseID, packed + 1)
+		&& Map_IsUnveiledToHouse(houseID, packed - MAP_SIZE_MAX)
+		&& Map_IsUnveiledToHouse(houseID, packed + MAP_SIZE_MAX);
 }
 
 /**
@@ -405,6 +531,7 @@ static bool Map_UpdateWall(uint16 packed)
 	if (Map_GetLandscapeType(packed) != LST_WALL) return false;
 
 	t = &g_map[packed];
+	Map_MarkDirty(packed);
 
 	t->groundSpriteID = g_mapSpriteID[packed] & 0x1FF;
 	t->overlaySpriteID = g_wallSpriteID;
@@ -567,7 +694,10 @@ void Map_MakeExplosion(uint16 type, tile32 position, uint16 hitpoints, uint16 un
 			if (Tools_Random_256() <= loc24) loc22 = true;
 		}
 
-		if (loc22) Map_UpdateWall(positionPacked);
+		if (loc22) {
+			Map_UpdateWall(positionPacked);
+			Pathfinder_InvalidateTile(positionPacked);
+		}
 	}
 
 	const Unit *u = Tools_Index_GetUnit(unitOriginEncoded);
@@ -595,13 +725,14 @@ static const uint16 _landscapeSpriteMap[81] = {
 };
 
 /**
- * Get type of landscape of a tile.
+ * Decode the type of landscape of a sprite.
  *
- * @param packed The packed tile to examine.
+ * @param spriteID The ground sprite of the tile.
+ * @param hasStructure Whether there is a structure on the tile.
  * @return The type of landscape at the tile.
  */
 static enum LandscapeType
-Map_GetLandscapeType_BySpriteID(uint16 spriteID, bool hasStructure)
+Map_DecodeLandscapeType(uint16 spriteID, bool hasStructure)
 {
 	int16 spriteOffset;
 
@@ -622,6 +753,30 @@ Map_GetLandscapeType_BySpriteID(uint16 spriteID, bool hasStructure)
 	return _landscapeSpriteMap[spriteOffset];
 }
 
+/**
+ * Decode the landscape type of every ground sprite in advance, so
+ *  looking up the landscape type of a tile is a single table read.
+ *  Must be called once the slab, bloom, wall and landscape sprite IDs
+ *  are known.
+ */
+void
+Map_InitLandscapeTypes(void)
+{
+	for (uint16 spriteID = 0; spriteID < LANDSCAPE_TYPE_SPRITES; spriteID++) {
+		s_landscapeTypeBySpriteID[0][spriteID] = Map_DecodeLandscapeType(spriteID, false);
+		s_landscapeTypeBySpriteID[1][spriteID] = Map_DecodeLandscapeType(spriteID, true);
+	}
+}
+
+static enum LandscapeType
+Map_GetLandscapeType_BySpriteID(uint16 spriteID, bool hasStructure)
+{
+	if (spriteID >= LANDSCAPE_TYPE_SPRITES)
+		return Map_DecodeLandscapeType(spriteID, hasStructure);
+
+	return s_landscapeTypeBySpriteID[hasStructure ? 1 : 0][spriteID];
+}
+
 uint16 Map_GetLandscapeType(uint16 packed)
 {
 	Tile *t = &g_map[packed];
@@ -631,6 +786,40 @@ uint16 Map_GetLandscapeType(uint16 packed)
 	return Map_GetLandscapeType_BySpriteID(t->groundSpriteID, t->hasStructure);
 }
 
+static void
+Map_UpdateMovementSpeed(uint16 packed)
+{
+	const LandscapeInfo *li = &g_table_landscapeInfo[Map_GetLandscapeType(packed)];
+
+	for (enum UnitMovementType mt = MOVEMENT_FOOT; mt < MOVEMENT_MAX; mt++)
+		s_movementSpeed[mt][packed] = li->movementSpeed[mt];
+}
+
+/**
+ * Get the speed of a MovementType on a tile, from its landscape type.
+ *  Tiles changed since the last call are recomputed first.
+ */
+uint8
+Map_GetMovementSpeed(uint16 packed, enum UnitMovementType movementType)
+{
+	if (s_movementStaleCount < 0) {
+		for (uint16 i = 0; i < MAP_SIZE_MAX * MAP_SIZE_MAX; i++)
+			Map_UpdateMovementSpeed(i);
+
+		memset(s_movementStaleTile, 0, sizeof(s_movementStaleTile));
+		s_movementStaleCount = 0;
+	} else if (s_movementStaleCount > 0) {
+		for (int i = 0; i < s_movementStaleCount; i++) {
+			Map_UpdateMovementSpeed(s_movementStale[i]);
+			s_movementStaleTile[s_movementStale[i]] = false;
+		}
+
+		s_movementStaleCount = 0;
+	}
+
+	return s_movementSpeed[movementType][packed];
+}
+
 enum LandscapeType
 Map_GetLandscapeTypeVisible(uint16 packed)
 {
@@ -655,13 +844,14 @@ Map_GetLandscapeTypeOriginal(uint16 packed)
  */
 void Map_DeviateArea(uint16 type, tile32 position, uint16 radius, uint8 houseID)
 {
-	PoolFindStruct find;
-
 	Explosion_Start(type, position, enhancement_nonordos_deviation ? houseID : HOUSE_ORDOS);
 
-	for (Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
-			u != NULL;
-			u = Unit_FindNext(&find)) {
+	Unit *candidate[UNIT_INDEX_MAX_RAISED];
+	const uint16 count = Unit_FindInRadius(position, min(0xFFFF, radius * 16), candidate);
+
+	for (uint16 i = 0; i < count; i++) {
+		Unit *u = candidate[i];
+
 		if (Tile_GetDistance(position, u->o.position) / 16 >= radius) continue;
 
 		Unit_Deviate(u, 0, houseID);
@@ -678,6 +868,7 @@ void Map_Bloom_ExplodeSpice(uint16 packed, enum HouseFlag houses)
 	if (g_validateStrictIfZero == 0) {
 		Unit_Remove(Unit_Get_ByPackedTile(packed));
 		g_map[packed].groundSpriteID = g_mapSpriteID[packed] & 0x1FF;
+		Map_MarkDirty(packed);
 		Map_MakeExplosion(EXPLOSION_SPICE_BLOOM_TREMOR, Tile_UnpackTile(packed), 0, 0);
 	}
 
@@ -767,6 +958,7 @@ static void Map_FixupSpiceEdges(uint16 packed)
 		spriteID = g_iconMap[g_iconMap[ICM_ICONGROUP_LANDSCAPE] + spriteID] & 0x1FF;
 		g_mapSpriteID[packed] = 0x8000 | spriteID;
 		g_map[packed].groundSpriteID = spriteID;
+		Map_MarkDirty(packed);
 	}
 }
 
@@ -801,6 +993,7 @@ void Map_ChangeSpiceAmount(uint16 packed, int16 dir)
 	spriteID = g_iconMap[g_iconMap[ICM_ICONGROUP_LANDSCAPE] + spriteID] & 0x1FF;
 	g_mapSpriteID[packed] = 0x8000 | spriteID;
 	g_map[packed].groundSpriteID = spriteID;
+	Map_MarkDirty(packed);
 
 	Map_FixupSpiceEdges(packed);
 	Map_FixupSpiceEdges(packed + 1);
@@ -824,6 +1017,7 @@ void Map_Bloom_ExplodeSpecial(uint16 packed, uint8 houseID)
 	h = House_Get_ByIndex(houseID);
 
 	g_map[packed].groundSpriteID = g_landscapeSpriteID;
+	Map_MarkDirty(packed);
 	g_mapSpriteID[packed] = 0x8000 | g_landscapeSpriteID;
 
 	enemyHouseID = houseID;
@@ -1137,7 +1331,11 @@ uint16 Map_SearchSpice(uint16 packed, uint16 radius)
 extern void Map_SelectNext(bool getNext);
 #endif
 
-static int64_t
+/**
+ * Get the game tick (low 32 bits) until which a tile unveiled now
+ *  stays visible.
+ */
+uint32
 Map_GetUnveilTimeout(enum TileUnveilCause cause)
 {
 	const int duration
@@ -1197,10 +1395,10 @@ Map_UnveilTile(enum HouseType houseID, enum TileUnveilCause cause,
 	if (Tile_IsOutOfMap(packed))
 		return;
 
-	FogOfWarTile *f = &g_mapVisible[packed];
+	FogOfWarHouse *fog = &g_mapFog[houseID];
 
-	f->cause[houseID] = max(f->cause[houseID], cause);
-	f->timeout[houseID] = Map_GetUnveilTimeout(cause);
+	fog->cause[packed] = max(fog->cause[packed], cause);
+	fog->timeout[packed] = Map_GetUnveilTimeout(cause);
 
 	u = Unit_Get_ByPackedTile(packed);
 	if (u != NULL && (House_IsHuman(houseID) || u->o.type != UNIT_SANDWORM)) Unit_HouseUnitCount_Add(u, houseID);
@@ -1216,7 +1414,7 @@ Map_UnveilTile(enum HouseType houseID, enum TileUnveilCause cause,
 	if (Map_IsPositionUnveiled(houseID, packed))
 		return;
 
-	f->isUnveiled |= (1 << houseID);
+	Map_SetUnveiledToHouse(houseID, packed, true);
 	Map_UnveilTile_Neighbour(houseID, packed);
 	Map_UnveilTile_Neighbour(houseID, packed + 1);
 	Map_UnveilTile_Neighbour(houseID, packed - 1);
@@ -1231,12 +1429,12 @@ Map_RefreshTile(enum HouseType houseID, enum TileUnveilCause cause, uint16 packe
 		return;
 
 	if (Map_IsUnveiledToHouse(houseID, packed)) {
-		const int64_t timeout = Map_GetUnveilTimeout(cause);
-		FogOfWarTile *f = &g_mapVisible[packed];
+		const uint32 timeout = Map_GetUnveilTimeout(cause);
+		FogOfWarHouse *fog = &g_mapFog[houseID];
 
-		if (f->timeout[houseID] < timeout) {
-			f->cause[houseID] = max(f->cause[houseID], cause);
-			f->timeout[houseID] = timeout;
+		if (fog->timeout[packed] < timeout) {
+			fog->cause[packed] = max(fog->cause[packed], cause);
+			fog->timeout[packed] = timeout;
 		}
 	}
 }
@@ -1245,6 +1443,7 @@ void
 Map_ResetFogOfWar(void)
 {
 	memset(g_mapVisible, 0, sizeof(g_mapVisible));
+	memset(g_mapFog, 0, sizeof(g_mapFog));
 
 	for (uint16 packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++) {
 		FogOfWarTile *f = &g_mapVisible[packed];
@@ -1254,41 +1453,88 @@ Map_ResetFogOfWar(void)
 	}
 }
 
+/**
+ * Copy what the player can see of a tile into g_mapVisible.
+ */
+static void
+Map_Client_CopyVisibleTile(uint16 packed)
+{
+	const Tile *t = &g_map[packed];
+	FogOfWarTile *f = &g_mapVisible[packed];
+
+	if (f->groundSpriteID == t->groundSpriteID
+			&& f->overlaySpriteID == t->overlaySpriteID
+			&& f->houseID == t->houseID
+			&& f->hasStructure == t->hasStructure)
+		return;
+
+	f->groundSpriteID = t->groundSpriteID;
+	f->overlaySpriteID = t->overlaySpriteID;
+	f->houseID = t->houseID;
+	f->hasStructure = t->hasStructure;
+	Map_MarkDirty(packed);
+}
+
 void
 Map_Client_UpdateFogOfWar(void)
 {
+	static MapJournalCursor l_cursor;
+	static bool l_fogOfWar;
+	uint16 packed;
+
+	if (l_fogOfWar != enhancement_fog_of_war) {
+		l_fogOfWar = enhancement_fog_of_war;
+		Map_Journal_ResetCursor(&l_cursor);
+	}
+
+	/* Timeouts expire without touching g_map, so the fog still needs a
+	 * pass over the map.  Tiles only need copying when they come into
+	 * view, or when the journal says they changed.
+	 */
 	if (enhancement_fog_of_war) {
-		for (uint16 packed = 65; packed < MAP_SIZE_MAX * MAP_SIZE_MAX - 65; packed++) {
+		const FogOfWarHouse *fog = &g_mapFog[g_playerHouseID];
+		const uint32 now = g_timerGame;
+
+		for (packed = 65; packed < MAP_SIZE_MAX * MAP_SIZE_MAX - 65; packed++) {
 			FogOfWarTile *f = &g_mapVisible[packed];
+			uint8 bits;
 
 			if (!Map_IsUnveiledToHouse(g_playerHouseID, packed)
-					|| (f->timeout[g_playerHouseID] <= g_timerGame)) {
-				f->fogOverlayBits = 0xF;
+					|| (fog->timeout[packed] <= now)) {
+				bits = 0xF;
 			} else {
-				const Tile *t = &g_map[packed];
-
-				f->groundSpriteID = t->groundSpriteID;
-				f->overlaySpriteID = t->overlaySpriteID;
-				f->houseID = t->houseID;
-				f->hasStructure = t->hasStructure;
-				f->fogOverlayBits = 0;
-
-				if (g_mapVisible[packed - 64].timeout[g_playerHouseID] <= g_timerGame) f->fogOverlayBits |= 0x1;
-				if (g_mapVisible[packed +  1].timeout[g_playerHouseID] <= g_timerGame) f->fogOverlayBits |= 0x2;
-				if (g_mapVisible[packed + 64].timeout[g_playerHouseID] <= g_timerGame) f->fogOverlayBits |= 0x4;
-				if (g_mapVisible[packed -  1].timeout[g_playerHouseID] <= g_timerGame) f->fogOverlayBits |= 0x8;
+				bits = 0;
+				if (fog->timeout[packed - 64] <= now) bits |= 0x1;
+				if (fog->timeout[packed +  1] <= now) bits |= 0x2;
+				if (fog->timeout[packed + 64] <= now) bits |= 0x4;
+				if (fog->timeout[packed -  1] <= now) bits |= 0x8;
+
+				if (f->fogOverlayBits == 0xF)
+					Map_Client_CopyVisibleTile(packed);
+			}
+
+			if (f->fogOverlayBits != bits) {
+				f->fogOverlayBits = bits;
+				Map_MarkDirty(packed);
 			}
 		}
 	} else {
-		for (uint16 packed = 65; packed < MAP_SIZE_MAX * MAP_SIZE_MAX - 65; packed++) {
-			const Tile *t = &g_map[packed];
+		for (packed = 65; packed < MAP_SIZE_MAX * MAP_SIZE_MAX - 65; packed++) {
 			FogOfWarTile *f = &g_mapVisible[packed];
+			const uint8 bits = Map_IsUnveiledToHouse(g_playerHouseID, packed) ? 0x0 : 0xF;
 
-			f->groundSpriteID = t->groundSpriteID;
-			f->overlaySpriteID = t->overlaySpriteID;
-			f->houseID = t->houseID;
-			f->hasStructure = t->hasStructure;
-			f->fogOverlayBits = Map_IsUnveiledToHouse(g_playerHouseID, packed) ? 0x0 : 0xF;
+			if (f->fogOverlayBits != bits) {
+				f->fogOverlayBits = bits;
+				Map_MarkDirty(packed);
+			}
 		}
 	}
+
+	while ((packed = Map_Journal_Next(&l_cursor)) != MAP_JOURNAL_END) {
+		if (packed < 65 || packed >= MAP_SIZE_MAX * MAP_SIZE_MAX - 65)
+			continue;
+
+		if (!enhancement_fog_of_war || g_mapVisible[packed].fogOverlayBits != 0xF)
+			Map_Client_CopyVisibleTile(packed);
+	}
 }
@@ -10,7 +10,10 @@
 #include "types.h"
 
 enum {
-	MAP_SIZE_MAX = 64
+	MAP_SIZE_MAX = 64,
+
+	MAP_JOURNAL_SIZE = 2 * MAP_SIZE_MAX * MAP_SIZE_MAX,     /*!< Entries kept before a slow reader has to rescan the map. */
+	MAP_JOURNAL_END = 0xFFFF                                /*!< Returned by Map_Journal_Next when there are no more changes. */
 };
 
 MSVC_PACKED_BEGIN
@@ -31,21 +34,38 @@ typedef struct Tile {
 MSVC_PACKED_END
 assert_compile(sizeof(Tile) == 0x04);
 
-typedef struct FogOfWarTile {
-	enum TileUnveilCause cause[HOUSE_MAX];
-	int64_t timeout[HOUSE_MAX];
+/**
+ * The fog of war known to each house, stored as planes so that passes
+ *  over the whole map only read the house they are interested in.
+ */
+typedef struct FogOfWarHouse {
+	uint64_t isUnveiled[MAP_SIZE_MAX];                      /*!< Tiles ever unveiled: one bit per tile, one word per row. */
+	uint32 timeout[MAP_SIZE_MAX * MAP_SIZE_MAX];            /*!< Game tick (low 32 bits) until which the tile is visible. */
+	uint8 cause[MAP_SIZE_MAX * MAP_SIZE_MAX];               /*!< Strongest enum TileUnveilCause since last sent to the client. */
+} FogOfWarHouse;
 
+/**
+ * What the local player last saw of a tile, for drawing.
+ */
+typedef struct FogOfWarTile {
 	uint16 groundSpriteID;
 	uint8 overlaySpriteID;
 	enum HouseType houseID;
 	bool hasStructure;
 
-	enum HouseFlag isUnveiled;
-
 	uint8 fogSpriteID;      /* Opaque fog.  Used to be shared with craters in overlaySpriteID. */
 	uint8 fogOverlayBits;   /* 1,2,4,8 for up, right, down, left. */
 } FogOfWarTile;
 
+/**
+ * A reader's position in the journal of changed tiles.  A zeroed cursor
+ *  starts with a pass over the whole map.
+ */
+typedef struct MapJournalCursor {
+	uint32 position;                                        /*!< Journal entries before this have been read. */
+	uint16 scan;                                            /*!< Next tile of a pass over the whole map, or MAP_SIZE_MAX * MAP_SIZE_MAX when done. */
+} MapJournalCursor;
+
 /** Definition of the map size of a map scale. */
 typedef struct MapInfo {
 	uint16 minX;                                            /*!< Minimal X position of the map. */
@@ -74,6 +94,7 @@ struct Unit;
 extern uint16 g_mapSpriteID[MAP_SIZE_MAX * MAP_SIZE_MAX];
 extern Tile g_map[MAP_SIZE_MAX * MAP_SIZE_MAX];
 extern FogOfWarTile g_mapVisible[MAP_SIZE_MAX * MAP_SIZE_MAX];
+extern FogOfWarHouse g_mapFog[HOUSE_MAX];
 extern const uint8 g_functions[3][3];
 
 extern const MapInfo g_mapInfos[3];
@@ -94,12 +115,21 @@ extern uint16 Map_SetSelectionObjectPosition(uint16 packed);
 extern void Map_UpdateMinimapPosition(uint16 packed, bool forceUpdate);
 extern bool Map_IsValidPosition(uint16 position);
 extern uint16 Map_Clamp_Packed(uint16 position);
+extern void Map_MarkDirty(uint16 packed);
+extern void Map_Journal_Invalidate(void);
+extern void Map_Journal_ResetCursor(MapJournalCursor *cursor);
+extern uint16 Map_Journal_Next(MapJournalCursor *cursor);
 extern bool Map_IsUnveiledToHouse(enum HouseType houseID, uint16 packed);
+extern void Map_SetUnveiledToHouseOnly(enum HouseType houseID, uint16 packed);
+extern bool Map_HasFogTimedOut(enum HouseType houseID, uint16 packed);
+extern uint32 Map_GetUnveilTimeout(enum TileUnveilCause cause);
 extern bool Map_IsPositionUnveiled(enum HouseType houseID, uint16 packed);
 extern bool Map_IsPositionInViewport(tile32 position, int *retX, int *retY);
 extern enum HouseFlag Map_FindHousesInRadius(tile32 tile, int radius);
 extern void Map_MakeExplosion(uint16 type, tile32 position, uint16 hitpoints, uint16 unitOriginEncoded);
+extern void Map_InitLandscapeTypes(void);
 extern uint16 Map_GetLandscapeType(uint16 packed);
+extern uint8 Map_GetMovementSpeed(uint16 packed, enum UnitMovementType movementType);
 extern enum LandscapeType Map_GetLandscapeTypeVisible(uint16 packed);
 extern enum LandscapeType Map_GetLandscapeTypeOriginal(uint16 packed);
 extern void Map_DeviateArea(uint16 type, tile32 position, uint16 radius, uint8 houseID);
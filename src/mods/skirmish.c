@@ -14,6 +14,7 @@
 #include "../gui/gui.h"
 #include "../map.h"
 #include "../opendune.h"
+#include "../pathfinder.h"
 #include "../pool/pool.h"
 #include "../pool/pool_structure.h"
 #include "../pool/pool_unit.h"
@@ -1053,6 +1054,8 @@ Skirmish_GenerateMap2(bool only_landscape, SkirmishData *sd)
 	Sprites_LoadTiles();
 	Tools_RandomLCG_Seed(seed);
 	Map_CreateLandscape(seed, params, g_map);
+	Pathfinder_InvalidateAll();
+	Map_Journal_Invalidate();
 
 	if (only_landscape)
 		return true;
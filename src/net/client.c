@@ -8,9 +8,11 @@
 
 #include "client.h"
 
+#include "lockstep.h"
 #include "message.h"
 #include "net.h"
 #include "../audio/audio.h"
+#include "../config.h"
 #include "../enhancement.h"
 #include "../explosion.h"
 #include "../gfx.h"
@@ -28,8 +30,14 @@
 #include "../pool/pool_house.h"
 #include "../pool/pool_structure.h"
 #include "../pool/pool_unit.h"
+#include "../replay.h"
+#include "../sprites.h"
 #include "../structure.h"
+#include "../table/widgetinfo.h"
+#include "../tools/coord.h"
 #include "../tools/random_starport.h"
+#include "../unit.h"
+#include "../worldhash.h"
 
 #if 0
 #define CLIENT_LOG(FORMAT,...)	\
@@ -38,6 +46,14 @@
 #define CLIENT_LOG(...)
 #endif
 
+/* Last snapshot received of each object, which the server's records
+ * are relative to.
+ */
+static StructureDelta s_structureSnapshot[STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT];
+static UnitDelta s_unitSnapshot[UNIT_INDEX_MAX_RAISED];
+static uint16 s_viewportSent;
+static uint32 s_worldHashSent;
+
 /*--------------------------------------------------------------*/
 
 void
@@ -45,6 +61,11 @@ Client_ResetCache(void)
 {
 	memset(g_client2server_message_buf, 0, MAX_CLIENT_MESSAGE_LEN);
 	g_client2server_message_len = 0;
+
+	memset(s_structureSnapshot, 0, sizeof(s_structureSnapshot));
+	memset(s_unitSnapshot, 0, sizeof(s_unitSnapshot));
+	s_viewportSent = 0xFFFF;
+	s_worldHashSent = 0;
 }
 
 /*--------------------------------------------------------------*/
@@ -190,6 +211,29 @@ Client_Send_IssueUnitAction(uint8 actionID, uint16 encoded, const Object *o)
 	Net_Encode_ObjectIndex(&buf, o);
 }
 
+/**
+ * Tell the server which tile the viewport is centred on, so that it
+ *  can send nearby units first when bandwidth is short.
+ */
+void
+Client_Send_Viewport(void)
+{
+	const WidgetInfo *wi = &g_table_gameWidgetInfo[GAME_WIDGET_VIEWPORT];
+	const int cx = Tile_GetPackedX(g_viewportPosition) + wi->width / (2 * TILE_SIZE);
+	const int cy = Tile_GetPackedY(g_viewportPosition) + wi->height / (2 * TILE_SIZE);
+	const uint16 packed = Tile_PackXY(cx, cy);
+
+	if (packed == s_viewportSent)
+		return;
+
+	unsigned char *buf = Client_GetBuffer(CSMSG_SET_VIEWPORT);
+	if (buf == NULL)
+		return;
+
+	Net_Encode_uint16(&buf, packed);
+	s_viewportSent = packed;
+}
+
 bool
 Client_Send_PrefName(const char *name)
 {
@@ -226,6 +270,30 @@ Client_Send_PrefHouse(enum HouseType houseID)
 	Net_Encode_uint8(&buf, houseID);
 }
 
+/**
+ * Reports our latest world hash to the server, which compares it with
+ *  its own to detect lockstep games that have gone out of sync.
+ */
+void
+Client_Send_WorldHash(void)
+{
+	uint32 tick;
+	uint32 hash;
+
+	if (g_host_type != HOSTTYPE_DEDICATED_CLIENT
+			|| !WorldHash_GetLatest(&tick, &hash)
+			|| tick == s_worldHashSent)
+		return;
+
+	unsigned char *buf = Client_GetBuffer(CSMSG_WORLD_HASH);
+	if (buf == NULL)
+		return;
+
+	Net_Encode_uint32(&buf, tick);
+	Net_Encode_uint32(&buf, hash);
+	s_worldHashSent = tick;
+}
+
 void
 Client_Send_Chat(const char *msg)
 {
@@ -252,6 +320,7 @@ Client_Recv_UpdateLandscape(const unsigned char **buf)
 		const Tile *s = (const Tile *)(*buf);
 		Tile *t = &g_map[packed];
 
+		Map_MarkDirty(packed);
 		t->groundSpriteID   = s->groundSpriteID;
 		t->overlaySpriteID  = s->overlaySpriteID;
 		t->houseID          = s->houseID;
@@ -331,28 +400,29 @@ Client_Recv_UpdateStructures(const unsigned char **buf)
 		const uint16 index = Net_Decode_ObjectIndex(buf);
 		Structure *s = Structure_Get_ByIndex(index);
 		Object *o = &s->o;
+		StructureDelta *d = &s_structureSnapshot[index];
 		const uint8 old_upgradeLevel = s->upgradeLevel;
 
+		Net_Decode_StructureDelta(buf, d);
+
 		o->index        = index;
-		o->type         = Net_Decode_uint8 (buf);
-		o->linkedID     = Net_Decode_uint8 (buf);
-		o->flags.all    = Net_Decode_uint32(buf);
-		o->houseID      = Net_Decode_uint8 (buf);
-		o->position.x   = Net_Decode_uint16(buf);
-		o->position.y   = Net_Decode_uint16(buf);
-		o->hitpoints    = Net_Decode_uint16(buf);
-
-		s->creatorHouseID       = Net_Decode_uint8 (buf);
-		s->rotationSpriteDiff   = Net_Decode_uint16(buf);
-		s->objectType           = Net_Decode_uint8 (buf);
-		s->upgradeLevel         = Net_Decode_uint8 (buf);
-		s->upgradeTimeLeft      = Net_Decode_uint8 (buf);
-		s->countDown            = Net_Decode_uint16(buf);
-		s->rallyPoint           = Net_Decode_uint16(buf);
+		o->type         = d->type;
+		o->linkedID     = d->linkedID;
+		o->flags.all    = d->flags;
+		o->houseID      = d->houseID;
+		o->position     = d->position;
+		o->hitpoints    = d->hitpoints;
+
+		s->creatorHouseID       = d->creatorHouse;
+		s->rotationSpriteDiff   = d->rotationSprite;
+		s->objectType           = d->objectType;
+		s->upgradeLevel         = d->upgradeLevel;
+		s->upgradeTimeLeft      = d->upgradeTime;
+		s->countDown            = d->countDown;
+		s->rallyPoint           = d->rallyPoint;
 
 		for (uint16 objectType = 0; objectType < OBJECTTYPE_MAX; objectType++) {
-			const uint8 buildQueueCount = Net_Decode_uint8(buf);
-			BuildQueue_SetCount(&s->queue, objectType, buildQueueCount);
+			BuildQueue_SetCount(&s->queue, objectType, d->buildQueueCount[objectType]);
 		}
 
 		if (s->objectType == 0xFF)
@@ -376,32 +446,40 @@ Client_Recv_UpdateUnits(const unsigned char **buf)
 		Unit *u = Unit_Get_ByIndex(index);
 		Object *o = &u->o;
 		const ObjectFlags old_flags = o->flags;
+		const uint8 old_houseID = Unit_GetHouseID(u);
+		UnitDelta *d = &s_unitSnapshot[index];
+
+		Net_Decode_UnitDelta(buf, d);
 
 		o->index        = index;
-		o->type         = Net_Decode_uint8 (buf);
-		o->flags.all    = Net_Decode_uint32(buf);
-		o->houseID      = Net_Decode_uint8 (buf);
-		o->position.x   = Net_Decode_uint16(buf);
-		o->position.y   = Net_Decode_uint16(buf);
-		o->hitpoints    = Net_Decode_uint16(buf);
-
-		u->actionID     = Net_Decode_uint8(buf);
-		u->nextActionID = Net_Decode_uint8(buf);
-		u->amount       = Net_Decode_uint8(buf);
-		u->deviated     = Net_Decode_uint8(buf);
-		u->deviatedHouse= Net_Decode_uint8(buf);
-		u->orientation[0].current   = Net_Decode_uint8(buf);
-		u->orientation[1].current   = Net_Decode_uint8(buf);
-		u->wobbleIndex  = Net_Decode_uint8(buf);
-		u->spriteOffset = Net_Decode_uint8(buf);
-		u->blinkHouse   = Net_Decode_uint8(buf);
+		o->type         = d->type;
+		o->flags.all    = d->flags;
+		o->houseID      = d->houseID;
+		o->position     = d->position;
+		o->hitpoints    = d->hitpoints;
+
+		u->actionID     = d->actionID;
+		u->nextActionID = d->nextActionID;
+		u->amount       = d->amount;
+		u->deviated     = d->deviated;
+		u->deviatedHouse= d->deviatedHouse;
+		u->orientation[0].current   = d->orientation0_current;
+		u->orientation[1].current   = d->orientation1_current;
+		u->wobbleIndex  = d->wobbleIndex;
+		u->spriteOffset = d->spriteOffset;
+		u->blinkHouse   = d->blinkHouse;
 
 		/* XXX -- Smooth animation not yet implemented. */
 		u->lastPosition = o->position;
+		UnitPool_GridUpdate(u);
 
 		if (o->flags.s.used != old_flags.s.used)
 			recount = true;
 
+		/* Deviation does not touch the tile, but the minimap shows it. */
+		if (o->flags.s.used && Unit_GetHouseID(u) != old_houseID)
+			Map_MarkDirty(Tile_PackTile(o->position));
+
 		if ((!o->flags.s.used && old_flags.s.used)
 		 || (!o->flags.s.allocated && old_flags.s.allocated)
 		 || ( o->flags.s.isNotOnMap && !old_flags.s.isNotOnMap)) {
@@ -560,6 +638,22 @@ Client_Recv_Scenario(const unsigned char **buf)
 	enhancement_fog_of_war = Net_Decode_uint8(buf);
 	enhancement_insatiable_sandworms = Net_Decode_uint8(buf);
 	enhancement_extend_sight_range = Net_Decode_uint8(buf);
+	g_net_lockstep = Net_Decode_uint8(buf);
+
+	const uint32 enhancements = Net_Decode_uint32(buf);
+	const uint16 astar_pathfinder_budget = Net_Decode_uint16(buf);
+	const uint8 repair_cost_formula = Net_Decode_uint8(buf);
+	const uint8 game_speed = Net_Decode_uint8(buf);
+
+	/* Every peer runs the simulation in lockstep games, so use the
+	 * host's settings for everything that affects it.
+	 */
+	if (g_net_lockstep) {
+		Replay_DecodeEnhancements(enhancements);
+		enhancement_astar_pathfinder_budget = astar_pathfinder_budget;
+		enhancement_repair_cost_formula = repair_cost_formula;
+		g_gameConfig.gameSpeed = game_speed;
+	}
 
 	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
 		g_multiplayer.client[h] = Net_Decode_uint8(buf);
@@ -718,6 +812,10 @@ Client_ProcessMessage(const unsigned char *buf, int count)
 				Client_Recv_Chat(&buf);
 				break;
 
+			case SCMSG_LOCKSTEP_TURN:
+				Lockstep_Client_Recv_Turn(&buf);
+				break;
+
 			case SCMSG_MAX:
 			case SCMSG_INVALID:
 			default:
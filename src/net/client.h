@@ -22,6 +22,8 @@ extern void Client_Send_ActivateSuperweapon(const struct Object *o);
 extern void Client_Send_LaunchDeathhand(uint16 packed);
 extern void Client_Send_EjectRepairFacility(const struct Object *o);
 extern void Client_Send_IssueUnitAction(uint8 actionID, uint16 encoded, const struct Object *o);
+extern void Client_Send_Viewport(void);
+extern void Client_Send_WorldHash(void);
 
 extern bool Client_Send_PrefName(const char *name);
 extern void Client_Send_PrefHouse(enum HouseType houseID);
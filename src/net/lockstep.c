@@ -0,0 +1,405 @@
+/**
+ * @file src/net/lockstep.c
+ *
+ * Lockstep multiplayer.  Instead of the server streaming the game
+ * state, every peer runs the simulation and only the players'
+ * commands are exchanged.  Commands issued during turn T are executed
+ * on turn T + LOCKSTEP_DELAY, and a turn is only executed once the
+ * commands of every house for that turn have arrived.  The server
+ * relays each house's commands to the other clients.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lockstep.h"
+
+#include "message.h"
+#include "net.h"
+#include "server.h"
+#include "../house.h"
+#include "../mods/multiplayer.h"
+#include "../timer/timer.h"
+#include "../tools/random_general.h"
+#include "../tools/random_lcg.h"
+
+#if 0
+#define LOCKSTEP_LOG(FORMAT,...)	\
+	do { fprintf(stderr, "%s:%d " FORMAT "\n", __FUNCTION__, __LINE__, __VA_ARGS__); } while (false)
+#else
+#define LOCKSTEP_LOG(...)
+#endif
+
+typedef struct LockstepTurn {
+	uint32 tick;                                /*!< Turn the commands are for. */
+	bool received;                              /*!< Whether the commands have arrived. */
+	uint16 len;                                 /*!< Length of the commands. */
+	unsigned char buf[LOCKSTEP_MAX_TURN_LEN];   /*!< The commands. */
+} LockstepTurn;
+
+static LockstepTurn s_turn[HOUSE_NEUTRAL][LOCKSTEP_WINDOW];
+
+static bool s_running;                  /*!< Whether this peer runs the game. */
+static bool s_relaying;                 /*!< Whether this peer relays commands (server only). */
+static uint32 s_tick;                   /*!< Next turn to execute. */
+static uint32 s_localTick;              /*!< Next turn to send the local player's commands for. */
+static enum HouseFlag s_participants;   /*!< Houses whose commands are needed to execute a turn. */
+
+/* Server only. */
+static enum HouseFlag s_houses;                 /*!< Houses still sending commands. */
+static uint32 s_nextTick[HOUSE_NEUTRAL];        /*!< Next turn expected from each house. */
+
+/* Local commands taken from the client buffer, waiting for a turn with room. */
+static unsigned char s_pending[MAX_CLIENT_MESSAGE_LEN];
+static int s_pending_len;
+
+/*--------------------------------------------------------------*/
+
+/**
+ * Returns the length of the message at the start of buf, including its
+ *  symbol, or 0 if it is invalid or incomplete.
+ */
+static int
+Lockstep_DecodeMessage(const unsigned char *buf, int count, enum ClientServerMsg *msg)
+{
+	if (count <= 0)
+		return 0;
+
+	*msg = Net_Decode_ClientServerMsg(buf[0]);
+	if (*msg >= CSMSG_MAX)
+		return 0;
+
+	const int len = 1 + Net_GetLength_ClientServerMsg(*msg);
+	return (count >= len) ? len : 0;
+}
+
+/**
+ * Copies the commands in src to dst, dropping anything else.
+ */
+static int
+Lockstep_CopyCommands(unsigned char *dst, int dst_len, const unsigned char *src, int count)
+{
+	int n = 0;
+
+	while (count > 0) {
+		enum ClientServerMsg msg;
+		const int len = Lockstep_DecodeMessage(src, count, &msg);
+		if (len <= 0)
+			break;
+
+		if (Net_IsCommand_ClientServerMsg(msg)) {
+			if (n + len > dst_len)
+				break;
+
+			memcpy(dst + n, src, len);
+			n += len;
+		}
+
+		src += len;
+		count -= len;
+	}
+
+	return n;
+}
+
+/**
+ * Moves the local player's commands out of the client buffer, leaving
+ *  chat and other messages to be sent as usual.  Returns as many
+ *  whole commands as fit in dst; the rest wait for the next turn.
+ */
+static int
+Lockstep_TakeLocalCommands(unsigned char *dst, int dst_len)
+{
+	const unsigned char *src = g_client2server_message_buf;
+	int count = g_client2server_message_len;
+	int kept = 0;
+
+	while (count > 0) {
+		enum ClientServerMsg msg;
+		const int len = Lockstep_DecodeMessage(src, count, &msg);
+		if (len <= 0)
+			break;
+
+		if (!Net_IsCommand_ClientServerMsg(msg)) {
+			memmove(g_client2server_message_buf + kept, src, len);
+			kept += len;
+		} else if (s_pending_len + len <= (int)sizeof(s_pending)) {
+			memcpy(s_pending + s_pending_len, src, len);
+			s_pending_len += len;
+		}
+
+		src += len;
+		count -= len;
+	}
+
+	g_client2server_message_len = kept;
+
+	int n = 0;
+	while (n < s_pending_len) {
+		enum ClientServerMsg msg;
+		const int len = Lockstep_DecodeMessage(s_pending + n, s_pending_len - n, &msg);
+		if (len <= 0 || n + len > dst_len)
+			break;
+
+		n += len;
+	}
+
+	memcpy(dst, s_pending, n);
+	memmove(s_pending, s_pending + n, s_pending_len - n);
+	s_pending_len -= n;
+	return n;
+}
+
+static void
+Lockstep_StoreTurn(enum HouseType houseID, uint32 tick, const unsigned char *buf, int len)
+{
+	if (!s_running || houseID >= HOUSE_NEUTRAL)
+		return;
+
+	if (tick < s_tick || tick >= s_tick + LOCKSTEP_WINDOW
+			|| len < 0 || len > LOCKSTEP_MAX_TURN_LEN) {
+		LOCKSTEP_LOG("house=%d, tick=%u, s_tick=%u, len=%d", houseID, tick, s_tick, len);
+		return;
+	}
+
+	LockstepTurn *turn = &s_turn[houseID][tick % LOCKSTEP_WINDOW];
+
+	turn->tick = tick;
+	turn->received = true;
+	turn->len = len;
+
+	if (len > 0)
+		memcpy(turn->buf, buf, len);
+}
+
+/**
+ * A house leaves the game when the server sends a turn consisting of
+ *  only CSMSG_RETURN_TO_LOBBY on its behalf.
+ */
+static bool
+Lockstep_IsLeaveTurn(const LockstepTurn *turn)
+{
+	return (turn->len == 1)
+		&& (Net_Decode_ClientServerMsg(turn->buf[0]) == CSMSG_RETURN_TO_LOBBY);
+}
+
+/*--------------------------------------------------------------*/
+
+void
+Lockstep_Start(bool enabled)
+{
+	s_running = false;
+	s_relaying = false;
+
+	if (!enabled || g_host_type == HOSTTYPE_NONE)
+		return;
+
+	memset(s_turn, 0, sizeof(s_turn));
+	s_tick = 0;
+	s_localTick = LOCKSTEP_DELAY;
+	s_pending_len = 0;
+	s_houses = 0;
+	s_running = true;
+
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		if (g_multiplayer.client[h] == 0)
+			continue;
+
+		s_houses |= (1 << h);
+		s_nextTick[h] = LOCKSTEP_DELAY;
+
+		/* Nobody has issued commands for the first turns. */
+		for (uint32 tick = 0; tick < LOCKSTEP_DELAY; tick++) {
+			Lockstep_StoreTurn(h, tick, NULL, 0);
+		}
+	}
+
+	s_participants = s_houses;
+	s_relaying = (g_host_type == HOSTTYPE_DEDICATED_SERVER
+			|| g_host_type == HOSTTYPE_CLIENT_SERVER);
+
+	/* Every peer starts from the same random state, and simulates
+	 * the game events itself rather than being sent them.
+	 */
+	Tools_RandomLCG_Seed(g_multiplayer.curr_seed);
+	Tools_Random_Seed(g_multiplayer.curr_seed);
+	g_client_houses = 0;
+}
+
+void
+Lockstep_Stop(void)
+{
+	s_running = false;
+}
+
+bool
+Lockstep_IsRunning(void)
+{
+	return s_running;
+}
+
+bool
+Lockstep_IsRelaying(void)
+{
+	return s_relaying;
+}
+
+/*--------------------------------------------------------------*/
+
+static void
+Lockstep_Server_RecvTurn(enum HouseType houseID, uint32 tick, const unsigned char *buf, int len)
+{
+	if (houseID >= HOUSE_NEUTRAL
+			|| !(s_houses & (1 << houseID))
+			|| tick != s_nextTick[houseID]) {
+		LOCKSTEP_LOG("house=%d, tick=%u", houseID, tick);
+		return;
+	}
+
+	Lockstep_StoreTurn(houseID, tick, buf, len);
+	Server_Send_LockstepTurn(houseID, tick, buf, len);
+	s_nextTick[houseID]++;
+}
+
+/**
+ * Sends the local player's commands for the next turn, then executes
+ *  the current turn's commands if every house's have arrived.  Returns
+ *  true if the caller should run the game logic for the turn.
+ */
+bool
+Lockstep_NextTurn(void)
+{
+	if (!s_running)
+		return false;
+
+	if (g_host_type != HOSTTYPE_DEDICATED_SERVER
+			&& (s_participants & (1 << g_playerHouseID))
+			&& s_localTick <= s_tick + LOCKSTEP_DELAY) {
+		unsigned char buf[LOCKSTEP_MAX_TURN_LEN];
+		const int len = Lockstep_TakeLocalCommands(buf, sizeof(buf));
+
+		if (s_relaying) {
+			Lockstep_Server_RecvTurn(g_playerHouseID, s_localTick, buf, len);
+		} else {
+			Lockstep_StoreTurn(g_playerHouseID, s_localTick, buf, len);
+			Client_Send_LockstepTurn(s_localTick, buf, len);
+		}
+
+		s_localTick++;
+	}
+
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		if (!(s_participants & (1 << h)))
+			continue;
+
+		const LockstepTurn *turn = &s_turn[h][s_tick % LOCKSTEP_WINDOW];
+		if (!turn->received || turn->tick != s_tick)
+			return false;
+	}
+
+	g_timerGame++;
+
+	enum HouseFlag leaving = 0;
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		if (!(s_participants & (1 << h)))
+			continue;
+
+		LockstepTurn *turn = &s_turn[h][s_tick % LOCKSTEP_WINDOW];
+		if (Lockstep_IsLeaveTurn(turn))
+			leaving |= (1 << h);
+
+		Server_ProcessMessage(g_multiplayer.client[h], h, turn->buf, turn->len);
+		turn->received = false;
+	}
+
+	s_participants &= ~leaving;
+	s_tick++;
+	return true;
+}
+
+/**
+ * Handles a packet from a client in a lockstep game.  Commands are only
+ *  accepted as part of a turn; everything else is processed at once.
+ */
+void
+Lockstep_Server_Recv(int peerID, enum HouseType houseID, const unsigned char *buf, int count)
+{
+	while (count > 0) {
+		enum ClientServerMsg msg;
+		const int len = Lockstep_DecodeMessage(buf, count, &msg);
+		if (len <= 0)
+			break;
+
+		if (msg == CSMSG_LOCKSTEP_TURN) {
+			const unsigned char *body = buf + 1;
+			const uint32 tick = Net_Decode_uint32(&body);
+			const uint16 body_len = Net_Decode_uint16(&body);
+
+			if (count < len + body_len)
+				break;
+
+			unsigned char cmds[LOCKSTEP_MAX_TURN_LEN];
+			const int n = Lockstep_CopyCommands(cmds, sizeof(cmds), body, body_len);
+
+			Lockstep_Server_RecvTurn(houseID, tick, cmds, n);
+
+			buf += len + body_len;
+			count -= len + body_len;
+			continue;
+		}
+
+		if (msg == CSMSG_RETURN_TO_LOBBY) {
+			Lockstep_Server_DropHouse(houseID);
+		} else if (!Net_IsCommand_ClientServerMsg(msg)) {
+			Server_ProcessMessage(peerID, houseID, buf, len);
+		} else {
+			/* Commands outside of a turn would not be executed
+			 * by the other peers.
+			 */
+			LOCKSTEP_LOG("house=%d, msg=%d", houseID, msg);
+		}
+
+		buf += len;
+		count -= len;
+	}
+}
+
+/**
+ * Ends the house's commands with a turn that returns it to the lobby.
+ *  Used when a player leaves the game or disconnects.
+ */
+void
+Lockstep_Server_DropHouse(enum HouseType houseID)
+{
+	if (!s_relaying || houseID >= HOUSE_NEUTRAL || !(s_houses & (1 << houseID)))
+		return;
+
+	unsigned char buf[1];
+	unsigned char *p = buf;
+
+	Net_Encode_ClientServerMsg(&p, CSMSG_RETURN_TO_LOBBY);
+	assert(p - buf == sizeof(buf));
+
+	Lockstep_Server_RecvTurn(houseID, s_nextTick[houseID], buf, sizeof(buf));
+
+	s_houses &= ~(1 << houseID);
+	if (s_houses == 0)
+		s_relaying = false;
+
+	/* The server may no longer be running the game itself. */
+	PeerData *data = Net_GetPeerData(g_multiplayer.client[houseID]);
+	if (data != NULL)
+		data->state = CLIENTSTATE_IN_LOBBY;
+}
+
+void
+Lockstep_Client_Recv_Turn(const unsigned char **buf)
+{
+	const enum HouseType houseID = Net_Decode_uint8(buf);
+	const uint32 tick = Net_Decode_uint32(buf);
+	const uint16 len = Net_Decode_uint16(buf);
+
+	Lockstep_StoreTurn(houseID, tick, *buf, len);
+	(*buf) += len;
+}
@@ -0,0 +1,24 @@
+#ifndef NET_LOCKSTEP_H
+#define NET_LOCKSTEP_H
+
+#include <stdbool.h>
+#include "enumeration.h"
+#include "types.h"
+
+enum {
+	LOCKSTEP_DELAY = 4,             /* Turns between issuing a command and executing it. */
+	LOCKSTEP_WINDOW = 16,           /* Turns buffered per house; more than twice the delay. */
+	LOCKSTEP_MAX_TURN_LEN = 1024    /* Bytes of commands per house per turn. */
+};
+
+extern void Lockstep_Start(bool enabled);
+extern void Lockstep_Stop(void);
+extern bool Lockstep_IsRunning(void);
+extern bool Lockstep_IsRelaying(void);
+extern bool Lockstep_NextTurn(void);
+
+extern void Lockstep_Server_Recv(int peerID, enum HouseType houseID, const unsigned char *buf, int count);
+extern void Lockstep_Server_DropHouse(enum HouseType houseID);
+extern void Lockstep_Client_Recv_Turn(const unsigned char **buf);
+
+#endif
@@ -22,6 +22,9 @@ static const struct {
 	{ 's', 2 }, /* CSMSG_ACTIVATE_STRUCTURE_ABILITY */
 	{ 'w', 2 }, /* CSMSG_LAUNCH_DEATHHAND */
 	{ 'u', 5 }, /* CSMSG_ISSUE_UNIT_ACTION */
+	{ 'v', 2 }, /* CSMSG_SET_VIEWPORT */
+	{ 't', 6 }, /* CSMSG_LOCKSTEP_TURN, followed by the commands */
+	{ '#', 8 }, /* CSMSG_WORLD_HASH */
 	{ 'n', MAX_NAME_LEN }, /* CSMSG_PREFERRED_NAME */
 	{ 'h', 1 }, /* CSMSG_PREFERRED_HOUSE */
 	{'\'', MAX_CHAT_LEN + 2 }, /* CSMSG_CHAT */
@@ -48,6 +51,7 @@ static unsigned char s_table_scmsg[SCMSG_MAX] = {
 	'Z', /* SCMSG_SCENARIO */
 	'1', /* SCMSG_START_GAME */
 	'"', /* SCMSG_CHAT */
+	'T', /* SCMSG_LOCKSTEP_TURN */
 };
 
 unsigned char g_server_broadcast_message_buf[MAX_SERVER_BROADCAST_MESSAGE_LEN];
@@ -107,6 +111,57 @@ Net_Decode_uint32(const unsigned char **buf)
 	return ret;
 }
 
+/**
+ * Encode an unsigned integer in 7-bit groups, lowest first, with the
+ *  top bit of each byte set when more follow.
+ */
+void
+Net_Encode_varint(unsigned char **buf, uint32 val)
+{
+	while (val >= 0x80) {
+		Net_Encode_uint8(buf, (val & 0x7F) | 0x80);
+		val >>= 7;
+	}
+
+	Net_Encode_uint8(buf, val);
+}
+
+uint32
+Net_Decode_varint(const unsigned char **buf)
+{
+	uint32 ret = 0;
+
+	for (int shift = 0; shift < 35; shift += 7) {
+		const uint8 c = Net_Decode_uint8(buf);
+
+		ret |= (uint32)(c & 0x7F) << shift;
+		if ((c & 0x80) == 0)
+			break;
+	}
+
+	return ret;
+}
+
+/* Change in a coordinate, zigzag encoded so small moves either way
+ * take a single byte.
+ */
+static void
+Net_Encode_CoordDelta(unsigned char **buf, uint16 prev, uint16 val)
+{
+	const uint16 diff = val - prev;
+	const uint16 sign = (diff & 0x8000) ? 0xFFFF : 0x0000;
+
+	Net_Encode_varint(buf, (uint16)((diff << 1) ^ sign));
+}
+
+static uint16
+Net_Decode_CoordDelta(const unsigned char **buf, uint16 prev)
+{
+	const uint16 z = Net_Decode_varint(buf);
+
+	return prev + (uint16)((z >> 1) ^ -(z & 1));
+}
+
 void
 Net_Encode_ObjectIndex(unsigned char **buf, const Object *o)
 {
@@ -133,6 +188,31 @@ Net_Encode_ClientServerMsg(unsigned char **buf, enum ClientServerMsg msg)
 	Net_Encode_uint8(buf, s_table_csmsg[msg].symbol);
 }
 
+/**
+ * Whether the message changes the game state.  Such messages are
+ *  executed on the same turn by every peer in lockstep games, and are
+ *  recorded in replays.
+ */
+bool
+Net_IsCommand_ClientServerMsg(enum ClientServerMsg msg)
+{
+	switch (msg) {
+		case CSMSG_REPAIR_UPGRADE_STRUCTURE:
+		case CSMSG_SET_RALLY_POINT:
+		case CSMSG_PURCHASE_RESUME_ITEM:
+		case CSMSG_PAUSE_CANCEL_ITEM:
+		case CSMSG_ENTER_LEAVE_PLACEMENT_MODE:
+		case CSMSG_PLACE_STRUCTURE:
+		case CSMSG_ACTIVATE_STRUCTURE_ABILITY:
+		case CSMSG_LAUNCH_DEATHHAND:
+		case CSMSG_ISSUE_UNIT_ACTION:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
 enum ClientServerMsg
 Net_Decode_ClientServerMsg(unsigned char c)
 {
@@ -162,3 +242,231 @@ Net_Decode_ServerClientMsg(unsigned char c)
 
 	return SCMSG_INVALID;
 }
+
+/*--------------------------------------------------------------*/
+
+/* Fields present in a structure record, most frequently changed first
+ * so that the mask usually fits in one byte.
+ */
+enum StructureDeltaField {
+	SDF_COUNTDOWN       = 1 << 0,
+	SDF_HITPOINTS       = 1 << 1,
+	SDF_FLAGS           = 1 << 2,
+	SDF_LINKED_ID       = 1 << 3,
+	SDF_OBJECT_TYPE     = 1 << 4,
+	SDF_BUILD_QUEUE     = 1 << 5,
+	SDF_UPGRADE_TIME    = 1 << 6,
+	SDF_TYPE            = 1 << 7,
+	SDF_HOUSE           = 1 << 8,
+	SDF_POSITION        = 1 << 9,
+	SDF_CREATOR_HOUSE   = 1 << 10,
+	SDF_ROTATION_SPRITE = 1 << 11,
+	SDF_UPGRADE_LEVEL   = 1 << 12,
+	SDF_RALLY_POINT     = 1 << 13
+};
+
+/* Fields present in a unit record. */
+enum UnitDeltaField {
+	UDF_POSITION        = 1 << 0,
+	UDF_ORIENTATION0    = 1 << 1,
+	UDF_ORIENTATION1    = 1 << 2,
+	UDF_HITPOINTS       = 1 << 3,
+	UDF_FLAGS           = 1 << 4,
+	UDF_ACTION          = 1 << 5,
+	UDF_SPRITE_OFFSET   = 1 << 6,
+	UDF_NEXT_ACTION     = 1 << 7,
+	UDF_WOBBLE_INDEX    = 1 << 8,
+	UDF_AMOUNT          = 1 << 9,
+	UDF_TYPE            = 1 << 10,
+	UDF_HOUSE           = 1 << 11,
+	UDF_DEVIATED        = 1 << 12,
+	UDF_DEVIATED_HOUSE  = 1 << 13,
+	UDF_BLINK_HOUSE     = 1 << 14
+};
+
+/**
+ * Encode the fields of d that differ from prev, the snapshot the
+ *  client last received.  The object index is encoded by the caller.
+ */
+void
+Net_Encode_StructureDelta(unsigned char **buf,
+		const StructureDelta *prev, const StructureDelta *d)
+{
+	uint32 mask = 0;
+	int queueChanges = 0;
+
+	for (int i = 0; i < OBJECTTYPE_MAX; i++) {
+		if (d->buildQueueCount[i] != prev->buildQueueCount[i])
+			queueChanges++;
+	}
+
+	if (d->countDown        != prev->countDown)         mask |= SDF_COUNTDOWN;
+	if (d->hitpoints        != prev->hitpoints)         mask |= SDF_HITPOINTS;
+	if (d->flags            != prev->flags)             mask |= SDF_FLAGS;
+	if (d->linkedID         != prev->linkedID)          mask |= SDF_LINKED_ID;
+	if (d->objectType       != prev->objectType)        mask |= SDF_OBJECT_TYPE;
+	if (queueChanges != 0)                              mask |= SDF_BUILD_QUEUE;
+	if (d->upgradeTime      != prev->upgradeTime)       mask |= SDF_UPGRADE_TIME;
+	if (d->type             != prev->type)              mask |= SDF_TYPE;
+	if (d->houseID          != prev->houseID)           mask |= SDF_HOUSE;
+	if (d->position.x != prev->position.x
+	 || d->position.y != prev->position.y)              mask |= SDF_POSITION;
+	if (d->creatorHouse     != prev->creatorHouse)      mask |= SDF_CREATOR_HOUSE;
+	if (d->rotationSprite   != prev->rotationSprite)    mask |= SDF_ROTATION_SPRITE;
+	if (d->upgradeLevel     != prev->upgradeLevel)      mask |= SDF_UPGRADE_LEVEL;
+	if (d->rallyPoint       != prev->rallyPoint)        mask |= SDF_RALLY_POINT;
+
+	Net_Encode_varint(buf, mask);
+
+	if (mask & SDF_COUNTDOWN)       Net_Encode_varint(buf, d->countDown);
+	if (mask & SDF_HITPOINTS)       Net_Encode_varint(buf, d->hitpoints);
+	if (mask & SDF_FLAGS)           Net_Encode_varint(buf, d->flags);
+	if (mask & SDF_LINKED_ID)       Net_Encode_uint8 (buf, d->linkedID);
+	if (mask & SDF_OBJECT_TYPE)     Net_Encode_uint8 (buf, d->objectType);
+
+	if (mask & SDF_BUILD_QUEUE) {
+		Net_Encode_varint(buf, queueChanges);
+
+		for (int i = 0; i < OBJECTTYPE_MAX; i++) {
+			if (d->buildQueueCount[i] == prev->buildQueueCount[i])
+				continue;
+
+			Net_Encode_uint8(buf, i);
+			Net_Encode_uint8(buf, d->buildQueueCount[i]);
+		}
+	}
+
+	if (mask & SDF_UPGRADE_TIME)    Net_Encode_uint8 (buf, d->upgradeTime);
+	if (mask & SDF_TYPE)            Net_Encode_uint8 (buf, d->type);
+	if (mask & SDF_HOUSE)           Net_Encode_uint8 (buf, d->houseID);
+
+	if (mask & SDF_POSITION) {
+		Net_Encode_CoordDelta(buf, prev->position.x, d->position.x);
+		Net_Encode_CoordDelta(buf, prev->position.y, d->position.y);
+	}
+
+	if (mask & SDF_CREATOR_HOUSE)   Net_Encode_uint8 (buf, d->creatorHouse);
+	if (mask & SDF_ROTATION_SPRITE) Net_Encode_varint(buf, d->rotationSprite);
+	if (mask & SDF_UPGRADE_LEVEL)   Net_Encode_uint8 (buf, d->upgradeLevel);
+	if (mask & SDF_RALLY_POINT)     Net_Encode_uint16(buf, d->rallyPoint);
+}
+
+/**
+ * Apply a record encoded by Net_Encode_StructureDelta to the snapshot d.
+ */
+void
+Net_Decode_StructureDelta(const unsigned char **buf, StructureDelta *d)
+{
+	const uint32 mask = Net_Decode_varint(buf);
+
+	if (mask & SDF_COUNTDOWN)       d->countDown    = Net_Decode_varint(buf);
+	if (mask & SDF_HITPOINTS)       d->hitpoints    = Net_Decode_varint(buf);
+	if (mask & SDF_FLAGS)           d->flags        = Net_Decode_varint(buf);
+	if (mask & SDF_LINKED_ID)       d->linkedID     = Net_Decode_uint8 (buf);
+	if (mask & SDF_OBJECT_TYPE)     d->objectType   = Net_Decode_uint8 (buf);
+
+	if (mask & SDF_BUILD_QUEUE) {
+		const uint32 count = Net_Decode_varint(buf);
+
+		for (uint32 i = 0; i < count; i++) {
+			const uint8 objectType = Net_Decode_uint8(buf);
+			const uint8 queueCount = Net_Decode_uint8(buf);
+
+			if (objectType < OBJECTTYPE_MAX)
+				d->buildQueueCount[objectType] = queueCount;
+		}
+	}
+
+	if (mask & SDF_UPGRADE_TIME)    d->upgradeTime  = Net_Decode_uint8 (buf);
+	if (mask & SDF_TYPE)            d->type         = Net_Decode_uint8 (buf);
+	if (mask & SDF_HOUSE)           d->houseID      = Net_Decode_uint8 (buf);
+
+	if (mask & SDF_POSITION) {
+		d->position.x = Net_Decode_CoordDelta(buf, d->position.x);
+		d->position.y = Net_Decode_CoordDelta(buf, d->position.y);
+	}
+
+	if (mask & SDF_CREATOR_HOUSE)   d->creatorHouse     = Net_Decode_uint8 (buf);
+	if (mask & SDF_ROTATION_SPRITE) d->rotationSprite   = Net_Decode_varint(buf);
+	if (mask & SDF_UPGRADE_LEVEL)   d->upgradeLevel     = Net_Decode_uint8 (buf);
+	if (mask & SDF_RALLY_POINT)     d->rallyPoint       = Net_Decode_uint16(buf);
+}
+
+/**
+ * Encode the fields of d that differ from prev, the snapshot the
+ *  client last received.  The object index is encoded by the caller.
+ */
+void
+Net_Encode_UnitDelta(unsigned char **buf,
+		const UnitDelta *prev, const UnitDelta *d)
+{
+	uint32 mask = 0;
+
+	if (d->position.x != prev->position.x
+	 || d->position.y != prev->position.y)                      mask |= UDF_POSITION;
+	if (d->orientation0_current != prev->orientation0_current)  mask |= UDF_ORIENTATION0;
+	if (d->orientation1_current != prev->orientation1_current)  mask |= UDF_ORIENTATION1;
+	if (d->hitpoints        != prev->hitpoints)                 mask |= UDF_HITPOINTS;
+	if (d->flags            != prev->flags)                     mask |= UDF_FLAGS;
+	if (d->actionID         != prev->actionID)                  mask |= UDF_ACTION;
+	if (d->spriteOffset     != prev->spriteOffset)              mask |= UDF_SPRITE_OFFSET;
+	if (d->nextActionID     != prev->nextActionID)              mask |= UDF_NEXT_ACTION;
+	if (d->wobbleIndex      != prev->wobbleIndex)               mask |= UDF_WOBBLE_INDEX;
+	if (d->amount           != prev->amount)                    mask |= UDF_AMOUNT;
+	if (d->type             != prev->type)                      mask |= UDF_TYPE;
+	if (d->houseID          != prev->houseID)                   mask |= UDF_HOUSE;
+	if (d->deviated         != prev->deviated)                  mask |= UDF_DEVIATED;
+	if (d->deviatedHouse    != prev->deviatedHouse)             mask |= UDF_DEVIATED_HOUSE;
+	if (d->blinkHouse       != prev->blinkHouse)                mask |= UDF_BLINK_HOUSE;
+
+	Net_Encode_varint(buf, mask);
+
+	if (mask & UDF_POSITION) {
+		Net_Encode_CoordDelta(buf, prev->position.x, d->position.x);
+		Net_Encode_CoordDelta(buf, prev->position.y, d->position.y);
+	}
+
+	if (mask & UDF_ORIENTATION0)    Net_Encode_uint8 (buf, d->orientation0_current);
+	if (mask & UDF_ORIENTATION1)    Net_Encode_uint8 (buf, d->orientation1_current);
+	if (mask & UDF_HITPOINTS)       Net_Encode_varint(buf, d->hitpoints);
+	if (mask & UDF_FLAGS)           Net_Encode_varint(buf, d->flags);
+	if (mask & UDF_ACTION)          Net_Encode_uint8 (buf, d->actionID);
+	if (mask & UDF_SPRITE_OFFSET)   Net_Encode_uint8 (buf, d->spriteOffset);
+	if (mask & UDF_NEXT_ACTION)     Net_Encode_uint8 (buf, d->nextActionID);
+	if (mask & UDF_WOBBLE_INDEX)    Net_Encode_uint8 (buf, d->wobbleIndex);
+	if (mask & UDF_AMOUNT)          Net_Encode_uint8 (buf, d->amount);
+	if (mask & UDF_TYPE)            Net_Encode_uint8 (buf, d->type);
+	if (mask & UDF_HOUSE)           Net_Encode_uint8 (buf, d->houseID);
+	if (mask & UDF_DEVIATED)        Net_Encode_uint8 (buf, d->deviated);
+	if (mask & UDF_DEVIATED_HOUSE)  Net_Encode_uint8 (buf, d->deviatedHouse);
+	if (mask & UDF_BLINK_HOUSE)     Net_Encode_uint8 (buf, d->blinkHouse);
+}
+
+/**
+ * Apply a record encoded by Net_Encode_UnitDelta to the snapshot d.
+ */
+void
+Net_Decode_UnitDelta(const unsigned char **buf, UnitDelta *d)
+{
+	const uint32 mask = Net_Decode_varint(buf);
+
+	if (mask & UDF_POSITION) {
+		d->position.x = Net_Decode_CoordDelta(buf, d->position.x);
+		d->position.y = Net_Decode_CoordDelta(buf, d->position.y);
+	}
+
+	if (mask & UDF_ORIENTATION0)    d->orientation0_current = Net_Decode_uint8 (buf);
+	if (mask & UDF_ORIENTATION1)    d->orientation1_current = Net_Decode_uint8 (buf);
+	if (mask & UDF_HITPOINTS)       d->hitpoints        = Net_Decode_varint(buf);
+	if (mask & UDF_FLAGS)           d->flags            = Net_Decode_varint(buf);
+	if (mask & UDF_ACTION)          d->actionID         = Net_Decode_uint8 (buf);
+	if (mask & UDF_SPRITE_OFFSET)   d->spriteOffset     = Net_Decode_uint8 (buf);
+	if (mask & UDF_NEXT_ACTION)     d->nextActionID     = Net_Decode_uint8 (buf);
+	if (mask & UDF_WOBBLE_INDEX)    d->wobbleIndex      = Net_Decode_uint8 (buf);
+	if (mask & UDF_AMOUNT)          d->amount           = Net_Decode_uint8 (buf);
+	if (mask & UDF_TYPE)            d->type             = Net_Decode_uint8 (buf);
+	if (mask & UDF_HOUSE)           d->houseID          = Net_Decode_uint8 (buf);
+	if (mask & UDF_DEVIATED)        d->deviated         = Net_Decode_uint8 (buf);
+	if (mask & UDF_DEVIATED_HOUSE)  d->deviatedHouse    = Net_Decode_uint8 (buf);
+	if (mask & UDF_BLINK_HOUSE)     d->blinkHouse       = Net_Decode_uint8 (buf);
+}
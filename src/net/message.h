@@ -3,6 +3,7 @@
 
 #include "enumeration.h"
 #include "types.h"
+#include "../buildqueue.h"
 
 enum {
 	MAX_SERVER_BROADCAST_MESSAGE_LEN = 32768,
@@ -23,6 +24,9 @@ enum ClientServerMsg {
 	CSMSG_ACTIVATE_STRUCTURE_ABILITY,
 	CSMSG_LAUNCH_DEATHHAND,
 	CSMSG_ISSUE_UNIT_ACTION,
+	CSMSG_SET_VIEWPORT,
+	CSMSG_LOCKSTEP_TURN,
+	CSMSG_WORLD_HASH,
 
 	CSMSG_PREFERRED_NAME,
 	CSMSG_PREFERRED_HOUSE,
@@ -56,11 +60,60 @@ enum ServerClientMsg {
 	SCMSG_SCENARIO,
 	SCMSG_START_GAME,
 	SCMSG_CHAT,
+	SCMSG_LOCKSTEP_TURN,
 
 	SCMSG_MAX,
 	SCMSG_INVALID
 };
 
+/* Snapshot of the networked fields of a structure.  Records on the
+ * wire only carry the fields that differ from the previous snapshot.
+ */
+typedef struct StructureDelta {
+	uint8       type;
+	uint8       linkedID;
+	uint32      flags;
+	uint8       houseID;
+	tile32      position;
+	uint16      hitpoints;
+
+	uint8       creatorHouse;
+	uint16      rotationSprite;
+	uint8       objectType;
+	uint8       upgradeLevel;
+	uint8       upgradeTime;
+	uint16      countDown;
+	uint16      rallyPoint;
+
+	uint8       buildQueueCount[OBJECTTYPE_MAX];
+} StructureDelta;
+
+/* Snapshot of the networked fields of a unit. */
+typedef struct UnitDelta {
+	uint8   type;
+	uint32  flags;
+	uint8   houseID;
+	tile32  position;
+	uint16  hitpoints;
+
+	uint8   actionID;
+	uint8   nextActionID;
+	uint8   amount;
+	uint8   deviated;
+	uint8   deviatedHouse;
+	int8    orientation0_current;
+	int8    orientation1_current;
+	uint8   wobbleIndex;
+	uint8   spriteOffset;
+	uint8   blinkHouse;
+} UnitDelta;
+
+enum {
+	/* Longest encoded records, including the object index. */
+	NET_STRUCTURE_DELTA_MAX_LEN = 2 + 2 + 1 + 1 + 5 + 1 + 3 + 3 + 3 + 1 + 3 + 1 + 1 + 1 + 3 + 2 + (1 + 2 * OBJECTTYPE_MAX),
+	NET_UNIT_DELTA_MAX_LEN = 2 + 3 + 1 + 5 + 1 + 3 + 3 + 3 + 10
+};
+
 struct Object;
 
 extern unsigned char g_server_broadcast_message_buf[MAX_SERVER_BROADCAST_MESSAGE_LEN];
@@ -76,12 +129,21 @@ extern uint16 Net_Decode_uint16(const unsigned char **buf);
 extern void   Net_Encode_uint32(unsigned char **buf, uint32 val);
 extern uint32 Net_Decode_uint32(const unsigned char **buf);
 
+extern void   Net_Encode_varint(unsigned char **buf, uint32 val);
+extern uint32 Net_Decode_varint(const unsigned char **buf);
+
 extern void   Net_Encode_ObjectIndex(unsigned char **buf, const struct Object *o);
 extern uint16 Net_Decode_ObjectIndex(const unsigned char **buf);
 
+extern void Net_Encode_StructureDelta(unsigned char **buf, const StructureDelta *prev, const StructureDelta *d);
+extern void Net_Decode_StructureDelta(const unsigned char **buf, StructureDelta *d);
+extern void Net_Encode_UnitDelta(unsigned char **buf, const UnitDelta *prev, const UnitDelta *d);
+extern void Net_Decode_UnitDelta(const unsigned char **buf, UnitDelta *d);
+
 extern int Net_GetLength_ClientServerMsg(enum ClientServerMsg msg);
 extern void Net_Encode_ClientServerMsg(unsigned char **buf, enum ClientServerMsg msg);
 extern enum ClientServerMsg Net_Decode_ClientServerMsg(unsigned char c);
+extern bool Net_IsCommand_ClientServerMsg(enum ClientServerMsg msg);
 
 extern void Net_Encode_ServerClientMsg(unsigned char **buf, enum ServerClientMsg msg);
 extern enum ServerClientMsg Net_Decode_ServerClientMsg(unsigned char c);
@@ -17,7 +17,10 @@ enum {
 	MAX_CHAT_LEN = 60,
 	MAX_ADDR_LEN = 1023,
 	MAX_PORT_LEN = 5,
-	DEFAULT_PORT = 10700
+	DEFAULT_PORT = 10700,
+
+	NET_PROTOCOL_VERSION = 5,   /* Sent when connecting; bump when messages change. */
+	NET_CONNECT_COMPRESSION = 0x10000   /* Added to the version by clients that can decompress. */
 };
 
 #define DEFAULT_PORT_STR "10700"
@@ -40,6 +43,7 @@ typedef struct PeerData {
 	int id;
 	void *peer;
 	char name[MAX_NAME_LEN + 1];
+	bool compression;
 } PeerData;
 
 extern char g_net_name[MAX_NAME_LEN + 1];
@@ -48,6 +52,8 @@ extern char g_host_port[MAX_PORT_LEN + 1];
 extern char g_join_addr[MAX_ADDR_LEN + 1];
 extern char g_join_port[MAX_PORT_LEN + 1];
 extern char g_chat_buf[MAX_CHAT_LEN + 1];
+extern bool g_net_compression;
+extern bool g_net_lockstep;
 
 extern bool g_sendClientList;
 extern bool g_sendScenario;
@@ -80,5 +86,7 @@ extern void Server_DisconnectClient(PeerData *data);
 extern void Server_RecvMessages(void);
 extern void Client_SendMessages(void);
 extern enum NetEvent Client_RecvMessages(void);
+extern void Server_Send_LockstepTurn(enum HouseType houseID, uint32 tick, const unsigned char *buf, int len);
+extern void Client_Send_LockstepTurn(uint32 tick, const unsigned char *buf, int len);
 
 #endif
@@ -8,6 +8,7 @@
 #include "net.h"
 
 #include "client.h"
+#include "lockstep.h"
 #include "message.h"
 #include "server.h"
 #include "../audio/audio.h"
@@ -32,6 +33,8 @@ char g_host_port[MAX_PORT_LEN + 1] = DEFAULT_PORT_STR;
 char g_join_addr[MAX_ADDR_LEN + 1] = "localhost";
 char g_join_port[MAX_PORT_LEN + 1] = DEFAULT_PORT_STR;
 char g_chat_buf[MAX_CHAT_LEN + 1];
+bool g_net_compression = true;
+bool g_net_lockstep = false;
 
 bool g_sendClientList;
 bool g_sendScenario;
@@ -39,12 +42,61 @@ enum HouseFlag g_client_houses;
 enum NetHostType g_host_type;
 static ENetHost *s_enet_host;
 static ENetPeer *s_enet_peer;
+static bool s_compress_outgoing;
 
 int g_local_client_id;
 PeerData g_peer_data[MAX_CLIENTS];
 
 /*--------------------------------------------------------------*/
 
+/**
+ * ENet's range coder, except that outgoing packets are only compressed
+ *  once every peer has said that it can decompress them.
+ */
+static size_t
+Net_Compress(void *context, const ENetBuffer *inBuffers, size_t inBufferCount,
+		size_t inLimit, enet_uint8 *outData, size_t outLimit)
+{
+	if (!s_compress_outgoing)
+		return 0;
+
+	return enet_range_coder_compress(context, inBuffers, inBufferCount,
+			inLimit, outData, outLimit);
+}
+
+static void
+Net_InstallCompressor(ENetHost *host)
+{
+	ENetCompressor compressor;
+
+	compressor.context = enet_range_coder_create();
+	if (compressor.context == NULL)
+		return;
+
+	compressor.compress = Net_Compress;
+	compressor.decompress = enet_range_coder_decompress;
+	compressor.destroy = enet_range_coder_destroy;
+
+	enet_host_compress(host, &compressor);
+}
+
+static void
+Server_UpdateCompression(void)
+{
+	bool compress = g_net_compression;
+
+	for (int i = 0; i < MAX_CLIENTS; i++) {
+		const PeerData *data = &g_peer_data[i];
+
+		if (data->peer != NULL && !data->compression)
+			compress = false;
+	}
+
+	s_compress_outgoing = compress;
+}
+
+/*--------------------------------------------------------------*/
+
 static PeerData *
 Net_NewPeerData(int peerID)
 {
@@ -55,6 +107,7 @@ Net_NewPeerData(int peerID)
 			data->state = CLIENTSTATE_IN_LOBBY;
 			data->id = peerID;
 			data->name[0] = '\0';
+			data->compression = false;
 			return data;
 		}
 	}
@@ -173,6 +226,9 @@ Net_CreateServer(const char *addr, int port, const char *name)
 		if (s_enet_host == NULL)
 			goto error_host_create;
 
+		Net_InstallCompressor(s_enet_host);
+		s_compress_outgoing = g_net_compression;
+
 		ChatBox_ClearHistory();
 		ChatBox_AddLog(CHATTYPE_LOG, "Server created");
 
@@ -206,7 +262,16 @@ Net_ConnectToServer(const char *hostname, int port, const char *name)
 		if (s_enet_host == NULL)
 			goto error_host_create;
 
-		s_enet_peer = enet_host_connect(s_enet_host, &address, 2, 0);
+		/* Server packets are decompressed if the server chose to
+		 * compress them; ours are too small to bother.
+		 */
+		Net_InstallCompressor(s_enet_host);
+		s_compress_outgoing = false;
+
+		const enet_uint32 connect_data = NET_PROTOCOL_VERSION
+			| (g_net_compression ? NET_CONNECT_COMPRESSION : 0);
+
+		s_enet_peer = enet_host_connect(s_enet_host, &address, 2, connect_data);
 		if (s_enet_peer == NULL)
 			goto error_host_connect;
 
@@ -362,28 +427,33 @@ Net_Synchronise(void)
 		assert(g_playerHouse != NULL);
 	}
 
+	/* Lockstep clients also keep track of who is playing. */
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		g_multiplayer.state[h] = (g_multiplayer.client[h] == 0)
+			? MP_HOUSE_UNUSED : MP_HOUSE_PLAYING;
+	}
+
 	if (g_host_type == HOSTTYPE_DEDICATED_SERVER
 	 || g_host_type == HOSTTYPE_CLIENT_SERVER) {
 		Server_ResetCache();
 
 		for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
-			if (g_multiplayer.client[h] == 0) {
-				g_multiplayer.state[h] = MP_HOUSE_UNUSED;
-			} else {
-				PeerData *data = Net_GetPeerData(g_multiplayer.client[h]);
+			if (g_multiplayer.client[h] == 0)
+				continue;
 
-				data->state = CLIENTSTATE_IN_GAME;
-				g_multiplayer.state[h] = MP_HOUSE_PLAYING;
+			PeerData *data = Net_GetPeerData(g_multiplayer.client[h]);
+			data->state = CLIENTSTATE_IN_GAME;
 
-				if (g_multiplayer.client[h] != g_local_client_id)
-					g_client_houses |= (1 << h);
-			}
+			if (g_multiplayer.client[h] != g_local_client_id)
+				g_client_houses |= (1 << h);
 		}
-	} else {
-		Client_ResetCache();
 	}
 
+	if (g_host_type != HOSTTYPE_DEDICATED_SERVER)
+		Client_ResetCache();
+
 	Multiplayer_GenerateMap(MAP_GENERATOR_FINAL);
+	Lockstep_Start(g_net_lockstep);
 }
 
 /*--------------------------------------------------------------*/
@@ -482,10 +552,14 @@ Server_SendMessages(void)
 		}
 	}
 
+	/* Lockstep clients run the game themselves. */
+	if (Lockstep_IsRelaying()) {
+		memset(g_server2client_message_len, 0, sizeof(g_server2client_message_len));
+		return;
+	}
+
 	Server_Send_UpdateCHOAM(&buf);
 	Server_Send_UpdateLandscape(&buf);
-	Server_Send_UpdateStructures(&buf);
-	Server_Send_UpdateUnits(&buf);
 	Server_Send_UpdateExplosions(&buf);
 
 	unsigned char * const buf_start_client_specific = buf;
@@ -498,6 +572,8 @@ Server_SendMessages(void)
 
 		Server_Send_UpdateHouse(houseID, &buf);
 		Server_Send_UpdateFogOfWar(houseID, &buf);
+		Server_Send_UpdateStructures(houseID, &buf);
+		Server_Send_UpdateUnits(houseID, &buf);
 
 		if ((g_server2client_message_len[houseID] > 0)
 				&& (buf + g_server2client_message_len[houseID]
@@ -555,10 +631,18 @@ Server_Recv_ConnectClient(ENetEvent *event)
 	if (g_inGame)
 		goto error;
 
+	if ((event->data & ~NET_CONNECT_COMPRESSION) != NET_PROTOCOL_VERSION) {
+		NET_LOG("Client uses protocol version %u, expected %d.",
+				event->data & ~NET_CONNECT_COMPRESSION, NET_PROTOCOL_VERSION);
+		goto error;
+	}
+
 	PeerData *data = Server_NewClient();
 	if (data != NULL) {
 		event->peer->data = data;
 		data->peer = event->peer;
+		data->compression = (event->data & NET_CONNECT_COMPRESSION) != 0;
+		Server_UpdateCompression();
 
 		Server_Send_ClientID(event->peer);
 		lobby_map_generator_mode = MAP_GENERATOR_TRY_TEST_ELSE_RAND;
@@ -577,8 +661,13 @@ Server_DisconnectClient(PeerData *data)
 
 	snprintf(chat_log, sizeof(chat_log), "%s left", data->name);
 
-	if (data->state == CLIENTSTATE_IN_GAME)
-		Server_Recv_ReturnToLobby(Net_GetClientHouse(data->id), false);
+	if (data->state == CLIENTSTATE_IN_GAME) {
+		if (Lockstep_IsRelaying()) {
+			Lockstep_Server_DropHouse(Net_GetClientHouse(data->id));
+		} else {
+			Server_Recv_ReturnToLobby(Net_GetClientHouse(data->id), false);
+		}
+	}
 
 	Server_Recv_PrefHouse(data->id, HOUSE_INVALID);
 	enet_peer_disconnect(data->peer, 0);
@@ -587,6 +676,7 @@ Server_DisconnectClient(PeerData *data)
 	data->state = CLIENTSTATE_UNUSED;
 	data->id = 0;
 	data->peer = NULL;
+	Server_UpdateCompression();
 
 	lobby_map_generator_mode = MAP_GENERATOR_TRY_TEST_ELSE_RAND;
 	g_sendClientList = true;
@@ -613,9 +703,11 @@ Server_RecvMessages(void)
 	if (g_host_type == HOSTTYPE_DEDICATED_CLIENT)
 		return;
 
-	/* Process the local player's commands. */
+	/* Process the local player's commands.  In lockstep games,
+	 * Lockstep_NextTurn sends them instead.
+	 */
 	if (g_host_type == HOSTTYPE_NONE
-	 || g_host_type == HOSTTYPE_CLIENT_SERVER) {
+	 || (g_host_type == HOSTTYPE_CLIENT_SERVER && !Lockstep_IsRunning())) {
 		Server_ProcessMessage(g_local_client_id, g_playerHouseID,
 				g_client2server_message_buf, g_client2server_message_len);
 		g_client2server_message_len = 0;
@@ -632,8 +724,15 @@ Server_RecvMessages(void)
 					ENetPacket *packet = event.packet;
 					const PeerData *data = event.peer->data;
 					const enum HouseType houseID = Net_GetClientHouse(data->id);
-					Server_ProcessMessage(data->id, houseID,
-							packet->data, packet->dataLength);
+
+					if (Lockstep_IsRelaying() && data->state == CLIENTSTATE_IN_GAME) {
+						Lockstep_Server_Recv(data->id, houseID,
+								packet->data, packet->dataLength);
+					} else {
+						Server_ProcessMessage(data->id, houseID,
+								packet->data, packet->dataLength);
+					}
+
 					enet_packet_destroy(packet);
 				}
 				break;
@@ -675,6 +774,62 @@ Client_SendMessages(void)
 	g_client2server_message_len = 0;
 }
 
+void
+Server_Send_LockstepTurn(enum HouseType houseID, uint32 tick,
+		const unsigned char *src, int len)
+{
+	unsigned char buf[1 + 1 + 4 + 2 + LOCKSTEP_MAX_TURN_LEN];
+	unsigned char *p = buf;
+
+	assert(len <= LOCKSTEP_MAX_TURN_LEN);
+
+	Net_Encode_ServerClientMsg(&p, SCMSG_LOCKSTEP_TURN);
+	Net_Encode_uint8(&p, houseID);
+	Net_Encode_uint32(&p, tick);
+	Net_Encode_uint16(&p, len);
+	memcpy(p, src, len);
+	p += len;
+
+	ENetPacket *packet
+		= enet_packet_create(buf, p - buf, ENET_PACKET_FLAG_RELIABLE);
+
+	/* The house's own client already has its commands. */
+	for (int i = 0; i < MAX_CLIENTS; i++) {
+		const PeerData *data = &g_peer_data[i];
+		ENetPeer *peer = data->peer;
+
+		if (peer == NULL
+				|| data->state != CLIENTSTATE_IN_GAME
+				|| Net_GetClientHouse(data->id) == houseID)
+			continue;
+
+		enet_peer_send(peer, 0, packet);
+	}
+
+	if (packet->referenceCount == 0)
+		enet_packet_destroy(packet);
+}
+
+void
+Client_Send_LockstepTurn(uint32 tick, const unsigned char *src, int len)
+{
+	unsigned char buf[1 + 4 + 2 + LOCKSTEP_MAX_TURN_LEN];
+	unsigned char *p = buf;
+
+	assert(len <= LOCKSTEP_MAX_TURN_LEN);
+
+	Net_Encode_ClientServerMsg(&p, CSMSG_LOCKSTEP_TURN);
+	Net_Encode_uint32(&p, tick);
+	Net_Encode_uint16(&p, len);
+	memcpy(p, src, len);
+	p += len;
+
+	ENetPacket *packet
+		= enet_packet_create(buf, p - buf, ENET_PACKET_FLAG_RELIABLE);
+
+	enet_peer_send(s_enet_peer, 0, packet);
+}
+
 enum NetEvent
 Client_RecvMessages(void)
 {
@@ -710,5 +865,11 @@ Client_RecvMessages(void)
 		}
 	}
 
+	/* Lockstep clients update their house themselves, like the host. */
+	if (Lockstep_IsRunning()) {
+		House_Client_UpdateRadarState();
+		Client_ChangeSelectionMode();
+	}
+
 	return ret;
 }
@@ -15,6 +15,7 @@
 #include "message.h"
 #include "net.h"
 #include "../audio/audio.h"
+#include "../config.h"
 #include "../enhancement.h"
 #include "../explosion.h"
 #include "../newui/actionpanel.h"
@@ -27,9 +28,11 @@
 #include "../newui/menubar.h"
 #include "../newui/viewport.h"
 #include "../opendune.h"
+#include "../pathfinder.h"
 #include "../pool/pool_house.h"
 #include "../pool/pool_structure.h"
 #include "../pool/pool_unit.h"
+#include "../replay.h"
 #include "../shape.h"
 #include "../string.h"
 #include "../structure.h"
@@ -38,6 +41,7 @@
 #include "../tools/encoded_index.h"
 #include "../tools/random_starport.h"
 #include "../unit.h"
+#include "../worldhash.h"
 
 #if 0
 #define SERVER_LOG(FORMAT,...)	\
@@ -46,50 +50,73 @@
 #define SERVER_LOG(...)
 #endif
 
-typedef struct StructureDelta {
-	uint8       type;
-	uint8       linkedID;
-	ObjectFlags flags;
-	uint8       houseID;
-	tile32      position;
-	uint16      hitpoints;
-
-	uint8       creatorHouse;
-	uint16      rotationSprite;
-	uint8       objectType;
-	uint8       upgradeLevel;
-	uint8       upgradeTime;
-	uint16      countDown;
-	uint16      rallyPoint;
-
-	uint8       buildQueueCount[OBJECTTYPE_MAX];
-} StructureDelta;
-
-typedef struct UnitDelta {
-	uint8   type;
-	ObjectFlags flags;
-	uint8   houseID;
-	tile32  position;
-	uint16  hitpoints;
-
-	uint8   actionID;
-	uint8   nextActionID;
-	uint8   amount;
-	uint8   deviated;
-	uint8   deviatedHouse;
-	int8    orientation0_current;
-	int8    orientation1_current;
-	uint8   wobbleIndex;
-	uint8   spriteOffset;
-	uint8   blinkHouse;
-} UnitDelta;
-
 static Tile s_mapCopy[MAP_SIZE_MAX * MAP_SIZE_MAX];
+static MapJournalCursor s_mapCursor;
 static int64_t s_choamLastUpdate;
-static StructureDelta s_structureCopy[STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT];
-static UnitDelta s_unitCopy[UNIT_INDEX_MAX_RAISED];
 static int s_explosionLastCount;
 
+/* Each house is sent its own view of the units and structures.  The
+ * copies hold what was last sent to the house's client.
+ */
+static StructureDelta s_structureCopy[HOUSE_NEUTRAL][STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT];
+static UnitDelta s_unitCopy[HOUSE_NEUTRAL][UNIT_INDEX_MAX_RAISED];
+
+/* Pool generations of the objects when last compared against the
+ * copies above.  Objects whose generation has not changed are skipped,
+ * except those that have come into or gone out of the house's sight,
+ * so every write to a field carried in the deltas must mark the object.
+ */
+enum {
+	SERVER_ALLIED_UPDATE_INTERVAL = 4
+};
+
+/* What a house is sent of an object: its state, its absence, or
+ * nothing so that the house keeps what it last saw.
+ */
+enum ServerVisibility {
+	SERVER_VISIBILITY_KEEP,
+	SERVER_VISIBILITY_SEND,
+	SERVER_VISIBILITY_HIDE
+};
+
+static uint32 s_structureGeneration[HOUSE_NEUTRAL][STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT];
+static uint32 s_unitGeneration[HOUSE_NEUTRAL][UNIT_INDEX_MAX_RAISED];
+static uint8 s_structureVisible[HOUSE_NEUTRAL][STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT];
+static uint8 s_unitVisible[HOUSE_NEUTRAL][UNIT_INDEX_MAX_RAISED];
+static int s_updates[HOUSE_NEUTRAL];
+
+/* When the changed objects do not all fit in the buffer, they are sent
+ * in order of priority.  An object's priority grows with each update
+ * it has been left waiting, so nothing starves.
+ */
+enum {
+	SERVER_PRIORITY_COMBAT  = 64,
+	SERVER_PRIORITY_OWNED   = 32,
+	SERVER_PRIORITY_NEARBY  = 32,
+	SERVER_PRIORITY_WAITING = 4
+};
+
+typedef struct ServerPending {
+	uint16 index;
+	uint16 priority;
+	uint8 visible;                      /*!< Stored once the record is written. */
+} ServerPending;
+
+static uint16 s_viewport[HOUSE_NEUTRAL];
+static uint16 s_structureWaiting[HOUSE_NEUTRAL][STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT];
+static uint16 s_unitWaiting[HOUSE_NEUTRAL][UNIT_INDEX_MAX_RAISED];
+static ServerPending s_pending[UNIT_INDEX_MAX_RAISED];
+
+/* World hashes reported by lockstep clients, waiting to be compared
+ * with our own once we have reached the same tick.
+ */
+static struct {
+	bool pending;
+	uint32 tick;
+	uint32 hash;
+} s_worldHash[HOUSE_NEUTRAL];
+static enum HouseFlag s_desyncHouses;
+
 static void Server_ReturnToLobbyNow(bool win);
 
 /*--------------------------------------------------------------*/
@@ -144,6 +171,104 @@ Server_MaxElementsToEncode(unsigned char **buf,
 	}
 }
 
+/**
+ * Returns true if the house can currently see the tile, and so any
+ *  unit on it.
+ */
+static bool
+Server_IsTileVisible(enum HouseType houseID, uint16 packed)
+{
+	if (!Map_IsPositionUnveiled(houseID, packed))
+		return false;
+
+	return !enhancement_fog_of_war || !Map_HasFogTimedOut(houseID, packed);
+}
+
+static bool
+Server_IsStructureVisible(enum HouseType houseID, uint8 type, tile32 position)
+{
+	if (type >= STRUCTURE_MAX)
+		return false;
+
+	const enum StructureLayout layout = g_table_structureInfo[type].layout;
+	const uint16 packed = Tile_PackTile(position);
+
+	for (int i = 0; i < g_table_structure_layoutTileCount[layout]; i++) {
+		if (Server_IsTileVisible(houseID, packed + g_table_structure_layoutTiles[layout][i]))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Returns false for allied objects on the updates between their coarse
+ *  refreshes.
+ */
+static bool
+Server_IsDueForHouse(enum HouseType houseID, enum HouseType ownerID, int index)
+{
+	if (ownerID == houseID)
+		return true;
+
+	return (s_updates[houseID] + index) % SERVER_ALLIED_UPDATE_INTERVAL == 0;
+}
+
+/**
+ * Priority bonus for an object at the given tile, falling off with the
+ *  distance to the house's viewport.
+ */
+static int
+Server_GetViewportPriority(enum HouseType houseID, uint16 packed)
+{
+	if (s_viewport[houseID] == 0xFFFF)
+		return 0;
+
+	const int dist = Tile_GetDistancePacked(s_viewport[houseID], packed);
+	return max(SERVER_PRIORITY_NEARBY - dist, 0);
+}
+
+static int
+Server_GetPriority(enum HouseType houseID, const Object *o,
+		enum HouseType ownerID, bool combat, uint16 waiting)
+{
+	int priority = Server_GetViewportPriority(houseID, Tile_PackTile(o->position));
+
+	if (combat) {
+		priority += SERVER_PRIORITY_COMBAT;
+	} else if (ownerID == houseID) {
+		priority += SERVER_PRIORITY_OWNED;
+	}
+
+	priority += SERVER_PRIORITY_WAITING * waiting;
+	return min(priority, 0xFFFF);
+}
+
+static int
+Server_ComparePending(const void *a, const void *b)
+{
+	const ServerPending *pa = a;
+	const ServerPending *pb = b;
+
+	if (pa->priority != pb->priority)
+		return (pa->priority > pb->priority) ? -1 : 1;
+
+	return pa->index - pb->index;
+}
+
+/**
+ * Sort the pending objects by priority, unless they will all fit in
+ *  the buffer anyway.
+ */
+static void
+Server_SchedulePending(unsigned char **buf, int count, size_t element_len)
+{
+	if (Server_MaxElementsToEncode(buf, 0, element_len) >= min(count, 0xFF))
+		return;
+
+	qsort(s_pending, count, sizeof(s_pending[0]), Server_ComparePending);
+}
+
 static void
 Server_InitStructureDelta(const Structure *s, StructureDelta *d)
 {
@@ -153,7 +278,7 @@ Server_InitStructureDelta(const Structure *s, StructureDelta *d)
 
 	d->type         = o->type;
 	d->linkedID     = o->linkedID;
-	d->flags        = o->flags;
+	d->flags        = o->flags.all;
 	d->houseID      = o->houseID;
 	d->position     = o->position;
 	d->hitpoints    = o->hitpoints;
@@ -180,7 +305,7 @@ Server_InitUnitDelta(const Unit *u, UnitDelta *d)
 	memset(d, 0, sizeof(UnitDelta));
 
 	d->type         = o->type;
-	d->flags.all    = o->flags.all;
+	d->flags        = o->flags.all;
 	d->houseID      = o->houseID;
 	d->position     = o->position;
 	d->hitpoints    = o->hitpoints;
@@ -197,6 +322,34 @@ Server_InitUnitDelta(const Unit *u, UnitDelta *d)
 	d->blinkHouse		   	= u->blinkHouse;
 }
 
+/**
+ * The state to send of a structure, or the last sent state marked
+ *  unused to hide it.
+ */
+static void
+Server_InitStructureVisibleDelta(const Structure *s, enum ServerVisibility visible,
+		const StructureDelta *copy, StructureDelta *d)
+{
+	if (visible == SERVER_VISIBILITY_SEND) {
+		Server_InitStructureDelta(s, d);
+	} else {
+		*d = *copy;
+		d->flags = 0;
+	}
+}
+
+static void
+Server_InitUnitVisibleDelta(const Unit *u, enum ServerVisibility visible,
+		const UnitDelta *copy, UnitDelta *d)
+{
+	if (visible == SERVER_VISIBILITY_SEND) {
+		Server_InitUnitDelta(u, d);
+	} else {
+		*d = *copy;
+		d->flags = 0;
+	}
+}
+
 void
 Server_ResetCache(void)
 {
@@ -208,10 +361,31 @@ Server_ResetCache(void)
 	}
 
 	memset(s_mapCopy, 0, sizeof(s_mapCopy));
+	Map_Journal_ResetCursor(&s_mapCursor);
 	memset(s_structureCopy, 0, sizeof(s_structureCopy));
 	memset(s_unitCopy, 0, sizeof(s_unitCopy));
+	memset(s_structureVisible, 0, sizeof(s_structureVisible));
+	memset(s_unitVisible, 0, sizeof(s_unitVisible));
+	memset(s_structureWaiting, 0, sizeof(s_structureWaiting));
+	memset(s_unitWaiting, 0, sizeof(s_unitWaiting));
+
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		s_viewport[h] = 0xFFFF;
+		s_updates[h] = 0;
+
+		for (int i = 0; i < STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT; i++) {
+			s_structureGeneration[h][i] = StructurePool_GetGeneration(i) - 1;
+		}
+
+		for (int i = 0; i < UNIT_INDEX_MAX_RAISED; i++) {
+			s_unitGeneration[h][i] = UnitPool_GetGeneration(i) - 1;
+		}
+	}
 	s_choamLastUpdate = 0;
 	s_explosionLastCount = 0;
+
+	memset(s_worldHash, 0, sizeof(s_worldHash));
+	s_desyncHouses = 0;
 }
 
 /*--------------------------------------------------------------*/
@@ -230,10 +404,14 @@ Server_Send_UpdateLandscape(unsigned char **buf)
 
 	unsigned char *buf_count = *buf; (*buf) += 2;
 	uint16 count = 0;
+	uint16 packed;
+
+	/* Tiles left over when the buffer fills stay in the journal. */
+	while (count < max
+			&& (packed = Map_Journal_Next(&s_mapCursor)) != MAP_JOURNAL_END) {
+		if (packed < 65 || packed >= MAP_SIZE_MAX * MAP_SIZE_MAX - 65)
+			continue;
 
-	for (uint16 packed = 65;
-			packed < MAP_SIZE_MAX * MAP_SIZE_MAX - 65 && count < max;
-			packed++) {
 		Tile d = g_map[packed];
 		d.hasAnimation = 0;
 		d.hasExplosion = 0;
@@ -277,16 +455,16 @@ Server_Send_UpdateFogOfWar(enum HouseType houseID, unsigned char **buf)
 	for (uint16 packed = 65;
 			packed < MAP_SIZE_MAX * MAP_SIZE_MAX - 65 && count < max;
 			packed++) {
-		FogOfWarTile *f = &g_mapVisible[packed];
+		uint8 *cause = &g_mapFog[houseID].cause[packed];
 
-		if (f->cause[houseID] == UNVEILCAUSE_UNCHANGED)
+		if (*cause == UNVEILCAUSE_UNCHANGED)
 			continue;
 
-		if (f->cause[houseID] < UNVEILCAUSE_STRUCTURE_VISION) {
+		if (*cause < UNVEILCAUSE_STRUCTURE_VISION) {
 			uint16 encoded = packed;
 
 			/* Short unveil. */
-			if (f->cause[houseID] == UNVEILCAUSE_EXPLOSION)
+			if (*cause == UNVEILCAUSE_EXPLOSION)
 				encoded |= 0x8000;
 
 			Net_Encode_uint16(buf, encoded);
@@ -294,7 +472,7 @@ Server_Send_UpdateFogOfWar(enum HouseType houseID, unsigned char **buf)
 			count++;
 		}
 
-		f->cause[houseID] = UNVEILCAUSE_UNCHANGED;
+		*cause = UNVEILCAUSE_UNCHANGED;
 	}
 
 	SERVER_LOG("unveiled tiles=%d, %lu bytes",
@@ -354,14 +532,17 @@ Server_Send_UpdateCHOAM(unsigned char **buf)
 	s_choamLastUpdate = g_tickHouseStarportRecalculatePrices;
 }
 
+/**
+ * Send the structures the house can see: its own and its allies',
+ *  and enemy structures it has seen while they are in sight.  Enemy
+ *  structures out of sight keep the state the house last saw.
+ */
 void
-Server_Send_UpdateStructures(unsigned char **buf)
+Server_Send_UpdateStructures(enum HouseType houseID, unsigned char **buf)
 {
-	const size_t header_len  = 1 + 1;
-	const size_t element_len = 2 + 13 + 10 + OBJECTTYPE_MAX;
-	const int max = Server_MaxElementsToEncode(buf, header_len, element_len);
+	const size_t header_len = 1 + 1;
 
-	if (max <= 0)
+	if (!Server_CanEncodeFixedWidthBuffer(buf, header_len + NET_STRUCTURE_DELTA_MAX_LEN))
 		return;
 
 	Net_Encode_ServerClientMsg(buf, SCMSG_UPDATE_STRUCTURES);
@@ -369,60 +550,114 @@ Server_Send_UpdateStructures(unsigned char **buf)
 	unsigned char *buf_count = *buf; (*buf) += 1;
 	uint8 count = 0;
 
-	for (int i = 0;
-			i < StructurePool_GetIndex(STRUCTURE_INDEX_MAX_HARD) && count < max;
-			i++) {
+	StructureDelta *copy = s_structureCopy[houseID];
+	uint32 *lastGeneration = s_structureGeneration[houseID];
+	uint16 *waiting = s_structureWaiting[houseID];
+	const int end = StructurePool_GetIndex(STRUCTURE_INDEX_MAX_HARD);
+	int pending = 0;
+
+	for (int i = 0; i < end; i++) {
 		const Structure *s = Structure_Get_ByIndex(i);
+		const bool allied = s->o.flags.s.used && House_AreAllied(houseID, s->o.houseID);
+		const uint32 generation = StructurePool_GetGeneration(i);
+
+		if (allied && !Server_IsDueForHouse(houseID, s->o.houseID, i))
+			continue;
+
+		ObjectFlags known;
+		known.all = copy[i].flags;
+
+		/* Structures the house knows of are hidden once their tiles
+		 * come into sight without them, and otherwise kept as last
+		 * seen while out of sight.
+		 */
+		enum ServerVisibility visible = SERVER_VISIBILITY_KEEP;
+		if (allied
+				|| (s->o.flags.s.used
+					&& (s->o.seenByHouses & (1 << houseID)) != 0
+					&& Server_IsStructureVisible(houseID, s->o.type, s->o.position))) {
+			visible = SERVER_VISIBILITY_SEND;
+		} else if (known.s.used
+				&& Server_IsStructureVisible(houseID, copy[i].type, copy[i].position)) {
+			visible = SERVER_VISIBILITY_HIDE;
+		}
+
+		if (visible == s_structureVisible[houseID][i]
+				&& generation == lastGeneration[i])
+			continue;
+
+		if (visible == SERVER_VISIBILITY_KEEP) {
+			s_structureVisible[houseID][i] = visible;
+			lastGeneration[i] = generation;
+			continue;
+		}
+
 		StructureDelta d;
 
-		Server_InitStructureDelta(s, &d);
-		if (memcmp(&s_structureCopy[i], &d, sizeof(StructureDelta)) == 0)
+		Server_InitStructureVisibleDelta(s, visible, &copy[i], &d);
+		if (memcmp(&copy[i], &d, sizeof(StructureDelta)) == 0) {
+			s_structureVisible[houseID][i] = visible;
+			lastGeneration[i] = generation;
 			continue;
+		}
 
-		memcpy(&s_structureCopy[i], &d, sizeof(StructureDelta));
+		const bool combat = (d.hitpoints != copy[i].hitpoints);
 
-		Net_Encode_ObjectIndex(buf, &s->o);
+		s_pending[pending].index = i;
+		s_pending[pending].priority = Server_GetPriority(houseID, &s->o,
+				s->o.houseID, combat, waiting[i]);
+		s_pending[pending].visible = visible;
+		pending++;
+	}
+
+	Server_SchedulePending(buf, pending, NET_STRUCTURE_DELTA_MAX_LEN);
+
+	for (int p = 0; p < pending; p++) {
+		const int i = s_pending[p].index;
+		const enum ServerVisibility visible = s_pending[p].visible;
 
-		/* 13 bytes. */
-		Net_Encode_uint8 (buf, d.type);
-		Net_Encode_uint8 (buf, d.linkedID);
-		Net_Encode_uint32(buf, d.flags.all);
-		Net_Encode_uint8 (buf, d.houseID);
-		Net_Encode_uint16(buf, d.position.x);
-		Net_Encode_uint16(buf, d.position.y);
-		Net_Encode_uint16(buf, d.hitpoints);
-
-		/* 10 bytes. */
-		Net_Encode_uint8 (buf, d.creatorHouse);
-		Net_Encode_uint16(buf, d.rotationSprite);
-		Net_Encode_uint8 (buf, d.objectType);
-		Net_Encode_uint8 (buf, d.upgradeLevel);
-		Net_Encode_uint8 (buf, d.upgradeTime);
-		Net_Encode_uint16(buf, d.countDown);
-		Net_Encode_uint16(buf, d.rallyPoint);
-
-		/* 32 bytes */
-		for (uint16 objectType = 0; objectType < OBJECTTYPE_MAX; objectType++) {
-			Net_Encode_uint8(buf, d.buildQueueCount[objectType]);
+		/* Leave the visibility and generation as they were, so the
+		 * structure is considered again next update.
+		 */
+		if (count >= 0xFF
+				|| !Server_CanEncodeFixedWidthBuffer(buf, NET_STRUCTURE_DELTA_MAX_LEN)) {
+			waiting[i]++;
+			continue;
 		}
 
+		const Structure *s = Structure_Get_ByIndex(i);
+		StructureDelta d;
+
+		Server_InitStructureVisibleDelta(s, visible, &copy[i], &d);
+		Net_Encode_ObjectIndex(buf, &s->o);
+		Net_Encode_StructureDelta(buf, &copy[i], &d);
+		memcpy(&copy[i], &d, sizeof(StructureDelta));
+		s_structureVisible[houseID][i] = visible;
+		lastGeneration[i] = StructurePool_GetGeneration(i);
+		waiting[i] = 0;
+
 		count++;
 	}
 
-	SERVER_LOG("structures changed=%d, %lu bytes",
-			count, *buf - buf_count + 1);
+	SERVER_LOG("house=%d, structures changed=%d, %lu bytes",
+			houseID, count, *buf - buf_count + 1);
 
 	Net_Encode_uint8(&buf_count, count);
 }
 
+/**
+ * Send the units the house can see: its own and its allies', and enemy
+ *  units standing on tiles in sight.  Enemy units are sent as unused
+ *  once they leave the house's sight.
+ */
 void
-Server_Send_UpdateUnits(unsigned char **buf)
+Server_Send_UpdateUnits(enum HouseType houseID, unsigned char **buf)
 {
-	const size_t header_len  = 1 + 1;
-	const size_t element_len = 2 + 12 + 10;
-	const int max = Server_MaxElementsToEncode(buf, header_len, element_len);
+	const size_t header_len = 1 + 1;
 
-	if (max <= 0)
+	s_updates[houseID]++;
+
+	if (!Server_CanEncodeFixedWidthBuffer(buf, header_len + NET_UNIT_DELTA_MAX_LEN))
 		return;
 
 	Net_Encode_ServerClientMsg(buf, SCMSG_UPDATE_UNITS);
@@ -430,45 +665,76 @@ Server_Send_UpdateUnits(unsigned char **buf)
 	unsigned char *buf_count = *buf; (*buf) += 1;
 	uint8 count = 0;
 
-	for (int i = 0;
-			i < UnitPool_GetMaxIndex() && count < max;
-			i++) {
+	UnitDelta *copy = s_unitCopy[houseID];
+	uint32 *lastGeneration = s_unitGeneration[houseID];
+	uint16 *waiting = s_unitWaiting[houseID];
+	const int end = UnitPool_GetMaxIndex();
+	int pending = 0;
+
+	for (int i = 0; i < end; i++) {
 		const Unit *u = Unit_Get_ByIndex(i);
+		const enum HouseType ownerID = Unit_GetHouseID(u);
+		const bool allied = u->o.flags.s.used && House_AreAllied(houseID, ownerID);
+		const enum ServerVisibility visible = (allied
+				|| (u->o.flags.s.used && !u->o.flags.s.isNotOnMap
+					&& Server_IsTileVisible(houseID, Tile_PackTile(u->o.position))))
+			? SERVER_VISIBILITY_SEND : SERVER_VISIBILITY_HIDE;
+		const uint32 generation = UnitPool_GetGeneration(i);
+
+		if (allied && !Server_IsDueForHouse(houseID, ownerID, i))
+			continue;
+
+		if (visible == s_unitVisible[houseID][i]
+				&& generation == lastGeneration[i])
+			continue;
+
 		UnitDelta d;
 
-		Server_InitUnitDelta(u, &d);
-		if (memcmp(&s_unitCopy[i], &d, sizeof(UnitDelta)) == 0)
+		Server_InitUnitVisibleDelta(u, visible, &copy[i], &d);
+		if (memcmp(&copy[i], &d, sizeof(UnitDelta)) == 0) {
+			s_unitVisible[houseID][i] = visible;
+			lastGeneration[i] = generation;
 			continue;
+		}
 
-		memcpy(&s_unitCopy[i], &d, sizeof(UnitDelta));
+		const bool combat = (visible == SERVER_VISIBILITY_SEND)
+			&& ((d.hitpoints != copy[i].hitpoints) || (u->targetAttack != 0));
 
-		Net_Encode_ObjectIndex(buf, &u->o);
+		s_pending[pending].index = i;
+		s_pending[pending].priority = Server_GetPriority(houseID, &u->o,
+				ownerID, combat, waiting[i]);
+		s_pending[pending].visible = visible;
+		pending++;
+	}
+
+	Server_SchedulePending(buf, pending, NET_UNIT_DELTA_MAX_LEN);
+
+	for (int p = 0; p < pending; p++) {
+		const int i = s_pending[p].index;
+		const enum ServerVisibility visible = s_pending[p].visible;
+
+		if (count >= 0xFF
+				|| !Server_CanEncodeFixedWidthBuffer(buf, NET_UNIT_DELTA_MAX_LEN)) {
+			waiting[i]++;
+			continue;
+		}
+
+		const Unit *u = Unit_Get_ByIndex(i);
+		UnitDelta d;
 
-		/* 12 bytes. */
-		Net_Encode_uint8 (buf, d.type);
-		Net_Encode_uint32(buf, d.flags.all);
-		Net_Encode_uint8 (buf, d.houseID);
-		Net_Encode_uint16(buf, d.position.x);
-		Net_Encode_uint16(buf, d.position.y);
-		Net_Encode_uint16(buf, d.hitpoints);
-
-		/* 10 bytes. */
-		Net_Encode_uint8 (buf, d.actionID);
-		Net_Encode_uint8 (buf, d.nextActionID);
-		Net_Encode_uint8 (buf, d.amount);
-		Net_Encode_uint8 (buf, d.deviated);
-		Net_Encode_uint8 (buf, d.deviatedHouse);
-		Net_Encode_uint8 (buf, d.orientation0_current);
-		Net_Encode_uint8 (buf, d.orientation1_current);
-		Net_Encode_uint8 (buf, d.wobbleIndex);
-		Net_Encode_uint8 (buf, d.spriteOffset);
-		Net_Encode_uint8 (buf, d.blinkHouse);
+		Server_InitUnitVisibleDelta(u, visible, &copy[i], &d);
+		Net_Encode_ObjectIndex(buf, &u->o);
+		Net_Encode_UnitDelta(buf, &copy[i], &d);
+		memcpy(&copy[i], &d, sizeof(UnitDelta));
+		s_unitVisible[houseID][i] = visible;
+		lastGeneration[i] = UnitPool_GetGeneration(i);
+		waiting[i] = 0;
 
 		count++;
 	}
 
-	SERVER_LOG("units changed=%d, %lu bytes",
-			count, *buf - buf_count + 1);
+	SERVER_LOG("house=%d, units changed=%d, %lu bytes",
+			houseID, count, *buf - buf_count + 1);
 
 	Net_Encode_uint8(&buf_count, count);
 }
@@ -707,7 +973,9 @@ Server_Send_WinLose(enum HouseType houseID, bool win)
 				Net_GetClientName(houseID),
 				win ? "won" : "lost");
 
-		Server_Recv_Chat(0, FLAG_HOUSE_ALL, chat_log);
+		/* Lockstep clients reach this too; the server tells everyone. */
+		if (Net_HasServerRole())
+			Server_Recv_Chat(0, FLAG_HOUSE_ALL, chat_log);
 
 		g_multiplayer.state[houseID] = (win ? MP_HOUSE_WON : MP_HOUSE_LOST);
 		g_client_houses &= ~(1 << houseID);
@@ -783,7 +1051,7 @@ Server_Send_Scenario(unsigned char **buf)
 	if (!g_sendScenario || lobby_map_generator_mode != MAP_GENERATOR_STOP)
 		return;
 
-	const size_t len = 1 + 7 + MAX_CLIENTS;
+	const size_t len = 1 + 8 + 8 + MAX_CLIENTS;
 	if (!Server_CanEncodeFixedWidthBuffer(buf, len))
 		return;
 
@@ -799,6 +1067,11 @@ Server_Send_Scenario(unsigned char **buf)
 	Net_Encode_uint8 (buf, enhancement_fog_of_war);
 	Net_Encode_uint8 (buf, enhancement_insatiable_sandworms);
 	Net_Encode_uint8 (buf, enhancement_extend_sight_range);
+	Net_Encode_uint8 (buf, g_net_lockstep);
+	Net_Encode_uint32(buf, Replay_EncodeEnhancements());
+	Net_Encode_uint16(buf, enhancement_astar_pathfinder_budget);
+	Net_Encode_uint8 (buf, enhancement_repair_cost_formula);
+	Net_Encode_uint8 (buf, g_gameConfig.gameSpeed);
 
 	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
 		Net_Encode_uint8(buf, g_multiplayer.client[h]);
@@ -833,14 +1106,18 @@ void
 Server_Recv_ReturnToLobby(enum HouseType houseID, bool log_message)
 {
 	PeerData *data = Net_GetPeerData(g_multiplayer.client[houseID]);
-	data->state = CLIENTSTATE_IN_LOBBY;
+	if (data != NULL)
+		data->state = CLIENTSTATE_IN_LOBBY;
 
 	if (g_multiplayer.state[houseID] == MP_HOUSE_PLAYING) {
 		g_multiplayer.state[houseID] = MP_HOUSE_LOST;
 		g_client_houses &= ~(1 << houseID);
 		House_Server_ReassignToAI(houseID);
 
-		if (log_message) {
+		/* In lockstep games, this is also run by clients, and after
+		 * the player has disconnected.
+		 */
+		if (log_message && Net_HasServerRole() && data != NULL) {
 			char chat_log[MAX_CHAT_LEN + 1];
 
 			snprintf(chat_log, sizeof(chat_log), "%s surrendered",
@@ -898,6 +1175,8 @@ Server_Recv_SetRallyPoint(enum HouseType houseID, const unsigned char *buf)
 			|| !Structure_SupportsRallyPoints(s->o.type))
 		return;
 
+	StructurePool_MarkDirty(s);
+
 	if (Tile_IsOutOfMap(packed)) {
 		s->rallyPoint = 0xFFFF;
 	} else {
@@ -1030,6 +1309,8 @@ Server_Recv_PurchaseResumeItem(enum HouseType houseID, const unsigned char *buf)
 	if (!Server_PlayerCanControlStructure(houseID, s))
 		return;
 
+	StructurePool_MarkDirty(s);
+
 	if (s->o.type == STRUCTURE_STARPORT) {
 		Server_Recv_PurchaseItemStarport(s, objectType);
 		return;
@@ -1087,6 +1368,8 @@ Server_Recv_PauseCancelItem(enum HouseType houseID, const unsigned char *buf)
 	if (!Server_PlayerCanControlStructure(houseID, s))
 		return;
 
+	StructurePool_MarkDirty(s);
+
 	if (s->o.type == STRUCTURE_STARPORT) {
 		Server_Recv_CancelItemStarport(s, objectType);
 	} else if (s->objectType == objectType && s->o.linkedID != 0xFF) {
@@ -1122,6 +1405,8 @@ Server_Recv_EnterLeavePlacementMode(enum HouseType houseID, const unsigned char
 				|| !Server_PlayerCanControlStructure(houseID, s))
 			return;
 
+		StructurePool_MarkDirty(s);
+
 		if (s->countDown == 0
 				&& s->o.linkedID != STRUCTURE_INVALID
 				&& h->structureActiveID == STRUCTURE_INDEX_INVALID) {
@@ -1142,6 +1427,7 @@ Server_Recv_EnterLeavePlacementMode(enum HouseType houseID, const unsigned char
 				&& s->o.type == STRUCTURE_CONSTRUCTION_YARD
 				&& s->o.linkedID == STRUCTURE_INVALID
 				&& Server_PlayerCanControlStructure(houseID, s)) {
+			StructurePool_MarkDirty(s);
 			s->o.linkedID = h->structureActiveID;
 		} else {
 			Structure_Free(Structure_Get_ByIndex(h->structureActiveID));
@@ -1182,6 +1468,8 @@ Server_Recv_ActivateStructureAbility(enum HouseType houseID, const unsigned char
 	if (!Server_PlayerCanControlStructure(houseID, s))
 		return;
 
+	StructurePool_MarkDirty(s);
+
 	if (s->o.type == STRUCTURE_PALACE) {
 		if (s->countDown == 0)
 			Structure_Server_ActivateSpecial(s);
@@ -1207,6 +1495,72 @@ Server_Recv_LaunchDeathhand(enum HouseType houseID, const unsigned char *buf)
 	Unit_Server_LaunchHouseMissile(h, packed);
 }
 
+static void
+Server_Recv_SetViewport(enum HouseType houseID, const unsigned char *buf)
+{
+	const uint16 packed = Net_Decode_uint16(&buf);
+
+	if (houseID >= HOUSE_NEUTRAL || packed >= MAP_SIZE_MAX * MAP_SIZE_MAX)
+		return;
+
+	s_viewport[houseID] = packed;
+}
+
+static void
+Server_Recv_WorldHash(enum HouseType houseID, const unsigned char *buf)
+{
+	const uint32 tick = Net_Decode_uint32(&buf);
+	const uint32 hash = Net_Decode_uint32(&buf);
+
+	if (houseID >= HOUSE_NEUTRAL)
+		return;
+
+	s_worldHash[houseID].pending = true;
+	s_worldHash[houseID].tick = tick;
+	s_worldHash[houseID].hash = hash;
+}
+
+/**
+ * Compares the world hashes reported by clients with our own, and
+ *  announces the first time each house goes out of sync.
+ */
+void
+Server_CheckWorldHashes(void)
+{
+	uint32 latest_tick;
+	uint32 latest_hash;
+
+	if (!Net_HasServerRole() || !WorldHash_GetLatest(&latest_tick, &latest_hash))
+		return;
+
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		if (!s_worldHash[h].pending)
+			continue;
+
+		/* The client may be a few turns ahead of us. */
+		if (s_worldHash[h].tick > latest_tick)
+			continue;
+
+		uint32 hash;
+		s_worldHash[h].pending = false;
+		if (!WorldHash_Get(s_worldHash[h].tick, &hash))
+			continue;
+
+		SERVER_LOG("house=%d, tick=%u, hash=%08X, expected=%08X",
+				h, s_worldHash[h].tick, s_worldHash[h].hash, hash);
+
+		if (hash != s_worldHash[h].hash && !(s_desyncHouses & (1 << h))) {
+			char chat_log[MAX_CHAT_LEN + 1];
+
+			snprintf(chat_log, sizeof(chat_log), "%s is out of sync at tick %u",
+					Net_GetClientName(h), s_worldHash[h].tick);
+
+			Server_Recv_Chat(0, FLAG_HOUSE_ALL, chat_log);
+			s_desyncHouses |= (1 << h);
+		}
+	}
+}
+
 /*--------------------------------------------------------------*/
 
 static bool
@@ -1294,6 +1648,9 @@ Server_Recv_IssueUnitActionTargetted(Unit *u,
 	if (actionID == ACTION_MOVE) {
 		Unit_SetDestination(u, encoded);
 
+		if (enhancement_astar_pathfinder && Tools_Index_GetType(u->targetMove) == IT_TILE)
+			Pathfinder_FlowField_AddOrder(Map_Clamp_Packed(Tools_Index_GetPackedTile(u->targetMove)), ui->movementType);
+
 		if (enhancement_targetted_sabotage && u->detonateAtTarget) {
 			target = Tools_Index_GetUnit(u->targetMove);
 		} else if (enhancement_permanent_follow_mode) {
@@ -1307,6 +1664,7 @@ Server_Recv_IssueUnitActionTargetted(Unit *u,
 	}
 
 	if (target != NULL) {
+		UnitPool_MarkDirty(target);
 		target->blinkCounter = 8;
 		target->blinkHouse = Unit_GetHouseID(u);
 	}
@@ -1472,6 +1830,9 @@ Server_ProcessMessage(int peerID, enum HouseType houseID,
 			break;
 		}
 
+		if (Net_IsCommand_ClientServerMsg(msg))
+			Replay_Record_Message(houseID, buf - 1, 1 + len);
+
 		switch (msg) {
 			case CSMSG_DISCONNECT:
 				assert(false);
@@ -1517,6 +1878,19 @@ Server_ProcessMessage(int peerID, enum HouseType houseID,
 				Server_Recv_IssueUnitAction(houseID, buf);
 				break;
 
+			case CSMSG_SET_VIEWPORT:
+				Server_Recv_SetViewport(houseID, buf);
+				break;
+
+			case CSMSG_LOCKSTEP_TURN:
+				/* Only valid in lockstep games, see Lockstep_Server_Recv. */
+				count = len;
+				break;
+
+			case CSMSG_WORLD_HASH:
+				Server_Recv_WorldHash(houseID, buf);
+				break;
+
 			case CSMSG_PREFERRED_NAME:
 				Server_Recv_PrefName(peerID, (const char *)buf);
 				break;
@@ -1549,6 +1923,7 @@ Server_Console_Help(const char *msg)
 		"Commands",
 		" /list",
 		" /kick <id | name>",
+		" /hash",
 		" /credits <N>",
 		" /seed <N>",
 		" /spice <min> <max>",
@@ -1630,6 +2005,23 @@ Server_Console_Seed(const char *msg)
 	}
 }
 
+static void
+Server_Console_Hash(const char *msg)
+{
+	char chat_log[MAX_CHAT_LEN + 1];
+	uint32 tick;
+	uint32 hash;
+	VARIABLE_NOT_USED(msg);
+
+	if (WorldHash_GetLatest(&tick, &hash)) {
+		snprintf(chat_log, sizeof(chat_log), "Tick %u: %08X", tick, hash);
+	} else {
+		snprintf(chat_log, sizeof(chat_log), "Current: %08X", WorldHash_Compute());
+	}
+
+	ChatBox_AddLog(CHATTYPE_CONSOLE, chat_log);
+}
+
 static void
 Server_Console_Spice(const char *msg)
 {
@@ -1670,6 +2062,7 @@ Server_ProcessCommand(const char *msg)
 		{ "/help",      Server_Console_Help },
 		{ "/list",      Server_Console_List },
 		{ "/kick",      Server_Console_Kick },
+		{ "/hash",      Server_Console_Hash },
 
 		/* Lobby only commands below this point. */
 		{ NULL,         NULL },
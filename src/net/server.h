@@ -13,8 +13,8 @@ extern void Server_Send_UpdateLandscape(unsigned char **buf);
 extern void Server_Send_UpdateFogOfWar(enum HouseType houseID, unsigned char **buf);
 extern void Server_Send_UpdateHouse(enum HouseType houseID, unsigned char **buf);
 extern void Server_Send_UpdateCHOAM(unsigned char **buf);
-extern void Server_Send_UpdateStructures(unsigned char **buf);
-extern void Server_Send_UpdateUnits(unsigned char **buf);
+extern void Server_Send_UpdateStructures(enum HouseType houseID, unsigned char **buf);
+extern void Server_Send_UpdateUnits(enum HouseType houseID, unsigned char **buf);
 extern void Server_Send_UpdateExplosions(unsigned char **buf);
 extern void Server_Send_ScreenShake(uint16 packed);
 extern void Server_Send_StatusMessage1(enum HouseFlag houses, uint8 priority, uint16 str1);
@@ -33,6 +33,7 @@ extern void Server_Recv_ReturnToLobby(enum HouseType houseID, bool log_message);
 extern void Server_Recv_PrefName(int peerID, const char *name);
 extern void Server_Recv_PrefHouse(int peerID, enum HouseType houseID);
 extern void Server_ProcessMessage(int peerID, enum HouseType houseID, const unsigned char *buf, int count);
+extern void Server_CheckWorldHashes(void);
 extern bool Server_ProcessCommand(const char *msg);
 
 #endif
@@ -894,6 +894,10 @@ GameplayOptions_Initialize(void)
 	si->d.checkbox = &enhancement_attack_dir_consistency;
 	snprintf(si->text, sizeof(si->text), "Consistent directional damage");
 
+	si = Scrollbar_AllocItem(w, SCROLLBAR_CHECKBOX);
+	si->d.checkbox = &enhancement_astar_pathfinder;
+	snprintf(si->text, sizeof(si->text), "A* pathfinder");
+
 	GUI_Widget_Scrollbar_Init(w, ws->scrollMax, 6, 0);
 }
 
@@ -29,6 +29,7 @@
 #include "../gui/widget.h"
 #include "../input/input.h"
 #include "../input/mouse.h"
+#include "../net/lockstep.h"
 #include "../net/net.h"
 #include "../opendune.h"
 #include "../pool/pool_structure.h"
@@ -970,6 +971,10 @@ MenuBar_TickGameControls(void)
 			break;
 
 		case 0x8000 | 32: /* STR_GAME_SPEED */
+			/* Lockstep peers must keep the speed the host started with. */
+			if (Lockstep_IsRunning())
+				break;
+
 			w = GUI_Widget_Get_ByIndex(g_widgetLinkedListTail, 32);
 			if (w->state.buttonState & 0x04) {
 				if (++g_gameConfig.gameSpeed >= 5)
@@ -31,14 +31,14 @@ static int s_last_index;
 char g_savegameDesc[5][51];                                 /*!< Array of savegame descriptions for the SaveLoad window. */
 
 static bool
-SaveMenu_IsValidFilename(const ALLEGRO_PATH *path)
+SaveMenu_IsValidFilename(const ALLEGRO_PATH *path, const char *prefix)
 {
 	const char *extension = al_get_path_extension(path);
 	if (strcasecmp(extension, ".DAT") != 0)
 		return false;
 
 	const char *basename = al_get_path_basename(path);
-	if (strncasecmp(basename, "_SAVE", 5) != 0)
+	if (strncasecmp(basename, prefix, 5) != 0)
 		return false;
 
 	const char *digit = basename + 5;
@@ -69,7 +69,7 @@ SaveMenu_FindSavedGames(bool save, Widget *scrollbar)
 				ALLEGRO_PATH *path = al_create_path(al_get_fs_entry_name(f));
 
 				/* Filename should be _SAVE###.DAT */
-				if (SaveMenu_IsValidFilename(path)) {
+				if (SaveMenu_IsValidFilename(path, "_SAVE")) {
 					const char *filename = al_get_path_filename(path);
 					ScrollbarItem *si = Scrollbar_AllocItem(scrollbar, SCROLLBAR_ITEM);
 					int index;
@@ -77,6 +77,12 @@ SaveMenu_FindSavedGames(bool save, Widget *scrollbar)
 					strncpy(si->text, filename, sizeof(si->text));
 					sscanf(filename + 5, "%d", &index);
 					s_last_index = max(index, s_last_index);
+				} else if (!save && SaveMenu_IsValidFilename(path, "_AUTO")) {
+					/* Autosaves can be loaded, but not saved over. */
+					const char *filename = al_get_path_filename(path);
+					ScrollbarItem *si = Scrollbar_AllocItem(scrollbar, SCROLLBAR_ITEM);
+
+					strncpy(si->text, filename, sizeof(si->text));
 				}
 
 				al_destroy_path(path);
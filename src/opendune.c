@@ -27,6 +27,7 @@ extern int _al_mangled_main(int argc, char **argv);
 #include "ai.h"
 #include "animation.h"
 #include "audio/audio.h"
+#include "autosave.h"
 #include "common_a5.h"
 #include "config.h"
 #include "crashlog/crashlog.h"
@@ -54,13 +55,17 @@ extern int _al_mangled_main(int argc, char **argv);
 #include "newui/menu.h"
 #include "newui/menubar.h"
 #include "newui/viewport.h"
+#include "pathfinder.h"
 #include "pool/pool.h"
 #include "pool/pool_house.h"
 #include "pool/pool_structure.h"
 #include "pool/pool_team.h"
 #include "pool/pool_unit.h"
+#include "profile.h"
+#include "replay.h"
 #include "scenario.h"
 #include "shape.h"
+#include "snapshot.h"
 #include "sprites.h"
 #include "string.h"
 #include "structure.h"
@@ -271,6 +276,15 @@ void GameLoop_Uninit(void)
 void GameLoop_LevelEnd(void)
 {
 	static int64_t l_levelEndTimer = 0;
+	static int64_t l_scenarioStart = 0;
+
+	/* Check on the same ticks of every game, so that lockstep peers
+	 * agree on when a house has won or lost.
+	 */
+	if (l_scenarioStart != g_tickScenarioStart) {
+		l_scenarioStart = g_tickScenarioStart;
+		l_levelEndTimer = g_tickScenarioStart;
+	}
 
 	if (l_levelEndTimer >= g_timerGame && !s_debugForceWin)
 		return;
@@ -549,6 +563,8 @@ void GameLoop_Main(bool new_game)
 			Game_LoadScenario(g_playerHouseID, g_scenarioID);
 			GUI_ChangeSelectionType(g_debugScenario ? SELECTIONTYPE_DEBUG : SELECTIONTYPE_STRUCTURE);
 		}
+
+		Replay_Record_Start();
 	}
 
 	/* Note: original game chose only MUSIC_IDLE1 .. MUSIC_IDLE6. */
@@ -564,6 +580,7 @@ void GameLoop_Main(bool new_game)
 	ChatBox_ResetTimestamps();
 
 	GameLoop_Loop();
+	Replay_Record_Stop();
 
 	Timer_UnregisterSource();
 
@@ -625,6 +642,33 @@ static bool Unknown_25C4_000E(void)
 	return true;
 }
 
+/**
+ * Create the built-in campaigns: CAMPAIGNID_DUNE_II, CAMPAIGNID_SKIRMISH
+ *  and CAMPAIGNID_MULTIPLAYER, in that order.
+ */
+void Game_CreateCampaigns(void)
+{
+	Campaign *camp;
+
+	/* Create the Dune 2 campaign: CAMPAIGNID_DUNE_II. */
+	camp = Campaign_Alloc(NULL);
+	camp->house[0] = HOUSE_ATREIDES;
+	camp->house[1] = HOUSE_ORDOS;
+	camp->house[2] = HOUSE_HARKONNEN;
+	camp->intermission = true;
+	snprintf(camp->name, sizeof(camp->name), "%s", String_Get_ByIndex(STR_THE_BATTLE_FOR_ARRAKIS));
+
+	/* Create the skirmish campaign: CAMPAIGNID_SKIRMISH. */
+	camp = Campaign_Alloc("skirmish");
+	snprintf(camp->name, sizeof(camp->name), "Skirmish");
+
+	/* Create the multiplayer campaign: CAMPAIGNID_MULTIPLAYER. */
+	camp = Campaign_Alloc("multiplayer");
+	snprintf(camp->name, sizeof(camp->name), "Multiplayer");
+}
+
+/* The headless simulator (src/sim.c) provides its own main. */
+#ifndef DUNEDYNASTY_SIM
 int main(int argc, char **argv)
 {
 	VARIABLE_NOT_USED(argc);
@@ -652,23 +696,7 @@ int main(int argc, char **argv)
 	Audio_LoadSampleSet(SAMPLESET_INVALID);
 	String_Init();
 
-	Campaign *camp;
-
-	/* Create the Dune 2 campaign: CAMPAIGNID_DUNE_II. */
-	camp = Campaign_Alloc(NULL);
-	camp->house[0] = HOUSE_ATREIDES;
-	camp->house[1] = HOUSE_ORDOS;
-	camp->house[2] = HOUSE_HARKONNEN;
-	camp->intermission = true;
-	snprintf(camp->name, sizeof(camp->name), "%s", String_Get_ByIndex(STR_THE_BATTLE_FOR_ARRAKIS));
-
-	/* Create the skirmish campaign: CAMPAIGNID_SKIRMISH. */
-	camp = Campaign_Alloc("skirmish");
-	snprintf(camp->name, sizeof(camp->name), "Skirmish");
-
-	/* Create the multiplayer campaign: CAMPAIGNID_MULTIPLAYER. */
-	camp = Campaign_Alloc("multiplayer");
-	snprintf(camp->name, sizeof(camp->name), "Multiplayer");
+	Game_CreateCampaigns();
 
 	Sprites_Init();
 	Sprites_LoadTiles();
@@ -685,6 +713,7 @@ int main(int argc, char **argv)
 	PrepareEnd();
 	exit(0);
 }
+#endif /* DUNEDYNASTY_SIM */
 
 /**
  * Prepare the map (after loading scenario or savegame). Does some basic
@@ -703,23 +732,24 @@ void Game_Prepare(void)
 	Structure_Recount();
 	Unit_Recount();
 	Team_Recount();
+	Pathfinder_InvalidateAll();
+	Map_Journal_Invalidate();
 
 	for (uint16 packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++) {
 		const Structure *s = Structure_Get_ByPackedTile(packed);
 		const Unit *u = Unit_Get_ByPackedTile(packed);
 		Tile *t = &g_map[packed];
-		FogOfWarTile *f = &g_mapVisible[packed];
 
 		if (u == NULL || !u->o.flags.s.used) t->hasUnit = false;
 		if (s == NULL || !s->o.flags.s.used) t->hasStructure = false;
 
 		if (Map_IsUnveiledToHouse(g_playerHouseID, packed)) {
-			const int64_t backup = f->timeout[g_playerHouseID];
+			const uint32 backup = g_mapFog[g_playerHouseID].timeout[packed];
 
 			Map_UnveilTile(g_playerHouseID, UNVEILCAUSE_INITIALISATION,
 					packed);
 
-			f->timeout[g_playerHouseID] = backup;
+			g_mapFog[g_playerHouseID].timeout[packed] = backup;
 		}
 	}
 
@@ -824,6 +854,9 @@ void Game_Init(void)
 	g_structureActiveType   = 0xFFFF;
 
 	GUI_DisplayText(NULL, -1);
+
+	WorldSnapshot_QuickDiscard();
+	Autosave_Reset();
 }
 
 /**
@@ -862,8 +895,12 @@ void Game_LoadScenario(uint8 houseID, uint16 scenarioID)
  */
 void PrepareEnd(void)
 {
+	Profile_CloseCSV();
+	Autosave_Uninit();
+
 	Animation_Uninit();
 	Explosion_Uninit();
+	Pathfinder_Uninit();
 
 	GameLoop_Uninit();
 
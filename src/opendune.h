@@ -57,6 +57,7 @@ extern void GameLoop_TweakWidgetDimensions(void);
 extern void GameLoop_Main(bool new_game);
 extern void Game_Prepare(void);
 extern void Game_Init(void);
+extern void Game_CreateCampaigns(void);
 extern void Game_LoadScenario(uint8 houseID, uint16 scenarioID);
 extern void GameLoop_Uninit(void);
 extern void PrepareEnd(void);
@@ -0,0 +1,1060 @@
+/** @file src/pathfinder.c
+ *
+ * A* pathfinder.
+ *
+ * An alternative to Script_Unit_Pathfinder, which walks straight to the
+ * destination and follows any obstacle it meets clockwise and
+ * counterclockwise for at most 100 steps.  That often fails to route
+ * around larger walls and cliffs, after which the unit asks again on
+ * the next script tick.
+ *
+ * This searches the tile grid using the same tile enter scores, with
+ * a bounded number of tiles expanded per search.  If the destination
+ * cannot be reached within the budget, the route leads to the tile
+ * found closest to the destination instead.  Neighbours are visited in
+ * a fixed order and heap ties are broken by tile, so the result only
+ * depends on the game state.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "os/math.h"
+
+#include "pathfinder.h"
+
+#include "binheap.h"
+#include "enhancement.h"
+#include "map.h"
+#include "timer/timer.h"
+#include "tools/coord.h"
+#include "pool/pool_unit.h"
+#include "unit.h"
+
+enum {
+	PATHFINDER_STEP_COST = 64                               /*!< Cost of a step, in addition to the tile enter score. */
+};
+
+typedef struct PathfinderNode {
+	/* Heap key. */
+	int64_t key;                                            /*!< Estimated total cost, then distance to go, then tile. */
+
+	uint16 packed;                                          /*!< The tile. */
+} PathfinderNode;
+
+static const int16 s_mapDirection[8] = {-64, -63, 1, 65, 64, 63, -1, -65}; /*!< Tile index change when moving in a direction. */
+static const int8 s_directionX[8] = { 0,  1,  1,  1,  0, -1, -1, -1};
+static const int8 s_directionY[8] = {-1, -1,  0,  1,  1,  1,  0, -1};
+
+static BinHeap s_open;
+static uint16 s_generation;
+static int s_expanded;                                      /*!< Nodes expanded by all searches, for the per-tick budget. */
+static uint16 s_reached[MAP_SIZE_MAX * MAP_SIZE_MAX];      /*!< Generation in which the tile was reached. */
+static uint16 s_closed[MAP_SIZE_MAX * MAP_SIZE_MAX];       /*!< Generation in which the tile was expanded. */
+static int32 s_cost[MAP_SIZE_MAX * MAP_SIZE_MAX];          /*!< Cost of the cheapest route found to the tile. */
+static uint8 s_direction[MAP_SIZE_MAX * MAP_SIZE_MAX];     /*!< Direction of the last step of that route. */
+
+void
+Pathfinder_Uninit(void)
+{
+	BinHeap_Free(&s_open);
+}
+
+/**
+ * Get the score to enter this tile from a direction, as in
+ *  Script_Unit_Pathfind_GetScore.
+ *
+ * @return 256 if tile is not accessable, or a score for entering otherwise.
+ */
+static int16
+Pathfinder_GetScore(struct Unit *u, uint16 packed, uint8 orient8)
+{
+	int16 res;
+
+	if (g_dune2_enhanced) {
+		res = Unit_GetTileEnterScore(u, packed, orient8);
+	} else {
+		res = Unit_GetTileEnterScore(u, packed, orient8 << 5);
+	}
+
+	if (res == -1) res = 256;
+
+	return res;
+}
+
+static int32
+Pathfinder_Heuristic(uint16 packed, uint16 packedDst)
+{
+	const int dx = abs(Tile_GetPackedX(packed) - Tile_GetPackedX(packedDst));
+	const int dy = abs(Tile_GetPackedY(packed) - Tile_GetPackedY(packedDst));
+
+	return PATHFINDER_STEP_COST * max(dx, dy);
+}
+
+static bool
+Pathfinder_Push(uint16 packed, uint16 packedDst)
+{
+	const int32 h = Pathfinder_Heuristic(packed, packedDst);
+	const int64_t key
+		= ((int64_t)(s_cost[packed] + h) << 32)
+		| ((int64_t)h << 16) | packed;
+
+	PathfinderNode *node = BinHeap_Push(&s_open, key);
+	if (node == NULL)
+		return false;
+
+	node->packed = packed;
+	return true;
+}
+
+/**
+ * Find a route between two tiles.
+ *
+ * @param u The unit to find a route for.
+ * @param packedSrc The start point.
+ * @param packedDst The end point.
+ * @param buffer The buffer to store the route in, as directions
+ *  terminated by 0xFF.
+ * @param bufferSize The size of the buffer.
+ * @param score If not NULL, receives the total score of the route.
+ * @return The size of the route, including the terminator.
+ */
+uint16
+Pathfinder_AStar(struct Unit *u, uint16 packedSrc, uint16 packedDst, uint8 *buffer, uint16 bufferSize, int16 *score)
+{
+	assert(u != NULL);
+	assert(bufferSize >= 1);
+
+	if (++s_generation == 0) {
+		memset(s_reached, 0, sizeof(s_reached));
+		memset(s_closed, 0, sizeof(s_closed));
+		s_generation = 1;
+	}
+
+	BinHeap_Init(&s_open, sizeof(PathfinderNode));
+
+	s_reached[packedSrc] = s_generation;
+	s_cost[packedSrc] = 0;
+	Pathfinder_Push(packedSrc, packedDst);
+
+	uint16 best = packedSrc;
+	int32 bestDistance = Pathfinder_Heuristic(packedSrc, packedDst);
+	int expanded = 0;
+
+	for (const PathfinderNode *node = BinHeap_GetMin(&s_open);
+			node != NULL;
+			node = BinHeap_GetMin(&s_open)) {
+		const uint16 packed = node->packed;
+		BinHeap_Pop(&s_open);
+
+		if (s_closed[packed] == s_generation) continue;
+		s_closed[packed] = s_generation;
+
+		/* Remember the tile closest to the destination, in case it
+		 * cannot be reached.
+		 */
+		const int32 distance = Pathfinder_Heuristic(packed, packedDst);
+		if (distance < bestDistance || (distance == bestDistance && s_cost[packed] < s_cost[best])) {
+			best = packed;
+			bestDistance = distance;
+		}
+
+		if (packed == packedDst) break;
+		if (++expanded > PATHFINDER_NODE_BUDGET) break;
+		s_expanded++;
+
+		const int x = Tile_GetPackedX(packed);
+		const int y = Tile_GetPackedY(packed);
+
+		for (uint8 direction = 0; direction < 8; direction++) {
+			if (!(Map_InRangeX(x + s_directionX[direction]) && Map_InRangeY(y + s_directionY[direction])))
+				continue;
+
+			const uint16 packedNext = packed + s_mapDirection[direction];
+			if (s_closed[packedNext] == s_generation) continue;
+
+			const int16 res = Pathfinder_GetScore(u, packedNext, direction);
+			if (res > 255) continue;
+
+			const int32 cost = s_cost[packed] + PATHFINDER_STEP_COST + max(0, res);
+			if (s_reached[packedNext] == s_generation && cost >= s_cost[packedNext]) continue;
+
+			s_reached[packedNext] = s_generation;
+			s_cost[packedNext] = cost;
+			s_direction[packedNext] = direction;
+
+			if (!Pathfinder_Push(packedNext, packedDst)) break;
+		}
+	}
+
+	/* Count the steps, then write out as many as fit from the start. */
+	uint16 length = 0;
+	for (uint16 packed = best; packed != packedSrc; packed -= s_mapDirection[s_direction[packed]])
+		length++;
+
+	const uint16 routeSize = min(length, bufferSize - 1);
+	int16 routeScore = 0;
+	uint16 i = length;
+
+	for (uint16 packed = best; packed != packedSrc; packed -= s_mapDirection[s_direction[packed]]) {
+		i--;
+		if (i >= routeSize) continue;
+
+		const uint16 packedPrev = packed - s_mapDirection[s_direction[packed]];
+
+		buffer[i] = s_direction[packed];
+		routeScore += s_cost[packed] - s_cost[packedPrev] - PATHFINDER_STEP_COST;
+	}
+
+	buffer[routeSize] = 0xFF;
+
+	if (score != NULL) *score = routeScore;
+
+	return routeSize + 1;
+}
+
+/*--------------------------------------------------------------*/
+
+/* Hierarchical pathfinding.
+ *
+ * The map is split into clusters of HPA_CLUSTER_SIZE x HPA_CLUSTER_SIZE
+ * tiles.  Wherever a run of tiles along the border of two clusters is
+ * passable on both sides, the middle of the run becomes an entrance,
+ * with a node on either side.  Each cluster caches the cost between
+ * its entrances, so a long route is planned over at most a few
+ * hundred nodes rather than thousands of tiles.  The tile search then
+ * only needs to reach the first entrances on that plan.
+ *
+ * The graph only considers the landscape and structures, not units.
+ * Clusters are rebuilt lazily after Pathfinder_InvalidateTile.
+ *
+ * The connected areas of the map are also labelled for each movement
+ * type, so a destination on another island or inside a walled base is
+ * rejected without searching.  A flood fill of the whole map visits
+ * fewer tiles than a single unsuccessful search, so the labels are
+ * simply recomputed on the next query after a change.
+ */
+
+enum {
+	HPA_CLUSTER_SHIFT = 3,
+	HPA_CLUSTER_SIZE = 1 << HPA_CLUSTER_SHIFT,
+	HPA_CLUSTER_WIDTH = MAP_SIZE_MAX / HPA_CLUSTER_SIZE,
+	HPA_CLUSTER_COUNT = HPA_CLUSTER_WIDTH * HPA_CLUSTER_WIDTH,
+	HPA_CLUSTER_NODES_MAX = 4 * (HPA_CLUSTER_SIZE / 2),
+
+	HPA_STATE_COUNT = HPA_CLUSTER_COUNT * HPA_CLUSTER_NODES_MAX,
+	HPA_STATE_GOAL = HPA_STATE_COUNT,
+	HPA_STATE_NONE = 0xFFFF,
+
+	HPA_COST_NONE = 0xFFFF,
+
+	/* Routes shorter than this are found by the tile search alone. */
+	HPA_DIRECT_DISTANCE = 16,
+
+	/* The route buffer of a unit holds 14 steps, so plan towards the
+	 * furthest entrance about that far away.
+	 */
+	HPA_WAYPOINT_DISTANCE = 14
+};
+
+typedef struct HPANode {
+	uint16 packed;                                          /*!< The tile of this entrance, inside the cluster. */
+	uint16 partner;                                         /*!< The tile on the other side of the border. */
+} HPANode;
+
+typedef struct HPACluster {
+	bool valid;                                             /*!< The entrances and costs are up to date. */
+	uint8 count;                                            /*!< Number of entrances. */
+	HPANode node[HPA_CLUSTER_NODES_MAX];                    /*!< The entrances, by border then position. */
+	uint16 cost[HPA_CLUSTER_NODES_MAX][HPA_CLUSTER_NODES_MAX]; /*!< Cost between entrances within the cluster. */
+} HPACluster;
+
+static HPACluster s_cluster[MOVEMENT_MAX][HPA_CLUSTER_COUNT];
+static uint16 s_clusterDistance[HPA_CLUSTER_SIZE * HPA_CLUSTER_SIZE];
+
+static uint32 s_mapGeneration;                              /*!< Incremented whenever passability changes. */
+
+static bool s_componentValid[MOVEMENT_MAX];                 /*!< The labels are up to date. */
+static uint16 s_component[MOVEMENT_MAX][MAP_SIZE_MAX * MAP_SIZE_MAX];     /*!< Connected area of each tile, or 0 if not accessable. */
+
+static uint16 s_hpaGeneration;
+static uint16 s_hpaReached[HPA_STATE_COUNT + 1];
+static uint16 s_hpaClosed[HPA_STATE_COUNT + 1];
+static int32 s_hpaCost[HPA_STATE_COUNT + 1];
+static uint16 s_hpaPrev[HPA_STATE_COUNT + 1];
+
+/**
+ * Mark the clusters affected by a change to the passability of a tile.
+ *  Entrances on the borders depend on both sides, so the neighbouring
+ *  clusters are also rebuilt.
+ */
+void
+Pathfinder_InvalidateTile(uint16 packed)
+{
+	const int cx = Tile_GetPackedX(packed) >> HPA_CLUSTER_SHIFT;
+	const int cy = Tile_GetPackedY(packed) >> HPA_CLUSTER_SHIFT;
+
+	s_mapGeneration++;
+
+	for (enum UnitMovementType mt = MOVEMENT_FOOT; mt < MOVEMENT_MAX; mt++) {
+		s_componentValid[mt] = false;
+		s_cluster[mt][HPA_CLUSTER_WIDTH * cy + cx].valid = false;
+
+		if (cx > 0)                     s_cluster[mt][HPA_CLUSTER_WIDTH * cy + cx - 1].valid = false;
+		if (cx < HPA_CLUSTER_WIDTH - 1) s_cluster[mt][HPA_CLUSTER_WIDTH * cy + cx + 1].valid = false;
+		if (cy > 0)                     s_cluster[mt][HPA_CLUSTER_WIDTH * (cy - 1) + cx].valid = false;
+		if (cy < HPA_CLUSTER_WIDTH - 1) s_cluster[mt][HPA_CLUSTER_WIDTH * (cy + 1) + cx].valid = false;
+	}
+}
+
+void
+Pathfinder_InvalidateAll(void)
+{
+	s_mapGeneration++;
+	Pathfinder_Queue_Clear();
+
+	for (enum UnitMovementType mt = MOVEMENT_FOOT; mt < MOVEMENT_MAX; mt++) {
+		s_componentValid[mt] = false;
+
+		for (int i = 0; i < HPA_CLUSTER_COUNT; i++)
+			s_cluster[mt][i].valid = false;
+	}
+}
+
+static uint16
+Pathfinder_GetCluster(uint16 packed)
+{
+	const int cx = Tile_GetPackedX(packed) >> HPA_CLUSTER_SHIFT;
+	const int cy = Tile_GetPackedY(packed) >> HPA_CLUSTER_SHIFT;
+
+	return HPA_CLUSTER_WIDTH * cy + cx;
+}
+
+/**
+ * Get the cost of entering a tile, ignoring units.
+ *
+ * @return HPA_COST_NONE if the tile is not accessable.
+ */
+static uint16
+Pathfinder_GetStaticCost(enum UnitMovementType mt, uint16 packed)
+{
+	if (!Map_IsValidPosition(packed)) return HPA_COST_NONE;
+	if (g_map[packed].hasStructure) return HPA_COST_NONE;
+
+	const uint8 speed = Map_GetMovementSpeed(packed, mt);
+	if (speed == 0) return HPA_COST_NONE;
+
+	return PATHFINDER_STEP_COST + (speed ^ 0xFF);
+}
+
+/**
+ * Compute the cost from a tile to every other tile of its cluster,
+ *  staying within the cluster, into s_clusterDistance.
+ */
+static void
+Pathfinder_ClusterDistance(enum UnitMovementType mt, uint16 packedSrc)
+{
+	const int x0 = Tile_GetPackedX(packedSrc) & ~(HPA_CLUSTER_SIZE - 1);
+	const int y0 = Tile_GetPackedY(packedSrc) & ~(HPA_CLUSTER_SIZE - 1);
+	bool done[HPA_CLUSTER_SIZE * HPA_CLUSTER_SIZE];
+
+	memset(done, 0, sizeof(done));
+	memset(s_clusterDistance, 0xFF, sizeof(s_clusterDistance));
+
+	s_clusterDistance[HPA_CLUSTER_SIZE * (Tile_GetPackedY(packedSrc) - y0) + (Tile_GetPackedX(packedSrc) - x0)] = 0;
+
+	while (true) {
+		int cur = -1;
+
+		for (int i = 0; i < HPA_CLUSTER_SIZE * HPA_CLUSTER_SIZE; i++) {
+			if (done[i] || s_clusterDistance[i] == HPA_COST_NONE) continue;
+			if (cur < 0 || s_clusterDistance[i] < s_clusterDistance[cur]) cur = i;
+		}
+
+		if (cur < 0) break;
+		done[cur] = true;
+		s_expanded++;
+
+		const int x = cur % HPA_CLUSTER_SIZE;
+		const int y = cur / HPA_CLUSTER_SIZE;
+
+		for (uint8 direction = 0; direction < 8; direction++) {
+			const int nx = x + s_directionX[direction];
+			const int ny = y + s_directionY[direction];
+
+			if (!(0 <= nx && nx < HPA_CLUSTER_SIZE && 0 <= ny && ny < HPA_CLUSTER_SIZE)) continue;
+
+			const int next = HPA_CLUSTER_SIZE * ny + nx;
+			if (done[next]) continue;
+
+			const uint16 cost = Pathfinder_GetStaticCost(mt, Tile_PackXY(x0 + nx, y0 + ny));
+			if (cost == HPA_COST_NONE) continue;
+
+			if (s_clusterDistance[cur] + cost < s_clusterDistance[next])
+				s_clusterDistance[next] = s_clusterDistance[cur] + cost;
+		}
+	}
+}
+
+static uint16
+Pathfinder_GetClusterDistance(uint16 packed)
+{
+	const int x = Tile_GetPackedX(packed) & (HPA_CLUSTER_SIZE - 1);
+	const int y = Tile_GetPackedY(packed) & (HPA_CLUSTER_SIZE - 1);
+
+	return s_clusterDistance[HPA_CLUSTER_SIZE * y + x];
+}
+
+static void
+Pathfinder_BuildCluster(enum UnitMovementType mt, uint16 index)
+{
+	/* Borders: N, E, S, W.  Start tile, step along the border, and
+	 * step across it.
+	 */
+	static const struct {
+		int x, y, dx, dy, ox, oy;
+	} border[4] = {
+		{ 0,                    0,                    1, 0,  0, -1 },
+		{ HPA_CLUSTER_SIZE - 1, 0,                    0, 1,  1,  0 },
+		{ 0,                    HPA_CLUSTER_SIZE - 1, 1, 0,  0,  1 },
+		{ 0,                    0,                    0, 1, -1,  0 },
+	};
+
+	HPACluster *cl = &s_cluster[mt][index];
+	const int x0 = HPA_CLUSTER_SIZE * (index % HPA_CLUSTER_WIDTH);
+	const int y0 = HPA_CLUSTER_SIZE * (index / HPA_CLUSTER_WIDTH);
+
+	cl->valid = true;
+	cl->count = 0;
+
+	for (int b = 0; b < 4; b++) {
+		int start = -1;
+
+		for (int i = 0; i <= HPA_CLUSTER_SIZE; i++) {
+			const int x = x0 + border[b].x + border[b].dx * i;
+			const int y = y0 + border[b].y + border[b].dy * i;
+			bool open = false;
+
+			if (i < HPA_CLUSTER_SIZE && Map_InRangeX(x + border[b].ox) && Map_InRangeY(y + border[b].oy)) {
+				open = Pathfinder_GetStaticCost(mt, Tile_PackXY(x, y)) != HPA_COST_NONE
+					&& Pathfinder_GetStaticCost(mt, Tile_PackXY(x + border[b].ox, y + border[b].oy)) != HPA_COST_NONE;
+			}
+
+			if (open && start < 0) start = i;
+			if (open || start < 0) continue;
+
+			/* End of a run: place the entrance in its middle. */
+			const int mid = (start + i - 1) / 2;
+			const int mx = x0 + border[b].x + border[b].dx * mid;
+			const int my = y0 + border[b].y + border[b].dy * mid;
+
+			assert(cl->count < HPA_CLUSTER_NODES_MAX);
+			cl->node[cl->count].packed  = Tile_PackXY(mx, my);
+			cl->node[cl->count].partner = Tile_PackXY(mx + border[b].ox, my + border[b].oy);
+			cl->count++;
+
+			start = -1;
+		}
+	}
+
+	for (int i = 0; i < cl->count; i++) {
+		Pathfinder_ClusterDistance(mt, cl->node[i].packed);
+
+		for (int j = 0; j < cl->count; j++)
+			cl->cost[i][j] = Pathfinder_GetClusterDistance(cl->node[j].packed);
+	}
+}
+
+/**
+ * Label the connected areas of the map for a movement type, by flood
+ *  filling from every accessable tile not yet labelled.
+ */
+static void
+Pathfinder_BuildComponents(enum UnitMovementType mt)
+{
+	uint16 *component = s_component[mt];
+	uint16 queue[MAP_SIZE_MAX * MAP_SIZE_MAX];
+	uint16 label = 0;
+
+	s_componentValid[mt] = true;
+	memset(component, 0, sizeof(s_component[mt]));
+
+	for (uint16 start = 0; start < MAP_SIZE_MAX * MAP_SIZE_MAX; start++) {
+		if (component[start] != 0) continue;
+		if (Pathfinder_GetStaticCost(mt, start) == HPA_COST_NONE) continue;
+
+		int head = 0;
+		int tail = 0;
+
+		label++;
+		component[start] = label;
+		queue[tail++] = start;
+
+		while (head < tail) {
+			const uint16 packed = queue[head++];
+			const int x = Tile_GetPackedX(packed);
+			const int y = Tile_GetPackedY(packed);
+
+			for (uint8 direction = 0; direction < 8; direction++) {
+				if (!(Map_InRangeX(x + s_directionX[direction]) && Map_InRangeY(y + s_directionY[direction])))
+					continue;
+
+				const uint16 packedNext = packed + s_mapDirection[direction];
+				if (component[packedNext] != 0) continue;
+				if (Pathfinder_GetStaticCost(mt, packedNext) == HPA_COST_NONE) continue;
+
+				component[packedNext] = label;
+				queue[tail++] = packedNext;
+			}
+		}
+
+		s_expanded += tail;
+	}
+}
+
+/**
+ * Get the connected area of a tile, ignoring units.  Two tiles with
+ *  the same label can reach each other.
+ *
+ * @return The label, or 0 if the tile is not accessable.
+ */
+static uint16
+Pathfinder_GetComponent(enum UnitMovementType mt, uint16 packed)
+{
+	assert(mt < MOVEMENT_MAX);
+
+	if (!s_componentValid[mt]) Pathfinder_BuildComponents(mt);
+
+	return s_component[mt][packed];
+}
+
+/**
+ * Check whether a unit could reach a tile, ignoring other units.  A
+ *  destination that is not accessable itself, such as a structure, is
+ *  reachable when one of its neighbours is.
+ */
+bool
+Pathfinder_IsReachable(enum UnitMovementType mt, uint16 packedSrc, uint16 packedDst)
+{
+	if (mt == MOVEMENT_WINGER) return true;
+
+	const uint16 src = Pathfinder_GetComponent(mt, packedSrc);
+	const uint16 dst = Pathfinder_GetComponent(mt, packedDst);
+
+	/* Not on accessable ground, e.g. while leaving a structure. */
+	if (src == 0) return true;
+	if (dst != 0) return (src == dst);
+
+	const int x = Tile_GetPackedX(packedDst);
+	const int y = Tile_GetPackedY(packedDst);
+
+	for (uint8 direction = 0; direction < 8; direction++) {
+		if (!(Map_InRangeX(x + s_directionX[direction]) && Map_InRangeY(y + s_directionY[direction])))
+			continue;
+
+		if (s_component[mt][packedDst + s_mapDirection[direction]] == src) return true;
+	}
+
+	return false;
+}
+
+static void
+Pathfinder_HPA_Relax(uint16 state, uint16 prev, int32 cost, uint16 packed, uint16 packedDst)
+{
+	if (s_hpaClosed[state] == s_hpaGeneration) return;
+	if (s_hpaReached[state] == s_hpaGeneration && cost >= s_hpaCost[state]) return;
+
+	s_hpaReached[state] = s_hpaGeneration;
+	s_hpaCost[state] = cost;
+	s_hpaPrev[state] = prev;
+
+	const int32 h = (state == HPA_STATE_GOAL) ? 0 : Pathfinder_Heuristic(packed, packedDst);
+	PathfinderNode *node = BinHeap_Push(&s_open, ((int64_t)(cost + h) << 32) | ((int64_t)h << 16) | state);
+	if (node != NULL) node->packed = state;
+}
+
+/**
+ * Plan a route over the cluster graph, and return the furthest
+ *  entrance on it within HPA_WAYPOINT_DISTANCE of the start.
+ *
+ * @return The entrance tile, or 0xFFFF if there is no route.
+ */
+static uint16
+Pathfinder_HPA_FindWaypoint(enum UnitMovementType mt, uint16 packedSrc, uint16 packedDst)
+{
+	const uint16 clusterSrc = Pathfinder_GetCluster(packedSrc);
+	const uint16 clusterDst = Pathfinder_GetCluster(packedDst);
+	uint16 distanceDst[HPA_CLUSTER_NODES_MAX];
+
+	if (Pathfinder_GetStaticCost(mt, packedDst) == HPA_COST_NONE) return 0xFFFF;
+	if (!Pathfinder_IsReachable(mt, packedSrc, packedDst)) return 0xFFFF;
+
+	if (!s_cluster[mt][clusterSrc].valid) Pathfinder_BuildCluster(mt, clusterSrc);
+	if (!s_cluster[mt][clusterDst].valid) Pathfinder_BuildCluster(mt, clusterDst);
+
+	if (++s_hpaGeneration == 0) {
+		memset(s_hpaReached, 0, sizeof(s_hpaReached));
+		memset(s_hpaClosed, 0, sizeof(s_hpaClosed));
+		s_hpaGeneration = 1;
+	}
+
+	BinHeap_Init(&s_open, sizeof(PathfinderNode));
+
+	/* The cost from the entrances of the destination cluster to the
+	 * destination.  This is measured from the destination, which is
+	 * close enough for planning.
+	 */
+	const HPACluster *cl = &s_cluster[mt][clusterDst];
+	Pathfinder_ClusterDistance(mt, packedDst);
+	for (int i = 0; i < cl->count; i++)
+		distanceDst[i] = Pathfinder_GetClusterDistance(cl->node[i].packed);
+
+	cl = &s_cluster[mt][clusterSrc];
+	Pathfinder_ClusterDistance(mt, packedSrc);
+	for (int i = 0; i < cl->count; i++) {
+		const uint16 cost = Pathfinder_GetClusterDistance(cl->node[i].packed);
+		if (cost == HPA_COST_NONE) continue;
+
+		Pathfinder_HPA_Relax(HPA_CLUSTER_NODES_MAX * clusterSrc + i, HPA_STATE_NONE, cost, cl->node[i].packed, packedDst);
+	}
+
+	bool found = false;
+
+	for (const PathfinderNode *node = BinHeap_GetMin(&s_open);
+			node != NULL;
+			node = BinHeap_GetMin(&s_open)) {
+		const uint16 state = node->packed;
+		BinHeap_Pop(&s_open);
+
+		if (s_hpaClosed[state] == s_hpaGeneration) continue;
+		s_hpaClosed[state] = s_hpaGeneration;
+		s_expanded++;
+
+		if (state == HPA_STATE_GOAL) {
+			found = true;
+			break;
+		}
+
+		const uint16 cluster = state / HPA_CLUSTER_NODES_MAX;
+		const int i = state % HPA_CLUSTER_NODES_MAX;
+		const int32 g = s_hpaCost[state];
+		cl = &s_cluster[mt][cluster];
+
+		if (cluster == clusterDst && distanceDst[i] != HPA_COST_NONE)
+			Pathfinder_HPA_Relax(HPA_STATE_GOAL, state, g + distanceDst[i], packedDst, packedDst);
+
+		for (int j = 0; j < cl->count; j++) {
+			if (j == i || cl->cost[i][j] == HPA_COST_NONE) continue;
+
+			Pathfinder_HPA_Relax(HPA_CLUSTER_NODES_MAX * cluster + j, state, g + cl->cost[i][j], cl->node[j].packed, packedDst);
+		}
+
+		/* Cross the border to the partner entrance. */
+		const uint16 packed = cl->node[i].packed;
+		const uint16 partner = cl->node[i].partner;
+		const uint16 clusterNext = Pathfinder_GetCluster(partner);
+		const HPACluster *next = &s_cluster[mt][clusterNext];
+
+		if (!next->valid) Pathfinder_BuildCluster(mt, clusterNext);
+
+		for (int j = 0; j < next->count; j++) {
+			if (next->node[j].packed != partner || next->node[j].partner != packed) continue;
+
+			Pathfinder_HPA_Relax(HPA_CLUSTER_NODES_MAX * clusterNext + j, state, g + Pathfinder_GetStaticCost(mt, partner), partner, packedDst);
+			break;
+		}
+	}
+
+	if (!found) return 0xFFFF;
+
+	/* Walk back to the first entrance. */
+	uint16 path[HPA_STATE_COUNT];
+	int length = 0;
+
+	for (uint16 state = s_hpaPrev[HPA_STATE_GOAL]; state != HPA_STATE_NONE; state = s_hpaPrev[state])
+		path[length++] = state;
+
+	uint16 waypoint = 0xFFFF;
+
+	for (int i = length - 1; i >= 0; i--) {
+		const uint16 packed = s_cluster[mt][path[i] / HPA_CLUSTER_NODES_MAX].node[path[i] % HPA_CLUSTER_NODES_MAX].packed;
+		const int dx = abs(Tile_GetPackedX(packed) - Tile_GetPackedX(packedSrc));
+		const int dy = abs(Tile_GetPackedY(packed) - Tile_GetPackedY(packedSrc));
+
+		if (waypoint != 0xFFFF && waypoint != packedSrc && max(dx, dy) > HPA_WAYPOINT_DISTANCE) break;
+
+		waypoint = packed;
+	}
+
+	return (waypoint == packedSrc) ? packedDst : waypoint;
+}
+
+/*--------------------------------------------------------------*/
+
+/* Flow fields.
+ *
+ * When many units are ordered to the same tile at once, they would
+ * each run their own search.  Instead, the cost to the destination is
+ * computed once for every tile (the integration field), along with
+ * the cheapest direction to take from each tile (the direction
+ * field).  Units then just follow the directions.  The most recently
+ * used fields are kept, keyed by destination and movement type.
+ *
+ * Like the cluster graph, the fields only consider the landscape and
+ * structures.  If a unit blocks the first step, the unit searches for
+ * its own route.
+ */
+
+enum {
+	FLOWFIELD_CACHE_SIZE = 8,
+
+	/* Orders to the same tile in the same tick that make a group. */
+	FLOWFIELD_GROUP_SIZE = 4,
+
+	FLOWFIELD_DIRECTION_NONE = 0xFF
+};
+
+typedef struct FlowField {
+	uint16 packedDst;                                       /*!< The destination tile, or 0xFFFF if unused. */
+	enum UnitMovementType movementType;                     /*!< The movement type. */
+	int64_t tickOrdered;                                    /*!< The tick of the last order to this destination. */
+	uint16 orders;                                          /*!< The number of orders issued in that tick. */
+	uint32 lastUsed;                                        /*!< For least recently used replacement. */
+	bool built;                                             /*!< The fields below are valid. */
+	uint32 mapGeneration;                                   /*!< s_mapGeneration when built. */
+
+	uint32 integration[MAP_SIZE_MAX * MAP_SIZE_MAX];        /*!< Cost to the destination from each tile. */
+	uint8 direction[MAP_SIZE_MAX * MAP_SIZE_MAX];           /*!< Direction towards the destination from each tile. */
+} FlowField;
+
+static FlowField s_flowField[FLOWFIELD_CACHE_SIZE];
+static uint32 s_flowFieldClock;
+
+static FlowField *
+Pathfinder_FlowField_Find(uint16 packedDst, enum UnitMovementType mt)
+{
+	for (int i = 0; i < FLOWFIELD_CACHE_SIZE; i++) {
+		FlowField *ff = &s_flowField[i];
+
+		if (ff->lastUsed != 0 && ff->packedDst == packedDst && ff->movementType == mt) {
+			ff->lastUsed = ++s_flowFieldClock;
+			return ff;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Note that a unit was ordered to move to a tile.  Once enough units
+ *  are ordered to the same tile in one tick, they will share a flow
+ *  field.
+ */
+void
+Pathfinder_FlowField_AddOrder(uint16 packedDst, enum UnitMovementType mt)
+{
+	if (mt == MOVEMENT_WINGER) return;
+
+	FlowField *ff = Pathfinder_FlowField_Find(packedDst, mt);
+
+	if (ff == NULL) {
+		ff = &s_flowField[0];
+
+		for (int i = 1; i < FLOWFIELD_CACHE_SIZE; i++) {
+			if (s_flowField[i].lastUsed < ff->lastUsed) ff = &s_flowField[i];
+		}
+
+		ff->packedDst = packedDst;
+		ff->movementType = mt;
+		ff->tickOrdered = g_timerGame;
+		ff->orders = 0;
+		ff->lastUsed = ++s_flowFieldClock;
+		ff->built = false;
+	}
+
+	if (ff->tickOrdered != g_timerGame) {
+		ff->tickOrdered = g_timerGame;
+		ff->orders = 0;
+	}
+
+	if (ff->orders < FLOWFIELD_GROUP_SIZE) ff->orders++;
+}
+
+static void
+Pathfinder_FlowField_Build(FlowField *ff)
+{
+	const enum UnitMovementType mt = ff->movementType;
+
+	ff->built = true;
+	ff->mapGeneration = s_mapGeneration;
+
+	memset(ff->integration, 0xFF, sizeof(ff->integration));
+	memset(ff->direction, FLOWFIELD_DIRECTION_NONE, sizeof(ff->direction));
+
+	if (++s_generation == 0) {
+		memset(s_reached, 0, sizeof(s_reached));
+		memset(s_closed, 0, sizeof(s_closed));
+		s_generation = 1;
+	}
+
+	BinHeap_Init(&s_open, sizeof(PathfinderNode));
+
+	/* Search outwards from the destination.  Moving from a tile to its
+	 * neighbour costs entering the neighbour; the destination itself
+	 * may be a structure.
+	 */
+	ff->integration[ff->packedDst] = 0;
+
+	PathfinderNode *node = BinHeap_Push(&s_open, ff->packedDst);
+	if (node != NULL) node->packed = ff->packedDst;
+
+	for (node = BinHeap_GetMin(&s_open); node != NULL; node = BinHeap_GetMin(&s_open)) {
+		const uint16 packed = node->packed;
+		BinHeap_Pop(&s_open);
+
+		if (s_closed[packed] == s_generation) continue;
+		s_closed[packed] = s_generation;
+		s_expanded++;
+
+		const uint16 cost = (packed == ff->packedDst) ? PATHFINDER_STEP_COST : Pathfinder_GetStaticCost(mt, packed);
+		if (cost == HPA_COST_NONE) continue;
+
+		const int x = Tile_GetPackedX(packed);
+		const int y = Tile_GetPackedY(packed);
+
+		for (uint8 direction = 0; direction < 8; direction++) {
+			if (!(Map_InRangeX(x + s_directionX[direction]) && Map_InRangeY(y + s_directionY[direction])))
+				continue;
+
+			const uint16 packedPrev = packed + s_mapDirection[direction];
+			if (s_closed[packedPrev] == s_generation) continue;
+
+			const uint32 integration = ff->integration[packed] + cost;
+			if (integration >= ff->integration[packedPrev]) continue;
+
+			ff->integration[packedPrev] = integration;
+			ff->direction[packedPrev] = (direction + 4) & 0x7;
+
+			PathfinderNode *prev = BinHeap_Push(&s_open, ((int64_t)integration << 16) | packedPrev);
+			if (prev == NULL) break;
+
+			prev->packed = packedPrev;
+		}
+	}
+}
+
+/**
+ * Follow the flow field to a tile, if there is one for a group order.
+ *
+ * @return The size of the route, including the terminator, or 0 if
+ *  the unit should search for its own route.
+ */
+static uint16
+Pathfinder_FlowField_Follow(struct Unit *u, enum UnitMovementType mt, uint16 packedSrc, uint16 packedDst, uint8 *buffer, uint16 bufferSize, int16 *score)
+{
+	FlowField *ff = Pathfinder_FlowField_Find(packedDst, mt);
+
+	if (ff == NULL || ff->orders < FLOWFIELD_GROUP_SIZE) return 0;
+
+	if (!ff->built || ff->mapGeneration != s_mapGeneration)
+		Pathfinder_FlowField_Build(ff);
+
+	const uint8 first = ff->direction[packedSrc];
+	if (first == FLOWFIELD_DIRECTION_NONE) return 0;
+	if (Pathfinder_GetScore(u, packedSrc + s_mapDirection[first], first) > 255) return 0;
+
+	uint16 routeSize = 0;
+	int16 routeScore = 0;
+
+	for (uint16 packed = packedSrc; packed != packedDst && routeSize < bufferSize - 1; routeSize++) {
+		const uint8 direction = ff->direction[packed];
+		if (direction == FLOWFIELD_DIRECTION_NONE) break;
+
+		packed += s_mapDirection[direction];
+		buffer[routeSize] = direction;
+		routeScore += ff->integration[packed - s_mapDirection[direction]] - ff->integration[packed] - PATHFINDER_STEP_COST;
+	}
+
+	buffer[routeSize] = 0xFF;
+
+	if (score != NULL) *score = routeScore;
+
+	return routeSize + 1;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+ * Find a route between two tiles.  Units ordered to the same tile as
+ *  a group follow a shared flow field.  Otherwise long routes are
+ *  first planned over the cluster graph, then the tile search finds
+ *  the way to the first entrances on the plan.  Destinations the unit
+ *  cannot reach get an empty route.
+ *
+ * @see Pathfinder_AStar.
+ */
+uint16
+Pathfinder_FindRoute(struct Unit *u, uint16 packedSrc, uint16 packedDst, uint8 *buffer, uint16 bufferSize, int16 *score)
+{
+	assert(u != NULL);
+
+	const enum UnitMovementType mt = g_table_unitInfo[u->o.type].movementType;
+	const int dx = abs(Tile_GetPackedX(packedSrc) - Tile_GetPackedX(packedDst));
+	const int dy = abs(Tile_GetPackedY(packedSrc) - Tile_GetPackedY(packedDst));
+
+	/* Do not spend the node budget searching for a tile in another
+	 * connected component.
+	 */
+	if (!Pathfinder_IsReachable(mt, packedSrc, packedDst)) {
+		buffer[0] = 0xFF;
+		if (score != NULL) *score = 0;
+		return 1;
+	}
+
+	if (mt != MOVEMENT_WINGER) {
+		const uint16 routeSize = Pathfinder_FlowField_Follow(u, mt, packedSrc, packedDst, buffer, bufferSize, score);
+
+		if (routeSize != 0)
+			return routeSize;
+	}
+
+	if (mt != MOVEMENT_WINGER
+			&& max(dx, dy) > HPA_DIRECT_DISTANCE
+			&& Pathfinder_GetCluster(packedSrc) != Pathfinder_GetCluster(packedDst)) {
+		const uint16 waypoint = Pathfinder_HPA_FindWaypoint(mt, packedSrc, packedDst);
+
+		if (waypoint != 0xFFFF)
+			return Pathfinder_AStar(u, packedSrc, waypoint, buffer, bufferSize, score);
+	}
+
+	return Pathfinder_AStar(u, packedSrc, packedDst, buffer, bufferSize, score);
+}
+
+/*--------------------------------------------------------------*/
+
+/* Route requests.
+ *
+ * Searching for every unit as soon as it asks can take many
+ * milliseconds in a single tick, for example when a large group is
+ * given orders at once.  Instead, units queue a request and stand
+ * still until the route is ready.  Once per tick, the queue is served
+ * in the order the requests were made until enhancement_astar_pathfinder_budget
+ * nodes have been expanded.  A search that has started always
+ * finishes, so a tick expands at most the budget plus one search.
+ *
+ * Requests are made and served during the server logic only, in a
+ * fixed order, so the tick on which a unit receives its route does
+ * not depend on the speed of the machine.
+ */
+
+enum {
+	QUEUE_ROUTE_SIZE = 15
+};
+
+typedef enum RouteRequestState {
+	ROUTE_REQUEST_NONE,
+	ROUTE_REQUEST_QUEUED,
+	ROUTE_REQUEST_DONE
+} RouteRequestState;
+
+typedef struct RouteRequest {
+	RouteRequestState state;                                /*!< Whether the request is waiting or answered. */
+	uint8 unitType;                                         /*!< The type of unit that made the request. */
+	uint16 packedSrc;                                       /*!< The start point. */
+	uint16 packedDst;                                       /*!< The end point. */
+	uint16 routeSize;                                       /*!< The size of the route, including the terminator. */
+	uint8 route[QUEUE_ROUTE_SIZE];                          /*!< The route, once answered. */
+} RouteRequest;
+
+static RouteRequest s_request[UNIT_INDEX_MAX_RAISED];       /*!< The request of each unit, by index. */
+static uint16 s_queue[UNIT_INDEX_MAX_RAISED];               /*!< Indices of the units waiting, in order. */
+static uint16 s_queueHead;
+static uint16 s_queueCount;
+
+void
+Pathfinder_Queue_Clear(void)
+{
+	memset(s_request, 0, sizeof(s_request));
+	s_queueHead = 0;
+	s_queueCount = 0;
+}
+
+/**
+ * Get the route for a unit from the queue, or request one.
+ *
+ * @param u The unit to find a route for.
+ * @param packedSrc The start point.
+ * @param packedDst The end point.
+ * @param buffer The buffer to store the route in.
+ * @param bufferSize The size of the buffer.
+ * @return The size of the route, including the terminator, or 0 if
+ *  the route is not ready yet.
+ */
+uint16
+Pathfinder_Queue_GetRoute(struct Unit *u, uint16 packedSrc, uint16 packedDst, uint8 *buffer, uint16 bufferSize)
+{
+	assert(u != NULL);
+	assert(u->o.index < UNIT_INDEX_MAX_RAISED);
+	assert(bufferSize >= 1);
+
+	RouteRequest *req = &s_request[u->o.index];
+
+	if (req->state == ROUTE_REQUEST_DONE
+			&& req->unitType == u->o.type
+			&& req->packedSrc == packedSrc
+			&& req->packedDst == packedDst) {
+		const uint16 routeSize = min(req->routeSize, bufferSize);
+
+		memcpy(buffer, req->route, routeSize);
+		buffer[routeSize - 1] = 0xFF;
+		req->state = ROUTE_REQUEST_NONE;
+		return routeSize;
+	}
+
+	/* A unit waiting in the queue keeps its place when its request
+	 * changes.
+	 */
+	if (req->state != ROUTE_REQUEST_QUEUED) {
+		assert(s_queueCount < UNIT_INDEX_MAX_RAISED);
+
+		s_queue[(s_queueHead + s_queueCount) % UNIT_INDEX_MAX_RAISED] = u->o.index;
+		s_queueCount++;
+		req->state = ROUTE_REQUEST_QUEUED;
+	}
+
+	req->unitType = u->o.type;
+	req->packedSrc = packedSrc;
+	req->packedDst = packedDst;
+	return 0;
+}
+
+/**
+ * Answer queued route requests, until the per-tick budget is spent.
+ */
+void
+Pathfinder_ProcessQueue(void)
+{
+	const int budget = max(1, enhancement_astar_pathfinder_budget);
+
+	s_expanded = 0;
+
+	while (s_queueCount > 0 && s_expanded < budget) {
+		const uint16 index = s_queue[s_queueHead];
+		RouteRequest *req = &s_request[index];
+		Unit *u = Unit_Get_ByIndex(index);
+
+		s_queueHead = (s_queueHead + 1) % UNIT_INDEX_MAX_RAISED;
+		s_queueCount--;
+
+		/* Drop requests from units that are gone or have moved since. */
+		if (!u->o.flags.s.used
+				|| u->o.type != req->unitType
+				|| Tile_PackTile(u->o.position) != req->packedSrc) {
+			req->state = ROUTE_REQUEST_NONE;
+			continue;
+		}
+
+		req->routeSize = Pathfinder_FindRoute(u, req->packedSrc, req->packedDst, req->route, QUEUE_ROUTE_SIZE, NULL);
+		req->state = ROUTE_REQUEST_DONE;
+	}
+}
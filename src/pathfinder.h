@@ -0,0 +1,26 @@
+/** @file src/pathfinder.h A* and hierarchical pathfinder definitions. */
+
+#ifndef PATHFINDER_H
+#define PATHFINDER_H
+
+#include "enum_unit.h"
+#include "types.h"
+
+enum {
+	PATHFINDER_NODE_BUDGET = 1024                           /*!< Maximum number of tiles expanded per search. */
+};
+
+struct Unit;
+
+extern void Pathfinder_Uninit(void);
+extern uint16 Pathfinder_AStar(struct Unit *u, uint16 packedSrc, uint16 packedDst, uint8 *buffer, uint16 bufferSize, int16 *score);
+extern void Pathfinder_InvalidateTile(uint16 packed);
+extern void Pathfinder_InvalidateAll(void);
+extern bool Pathfinder_IsReachable(enum UnitMovementType mt, uint16 packedSrc, uint16 packedDst);
+extern void Pathfinder_FlowField_AddOrder(uint16 packedDst, enum UnitMovementType mt);
+extern uint16 Pathfinder_FindRoute(struct Unit *u, uint16 packedSrc, uint16 packedDst, uint8 *buffer, uint16 bufferSize, int16 *score);
+extern void Pathfinder_Queue_Clear(void);
+extern uint16 Pathfinder_Queue_GetRoute(struct Unit *u, uint16 packedSrc, uint16 packedDst, uint8 *buffer, uint16 bufferSize);
+extern void Pathfinder_ProcessQueue(void);
+
+#endif /* PATHFINDER_H */
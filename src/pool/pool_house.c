@@ -5,7 +5,9 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
+#include "../os/common.h"
 
 #include "pool_house.h"
 
@@ -204,3 +206,70 @@ HousePool_Load(HousePool *pool)
 
 	pool->allocated = false;
 }
+
+/**
+ * @brief   Allocates a HousePool to hold a snapshot.
+ * @details Introduced for world snapshots.
+ */
+HousePool *
+HousePool_Alloc(void)
+{
+	HousePool *pool = calloc(1, sizeof(*pool));
+	assert(pool != NULL);
+
+	return pool;
+}
+
+/**
+ * @brief   Frees a HousePool allocated by HousePool_Alloc.
+ * @details Introduced for world snapshots.
+ */
+void
+HousePool_Free(HousePool *pool)
+{
+	if (pool == NULL)
+		return;
+
+	for (unsigned int i = 0; i < lengthof(pool->pool); i++)
+		BuildQueue_Free(&pool->pool[i].starportQueue);
+
+	free(pool);
+}
+
+/**
+ * @brief   Copies the HousePool into a snapshot.
+ * @details Introduced for world snapshots.  Unlike HousePool_Save,
+ *          the build queues are duplicated, so the snapshot can be
+ *          loaded any number of times.
+ */
+void
+HousePool_SaveTo(HousePool *pool)
+{
+	for (unsigned int i = 0; i < lengthof(pool->pool); i++)
+		BuildQueue_Free(&pool->pool[i].starportQueue);
+
+	memcpy(pool->pool, s_houseArray, sizeof(s_houseArray));
+	memcpy(pool->find, s_houseFindArray, sizeof(s_houseFindArray));
+	pool->count = s_houseFindCount;
+
+	for (unsigned int i = 0; i < lengthof(pool->pool); i++)
+		BuildQueue_Copy(&pool->pool[i].starportQueue, &s_houseArray[i].starportQueue);
+}
+
+/**
+ * @brief   Restores the HousePool from a snapshot, which is left intact.
+ * @details Introduced for world snapshots.
+ */
+void
+HousePool_LoadFrom(const HousePool *pool)
+{
+	for (unsigned int i = 0; i < lengthof(s_houseArray); i++)
+		BuildQueue_Free(&s_houseArray[i].starportQueue);
+
+	memcpy(s_houseArray, pool->pool, sizeof(s_houseArray));
+	memcpy(s_houseFindArray, pool->find, sizeof(s_houseFindArray));
+	s_houseFindCount = pool->count;
+
+	for (unsigned int i = 0; i < lengthof(s_houseArray); i++)
+		BuildQueue_Copy(&s_houseArray[i].starportQueue, &pool->pool[i].starportQueue);
+}
@@ -20,5 +20,9 @@ extern void House_Free(struct House *h);
 
 extern struct HousePool *HousePool_Save(void);
 extern void HousePool_Load(struct HousePool *pool);
+extern struct HousePool *HousePool_Alloc(void);
+extern void HousePool_Free(struct HousePool *pool);
+extern void HousePool_SaveTo(struct HousePool *pool);
+extern void HousePool_LoadFrom(const struct HousePool *pool);
 
 #endif
@@ -13,6 +13,7 @@
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
+#include "../os/common.h"
 
 #include "pool_structure.h"
 
@@ -41,6 +42,11 @@ static Structure *s_structureFindArray[STRUCTURE_INDEX_MAX_SOFT + STRUCTURE_INDE
 static uint16 s_structureFindCount;
 
 static StructurePool s_structurePoolBackup;
+
+/* Generation of each structure, bumped whenever state sent to clients
+ * may have changed.  Readers remember the generation they last saw.
+ */
+static uint32 s_structureGeneration[STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT];
 assert_compile(sizeof(s_structurePoolBackup.pool) == sizeof(s_structureArray));
 assert_compile(sizeof(s_structurePoolBackup.find) == sizeof(s_structureFindArray));
 
@@ -143,6 +149,14 @@ Structure_FindNext(PoolFindStruct *find)
 	return NULL;
 }
 
+static void
+StructurePool_MarkAllDirty(void)
+{
+	for (unsigned int i = 0; i < STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT; i++) {
+		s_structureGeneration[i]++;
+	}
+}
+
 /**
  * @brief   Initialise the Structure pool.
  * @details f__1082_0098_001C_39E2.
@@ -162,6 +176,7 @@ Structure_Init(void)
 	Structure_Allocate(0, STRUCTURE_SLAB_1x1);
 	Structure_Allocate(0, STRUCTURE_SLAB_2x2);
 	Structure_Allocate(0, STRUCTURE_WALL);
+	StructurePool_MarkAllDirty();
 }
 
 /**
@@ -191,6 +206,8 @@ Structure_Recount(void)
 			s_structureFindCount++;
 		}
 	}
+
+	StructurePool_MarkAllDirty();
 }
 
 /**
@@ -252,6 +269,7 @@ Structure_Allocate(uint16 index, enum StructureType type)
 	s->o.flags.s.used      = true;
 	s->o.flags.s.allocated = true;
 
+	StructurePool_MarkDirty(s);
 	return s;
 }
 
@@ -269,6 +287,7 @@ Structure_Free(Structure *s)
 	memset(&s->o.flags, 0, sizeof(s->o.flags));
 
 	Script_Reset(&s->o.script, g_scriptStructure);
+	StructurePool_MarkDirty(s);
 
 	if (Structure_SharesPoolElement(s->o.type))
 		return;
@@ -328,6 +347,76 @@ StructurePool_Load(StructurePool *pool)
 	s_structureFindCount = pool->count;
 
 	pool->allocated = false;
+	StructurePool_MarkAllDirty();
+}
+
+/**
+ * @brief   Allocates a StructurePool to hold a snapshot.
+ * @details Introduced for world snapshots.
+ */
+StructurePool *
+StructurePool_Alloc(void)
+{
+	StructurePool *pool = calloc(1, sizeof(*pool));
+	assert(pool != NULL);
+
+	return pool;
+}
+
+/**
+ * @brief   Frees a StructurePool allocated by StructurePool_Alloc.
+ * @details Introduced for world snapshots.
+ */
+void
+StructurePool_Free(StructurePool *pool)
+{
+	if (pool == NULL)
+		return;
+
+	for (unsigned int i = 0; i < lengthof(pool->pool); i++)
+		BuildQueue_Free(&pool->pool[i].queue);
+
+	free(pool);
+}
+
+/**
+ * @brief   Copies the StructurePool into a snapshot.
+ * @details Introduced for world snapshots.  Unlike StructurePool_Save,
+ *          the build queues are duplicated, so the snapshot can be
+ *          loaded any number of times.
+ */
+void
+StructurePool_SaveTo(StructurePool *pool)
+{
+	for (unsigned int i = 0; i < lengthof(pool->pool); i++)
+		BuildQueue_Free(&pool->pool[i].queue);
+
+	memcpy(pool->pool, s_structureArray, sizeof(s_structureArray));
+	memcpy(pool->find, s_structureFindArray, sizeof(s_structureFindArray));
+	pool->count = s_structureFindCount;
+
+	for (unsigned int i = 0; i < lengthof(pool->pool); i++)
+		BuildQueue_Copy(&pool->pool[i].queue, &s_structureArray[i].queue);
+}
+
+/**
+ * @brief   Restores the StructurePool from a snapshot, which is left intact.
+ * @details Introduced for world snapshots.
+ */
+void
+StructurePool_LoadFrom(const StructurePool *pool)
+{
+	for (unsigned int i = 0; i < lengthof(s_structureArray); i++)
+		BuildQueue_Free(&s_structureArray[i].queue);
+
+	memcpy(s_structureArray, pool->pool, sizeof(s_structureArray));
+	memcpy(s_structureFindArray, pool->find, sizeof(s_structureFindArray));
+	s_structureFindCount = pool->count;
+
+	for (unsigned int i = 0; i < lengthof(s_structureArray); i++)
+		BuildQueue_Copy(&s_structureArray[i].queue, &pool->pool[i].queue);
+
+	StructurePool_MarkAllDirty();
 }
 
 uint16
@@ -337,4 +426,24 @@ StructurePool_GetIndex(int index)
 		return index + STRUCTURE_INDEX_RAISED_AMOUNT;
 
 	return index;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief   Note that a Structure may have changed since it was last sent.
+ */
+void
+StructurePool_MarkDirty(const Structure *s)
+{
+	assert(s->o.index < STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT);
+	s_structureGeneration[s->o.index]++;
+}
+
+/**
+ * @brief   Get the generation of a Structure, which changes whenever
+ *          StructurePool_MarkDirty is called on it.
+ */
+uint32
+StructurePool_GetGeneration(uint16 index)
+{
+	return s_structureGeneration[index];
+}
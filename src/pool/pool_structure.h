@@ -39,6 +39,12 @@ extern void Structure_Free(struct Structure *s);
 
 extern struct StructurePool *StructurePool_Save(void);
 extern void StructurePool_Load(struct StructurePool *pool);
+extern struct StructurePool *StructurePool_Alloc(void);
+extern void StructurePool_Free(struct StructurePool *pool);
+extern void StructurePool_SaveTo(struct StructurePool *pool);
+extern void StructurePool_LoadFrom(const struct StructurePool *pool);
 extern uint16 StructurePool_GetIndex(int index);
+extern void StructurePool_MarkDirty(const struct Structure *s);
+extern uint32 StructurePool_GetGeneration(uint16 index);
 
 #endif
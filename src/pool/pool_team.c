@@ -5,6 +5,7 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "pool_team.h"
@@ -210,9 +211,7 @@ TeamPool_Save(void)
 	TeamPool *pool = &s_teamPoolBackup;
 	assert(!pool->allocated);
 
-	memcpy(pool->pool, s_teamArray, sizeof(s_teamArray));
-	memcpy(pool->find, s_teamFindArray, sizeof(s_teamFindArray));
-	pool->count = s_teamFindCount;
+	TeamPool_SaveTo(pool);
 
 	pool->allocated = true;
 	return pool;
@@ -228,9 +227,53 @@ TeamPool_Load(TeamPool *pool)
 {
 	assert(pool->allocated);
 
+	pool->allocated = false;
+	TeamPool_LoadFrom(pool);
+}
+
+/**
+ * @brief   Allocates a TeamPool to hold a snapshot.
+ * @details Introduced for world snapshots.
+ */
+TeamPool *
+TeamPool_Alloc(void)
+{
+	TeamPool *pool = calloc(1, sizeof(*pool));
+	assert(pool != NULL);
+
+	return pool;
+}
+
+/**
+ * @brief   Frees a TeamPool allocated by TeamPool_Alloc.
+ * @details Introduced for world snapshots.
+ */
+void
+TeamPool_Free(TeamPool *pool)
+{
+	free(pool);
+}
+
+/**
+ * @brief   Copies the TeamPool into a snapshot.
+ * @details Introduced for world snapshots.
+ */
+void
+TeamPool_SaveTo(TeamPool *pool)
+{
+	memcpy(pool->pool, s_teamArray, sizeof(s_teamArray));
+	memcpy(pool->find, s_teamFindArray, sizeof(s_teamFindArray));
+	pool->count = s_teamFindCount;
+}
+
+/**
+ * @brief   Restores the TeamPool from a snapshot, which is left intact.
+ * @details Introduced for world snapshots.
+ */
+void
+TeamPool_LoadFrom(const TeamPool *pool)
+{
 	memcpy(s_teamArray, pool->pool, sizeof(s_teamArray));
 	memcpy(s_teamFindArray, pool->find, sizeof(s_teamFindArray));
 	s_teamFindCount = pool->count;
-
-	pool->allocated = false;
 }
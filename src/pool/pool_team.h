@@ -25,5 +25,9 @@ extern void Team_Free(struct Team *au);
 
 extern struct TeamPool *TeamPool_Save(void);
 extern void TeamPool_Load(struct TeamPool *pool);
+extern struct TeamPool *TeamPool_Alloc(void);
+extern void TeamPool_Free(struct TeamPool *pool);
+extern void TeamPool_SaveTo(struct TeamPool *pool);
+extern void TeamPool_LoadFrom(const struct TeamPool *pool);
 
 #endif
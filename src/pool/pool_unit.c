@@ -5,13 +5,16 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
+#include "../os/math.h"
 
 #include "pool_unit.h"
 
 #include "pool.h"
 #include "pool_house.h"
 #include "../house.h"
+#include "../map.h"
 #include "../opendune.h"
 #include "../unit.h"
 #include "../scenario.h"
@@ -36,6 +39,96 @@ static UnitPool s_unitPoolBackup;
 assert_compile(sizeof(s_unitPoolBackup.pool) == sizeof(s_unitArray));
 assert_compile(sizeof(s_unitPoolBackup.find) == sizeof(g_unitFindArray));
 
+/* Uniform grid of UNIT_GRID_CELL_SIZE x UNIT_GRID_CELL_SIZE tile cells
+ * over the map, indexing every used unit by its current position.
+ * Units outside the map (e.g. 0xFFFF, 0xFFFF) are kept in a separate
+ * bucket which every radius query includes.
+ */
+enum {
+	UNIT_GRID_CELL_SHIFT = 2,
+	UNIT_GRID_CELL_SIZE = 1 << UNIT_GRID_CELL_SHIFT,
+	UNIT_GRID_WIDTH = MAP_SIZE_MAX / UNIT_GRID_CELL_SIZE,
+	UNIT_GRID_OUTSIDE = UNIT_GRID_WIDTH * UNIT_GRID_WIDTH,
+	UNIT_GRID_NONE = 0xFFFF
+};
+
+static uint16 s_unitGridHead[UNIT_GRID_OUTSIDE + 1];
+static uint16 s_unitGridNext[UNIT_INDEX_MAX_RAISED];
+static uint16 s_unitGridPrev[UNIT_INDEX_MAX_RAISED];
+static uint16 s_unitGridCell[UNIT_INDEX_MAX_RAISED];
+
+/* Position of each unit in g_unitFindArray, rebuilt lazily whenever
+ * the find array has been reordered.
+ */
+static uint16 s_unitFindOrder[UNIT_INDEX_MAX_RAISED];
+static bool s_unitFindOrderDirty = true;
+
+/* Generation of each unit, bumped whenever state sent to clients may
+ * have changed.  Readers remember the generation they last saw.
+ */
+static uint32 s_unitGeneration[UNIT_INDEX_MAX_RAISED];
+
+static uint16
+UnitPool_GetGridCell(tile32 position)
+{
+	const int x = position.x >> 8;
+	const int y = position.y >> 8;
+
+	if (x >= MAP_SIZE_MAX || y >= MAP_SIZE_MAX)
+		return UNIT_GRID_OUTSIDE;
+
+	return UNIT_GRID_WIDTH * (y >> UNIT_GRID_CELL_SHIFT) + (x >> UNIT_GRID_CELL_SHIFT);
+}
+
+static void
+UnitPool_GridUnlink(uint16 index)
+{
+	const uint16 cell = s_unitGridCell[index];
+	const uint16 prev = s_unitGridPrev[index];
+	const uint16 next = s_unitGridNext[index];
+
+	if (cell == UNIT_GRID_NONE)
+		return;
+
+	if (prev == UNIT_GRID_NONE) {
+		s_unitGridHead[cell] = next;
+	} else {
+		s_unitGridNext[prev] = next;
+	}
+
+	if (next != UNIT_GRID_NONE)
+		s_unitGridPrev[next] = prev;
+
+	s_unitGridCell[index] = UNIT_GRID_NONE;
+}
+
+static void
+UnitPool_GridClear(void)
+{
+	memset(s_unitGridHead, 0xFF, sizeof(s_unitGridHead));
+	memset(s_unitGridCell, 0xFF, sizeof(s_unitGridCell));
+	s_unitFindOrderDirty = true;
+}
+
+static void
+UnitPool_MarkAllDirty(void)
+{
+	for (unsigned int i = 0; i < UNIT_INDEX_MAX_RAISED; i++) {
+		s_unitGeneration[i]++;
+	}
+}
+
+static void
+UnitPool_GridRebuild(void)
+{
+	UnitPool_GridClear();
+
+	for (unsigned int i = 0; i < g_unitFindCount; i++) {
+		if (g_unitFindArray[i] != NULL)
+			UnitPool_GridUpdate(g_unitFindArray[i]);
+	}
+}
+
 /**
  * @brief   Get the Unit from the pool with the indicated index.
  * @details f__0FE4_05FD_002C_15BA.
@@ -116,6 +209,10 @@ Unit_Init(void)
 	for (unsigned int i = 0; i < UnitPool_GetMaxIndex(); i++) {
 		s_unitArray[i].o.index = i;
 	}
+
+	UnitPool_GridClear();
+	UnitPool_MarkAllDirty();
+	Unit_ResetVision();
 }
 
 /**
@@ -146,6 +243,9 @@ Unit_Recount(void)
 			g_unitFindCount++;
 		}
 	}
+
+	UnitPool_GridRebuild();
+	UnitPool_MarkAllDirty();
 }
 
 /**
@@ -215,6 +315,10 @@ Unit_Allocate(uint16 index, enum UnitType type, enum HouseType houseID)
 	g_unitFindArray[g_unitFindCount] = u;
 	g_unitFindCount++;
 
+	s_unitFindOrder[index] = g_unitFindCount - 1;
+	UnitPool_GridUpdate(u);
+	UnitPool_MarkDirty(u);
+
 	return u;
 }
 
@@ -230,6 +334,8 @@ Unit_Free(Unit *u)
 	memset(&u->o.flags, 0, sizeof(u->o.flags));
 
 	Script_Reset(&u->o.script, g_scriptUnit);
+	UnitPool_GridUpdate(u);
+	UnitPool_MarkDirty(u);
 
 	/* Find the Unit to remove. */
 	for (i = 0; i < g_unitFindCount; i++) {
@@ -249,11 +355,158 @@ Unit_Free(Unit *u)
 	if (i < g_unitFindCount) {
 		memmove(&g_unitFindArray[i], &g_unitFindArray[i + 1],
 				(g_unitFindCount - i) * sizeof(g_unitFindArray[0]));
+		s_unitFindOrderDirty = true;
 	}
 }
 
 /*--------------------------------------------------------------*/
 
+/**
+ * @brief   Move the Unit to the grid cell of its current position.
+ * @details Must be called whenever a used Unit's position changes.
+ *          Units which are no longer used are removed from the grid.
+ */
+void
+UnitPool_GridUpdate(const Unit *u)
+{
+	const uint16 index = u->o.index;
+	assert(index < UNIT_INDEX_MAX_RAISED);
+
+	s_unitGeneration[index]++;
+
+	if (!u->o.flags.s.used) {
+		UnitPool_GridUnlink(index);
+		return;
+	}
+
+	const uint16 cell = UnitPool_GetGridCell(u->o.position);
+	if (cell == s_unitGridCell[index])
+		return;
+
+	UnitPool_GridUnlink(index);
+
+	s_unitGridCell[index] = cell;
+	s_unitGridPrev[index] = UNIT_GRID_NONE;
+	s_unitGridNext[index] = s_unitGridHead[cell];
+
+	if (s_unitGridHead[cell] != UNIT_GRID_NONE)
+		s_unitGridPrev[s_unitGridHead[cell]] = index;
+
+	s_unitGridHead[cell] = index;
+}
+
+/**
+ * @brief   Note that a Unit may have changed since it was last sent.
+ * @details Position changes are noted by UnitPool_GridUpdate.
+ */
+void
+UnitPool_MarkDirty(const Unit *u)
+{
+	assert(u->o.index < UNIT_INDEX_MAX_RAISED);
+	s_unitGeneration[u->o.index]++;
+}
+
+/**
+ * @brief   Get the generation of a Unit, which changes whenever
+ *          UnitPool_MarkDirty is called on it.
+ */
+uint32
+UnitPool_GetGeneration(uint16 index)
+{
+	return s_unitGeneration[index];
+}
+
+/**
+ * @brief   Note that g_unitFindArray has been reordered.
+ */
+void
+UnitPool_FindOrderChanged(void)
+{
+	s_unitFindOrderDirty = true;
+}
+
+static int
+UnitPool_FindOrder_Sorter(const void *a, const void *b)
+{
+	const Unit *u1 = *(Unit * const *)a;
+	const Unit *u2 = *(Unit * const *)b;
+
+	return s_unitFindOrder[u1->o.index] - s_unitFindOrder[u2->o.index];
+}
+
+/**
+ * @brief   Find all Units that may lie within radius of position.
+ * @details Fills units with every Unit that Unit_FindNext would return
+ *          and whose position is within radius of position along both
+ *          axes, in g_unitFindArray order, so callers iterating over
+ *          the result visit (and break ties between) Units in the same
+ *          order as a full Unit_FindFirst/Unit_FindNext scan.  Callers
+ *          must still apply their own exact distance test.
+ * @return  The number of Units found.
+ */
+uint16
+Unit_FindInRadius(tile32 position, uint16 radius, Unit **units)
+{
+	uint16 count = 0;
+
+	if (s_unitFindOrderDirty) {
+		for (unsigned int i = 0; i < g_unitFindCount; i++) {
+			if (g_unitFindArray[i] != NULL)
+				s_unitFindOrder[g_unitFindArray[i]->o.index] = i;
+		}
+
+		s_unitFindOrderDirty = false;
+	}
+
+	/* Distances to a position outside the map may wrap around, so
+	 * consider every unit.
+	 */
+	if (UnitPool_GetGridCell(position) == UNIT_GRID_OUTSIDE) {
+		PoolFindStruct find;
+
+		for (Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
+				u != NULL;
+				u = Unit_FindNext(&find)) {
+			units[count++] = u;
+		}
+
+		return count;
+	}
+
+	const int max_xy = (MAP_SIZE_MAX << 8) - 1;
+	const int x0 = max(0, position.x - radius) >> (8 + UNIT_GRID_CELL_SHIFT);
+	const int y0 = max(0, position.y - radius) >> (8 + UNIT_GRID_CELL_SHIFT);
+	const int x1 = min(max_xy, position.x + radius) >> (8 + UNIT_GRID_CELL_SHIFT);
+	const int y1 = min(max_xy, position.y + radius) >> (8 + UNIT_GRID_CELL_SHIFT);
+
+	for (int cy = y0; cy <= y1 + 1; cy++) {
+		for (int cx = x0; cx <= x1; cx++) {
+			/* The extra row is the bucket outside of the map. */
+			const int cell
+				= (cy <= y1) ? (UNIT_GRID_WIDTH * cy + cx) : UNIT_GRID_OUTSIDE;
+
+			for (uint16 index = s_unitGridHead[cell];
+					index != UNIT_GRID_NONE;
+					index = s_unitGridNext[index]) {
+				Unit *u = Unit_Get_ByIndex(index);
+
+				if (u->o.flags.s.isNotOnMap && g_validateStrictIfZero == 0)
+					continue;
+
+				units[count++] = u;
+			}
+
+			if (cell == UNIT_GRID_OUTSIDE)
+				break;
+		}
+	}
+
+	qsort(units, count, sizeof(units[0]), UnitPool_FindOrder_Sorter);
+	return count;
+}
+
+/*--------------------------------------------------------------*/
+
 /**
  * @brief   Saves the UnitPool.
  * @details Introduced for server to generate maps without clobbering
@@ -265,9 +518,7 @@ UnitPool_Save(void)
 	UnitPool *pool = &s_unitPoolBackup;
 	assert(!pool->allocated);
 
-	memcpy(pool->pool, s_unitArray, sizeof(s_unitArray));
-	memcpy(pool->find, g_unitFindArray, sizeof(g_unitFindArray));
-	pool->count = g_unitFindCount;
+	UnitPool_SaveTo(pool);
 
 	pool->allocated = true;
 	return pool;
@@ -283,11 +534,58 @@ UnitPool_Load(UnitPool *pool)
 {
 	assert(pool->allocated);
 
+	pool->allocated = false;
+	UnitPool_LoadFrom(pool);
+}
+
+/**
+ * @brief   Allocates a UnitPool to hold a snapshot.
+ * @details Introduced for world snapshots.
+ */
+UnitPool *
+UnitPool_Alloc(void)
+{
+	UnitPool *pool = calloc(1, sizeof(*pool));
+	assert(pool != NULL);
+
+	return pool;
+}
+
+/**
+ * @brief   Frees a UnitPool allocated by UnitPool_Alloc.
+ * @details Introduced for world snapshots.
+ */
+void
+UnitPool_Free(UnitPool *pool)
+{
+	free(pool);
+}
+
+/**
+ * @brief   Copies the UnitPool into a snapshot.
+ * @details Introduced for world snapshots.
+ */
+void
+UnitPool_SaveTo(UnitPool *pool)
+{
+	memcpy(pool->pool, s_unitArray, sizeof(s_unitArray));
+	memcpy(pool->find, g_unitFindArray, sizeof(g_unitFindArray));
+	pool->count = g_unitFindCount;
+}
+
+/**
+ * @brief   Restores the UnitPool from a snapshot, which is left intact.
+ * @details Introduced for world snapshots.
+ */
+void
+UnitPool_LoadFrom(const UnitPool *pool)
+{
 	memcpy(s_unitArray, pool->pool, sizeof(s_unitArray));
 	memcpy(g_unitFindArray, pool->find, sizeof(g_unitFindArray));
 	g_unitFindCount = pool->count;
 
-	pool->allocated = false;
+	UnitPool_GridRebuild();
+	UnitPool_MarkAllDirty();
 }
 
 /**
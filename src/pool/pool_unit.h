@@ -32,10 +32,19 @@ extern void Unit_Init(void);
 extern void Unit_Recount(void);
 extern struct Unit *Unit_Allocate(uint16 index, enum UnitType type, enum HouseType houseID);
 extern void Unit_Free(struct Unit *u);
+extern uint16 Unit_FindInRadius(tile32 position, uint16 radius, struct Unit **units);
 
 extern struct UnitPool *UnitPool_Save(void);
 extern void UnitPool_Load(struct UnitPool *pool);
+extern struct UnitPool *UnitPool_Alloc(void);
+extern void UnitPool_Free(struct UnitPool *pool);
+extern void UnitPool_SaveTo(struct UnitPool *pool);
+extern void UnitPool_LoadFrom(const struct UnitPool *pool);
 extern uint16 UnitPool_GetMaxIndex(void);
 extern uint16 UnitPool_GetIndexEnd(enum UnitType type);
+extern void UnitPool_GridUpdate(const struct Unit *u);
+extern void UnitPool_FindOrderChanged(void);
+extern void UnitPool_MarkDirty(const struct Unit *u);
+extern uint32 UnitPool_GetGeneration(uint16 index);
 
 #endif
@@ -0,0 +1,206 @@
+/* profile.c
+ *
+ * Per-phase tick profiler.  Each phase of the game loop records its wall
+ * time into a ring buffer of recent samples, from which the rolling mean
+ * and 99th percentile are computed for the on-screen overlay.  Samples
+ * can also be streamed to a CSV file, one line per sample.
+ */
+
+#include <allegro5/allegro.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "errorlog.h"
+
+#include "profile.h"
+
+#include "file.h"
+#include "timer/timer.h"
+
+enum {
+	PROFILE_HISTORY = 128
+};
+
+typedef struct ProfileHistory {
+	bool started;
+	double start;
+	double sample[PROFILE_HISTORY];
+	double sum;
+	int count;
+	int next;
+} ProfileHistory;
+
+static const char * const s_phase_name[PROFILE_MAX] = {
+	"unit", "structure", "house", "team", "squad", "pathfinder",
+	"explosion", "animation", "send", "draw"
+};
+
+static ProfileHistory s_history[PROFILE_MAX];
+static bool s_enabled;
+static FILE *s_csv;
+
+bool
+Profile_IsActive(void)
+{
+	return s_enabled || (s_csv != NULL);
+}
+
+void
+Profile_Enable(bool enable)
+{
+	if (enable && !s_enabled)
+		memset(s_history, 0, sizeof(s_history));
+
+	s_enabled = enable;
+}
+
+bool
+Profile_OpenCSV(const char *filename)
+{
+	Profile_CloseCSV();
+
+	s_csv = fopen(filename, "w");
+	if (s_csv == NULL)
+		return false;
+
+	fprintf(s_csv, "tick,phase,usec\n");
+	return true;
+}
+
+void
+Profile_CloseCSV(void)
+{
+	if (s_csv == NULL)
+		return;
+
+	fclose(s_csv);
+	s_csv = NULL;
+}
+
+/* Profile_ToggleCSV:
+ *
+ * Starts streaming samples to profile_<date>.csv in the personal data
+ * directory, or stops if already streaming.  Returns true if streaming.
+ */
+bool
+Profile_ToggleCSV(void)
+{
+	if (s_csv != NULL) {
+		Profile_CloseCSV();
+		return false;
+	}
+
+	struct tm *tm;
+	time_t timep;
+	char filename[PATH_MAX];
+	char filepath[PATH_MAX];
+
+	timep = time(NULL);
+	tm = localtime(&timep);
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+	strftime(filename, sizeof(filename), "profile_%Y%m%d_%H%M%S.csv", tm);
+	snprintf(filepath, sizeof(filepath), "%s/%s", g_personal_data_dir, filename);
+#pragma GCC diagnostic pop
+
+	if (!Profile_OpenCSV(filepath)) {
+		Error("Failed to open file '%s' for writing.\n", filepath);
+		return false;
+	}
+
+	Warning("Recording profile to '%s'.\n", filepath);
+	return true;
+}
+
+void
+Profile_Begin(enum ProfilePhase phase)
+{
+	assert(phase < PROFILE_MAX);
+
+	if (!Profile_IsActive())
+		return;
+
+	s_history[phase].started = true;
+	s_history[phase].start = al_get_time();
+}
+
+void
+Profile_End(enum ProfilePhase phase)
+{
+	assert(phase < PROFILE_MAX);
+
+	ProfileHistory *h = &s_history[phase];
+
+	/* Profiling may have been switched on after the phase began. */
+	if (!h->started)
+		return;
+
+	h->started = false;
+
+	if (!Profile_IsActive())
+		return;
+
+	const double elapsed = al_get_time() - h->start;
+
+	if (h->count < PROFILE_HISTORY) {
+		h->count++;
+	} else {
+		h->sum -= h->sample[h->next];
+	}
+
+	h->sample[h->next] = elapsed;
+	h->sum += elapsed;
+	h->next = (h->next + 1) % PROFILE_HISTORY;
+
+	if (s_csv != NULL) {
+		fprintf(s_csv, "%" PRId64 ",%s,%.0f\n",
+				g_timerGame, s_phase_name[phase], elapsed * 1e6);
+	}
+}
+
+const char *
+Profile_GetPhaseName(enum ProfilePhase phase)
+{
+	assert(phase < PROFILE_MAX);
+
+	return s_phase_name[phase];
+}
+
+static int
+Profile_CompareSample(const void *a, const void *b)
+{
+	const double x = *(const double *)a;
+	const double y = *(const double *)b;
+
+	return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+/* Profile_GetStats:
+ *
+ * Returns the mean and 99th percentile of the recent samples, in
+ * seconds, or zero if the phase has not run since profiling began.
+ */
+void
+Profile_GetStats(enum ProfilePhase phase, double *mean, double *p99)
+{
+	assert(phase < PROFILE_MAX);
+
+	const ProfileHistory *h = &s_history[phase];
+	double sorted[PROFILE_HISTORY];
+
+	if (h->count <= 0) {
+		*mean = 0.0;
+		*p99 = 0.0;
+		return;
+	}
+
+	memcpy(sorted, h->sample, h->count * sizeof(sorted[0]));
+	qsort(sorted, h->count, sizeof(sorted[0]), Profile_CompareSample);
+
+	*mean = h->sum / h->count;
+	*p99 = sorted[(h->count * 99 + 99) / 100 - 1];
+}
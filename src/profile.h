@@ -0,0 +1,31 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+
+enum ProfilePhase {
+	PROFILE_UNIT,
+	PROFILE_STRUCTURE,
+	PROFILE_HOUSE,
+	PROFILE_TEAM,
+	PROFILE_SQUAD,
+	PROFILE_PATHFINDER,
+	PROFILE_EXPLOSION,
+	PROFILE_ANIMATION,
+	PROFILE_SEND_MESSAGES,
+	PROFILE_DRAW,
+
+	PROFILE_MAX
+};
+
+extern bool Profile_IsActive(void);
+extern void Profile_Enable(bool enable);
+extern bool Profile_ToggleCSV(void);
+extern bool Profile_OpenCSV(const char *filename);
+extern void Profile_CloseCSV(void);
+extern void Profile_Begin(enum ProfilePhase phase);
+extern void Profile_End(enum ProfilePhase phase);
+extern const char *Profile_GetPhaseName(enum ProfilePhase phase);
+extern void Profile_GetStats(enum ProfilePhase phase, double *mean, double *p99);
+
+#endif
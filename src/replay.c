@@ -0,0 +1,593 @@
+/* replay.c
+ *
+ * Replay recording and playback.  A replay holds the settings needed
+ * to recreate the start of a single player game, followed by the
+ * commands that reached Server_ProcessMessage and the ticks at which
+ * they were executed.  dunedynasty-sim plays them back headless, as
+ * fast as possible.
+ *
+ * After the header, the stream starts with the random number
+ * generator states before the first tick, then a list of records:
+ *
+ *  'F' run skip len commands
+ *      run ticks without commands, then a tick (skip) ticks after the
+ *      previous one, with len bytes of house and message pairs.
+ *  'S' run speed
+ *      run ticks without commands, then a change of game speed, which
+ *      takes effect from the next tick.  Since version 2.
+ *  'E' run
+ *      run ticks without commands, then the end of the game.
+ *
+ * run, skip, len and speed are varints.  The game logic can skip ticks when
+ * it falls behind, hence the skip.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "errorlog.h"
+#include "os/common.h"
+
+#include "replay.h"
+
+#include "config.h"
+#include "enhancement.h"
+#include "file.h"
+#include "house.h"
+#include "mods/skirmish.h"
+#include "net/message.h"
+#include "net/net.h"
+#include "net/server.h"
+#include "opendune.h"
+#include "scenario.h"
+#include "timer/timer.h"
+#include "tools/random_general.h"
+#include "tools/random_lcg.h"
+
+enum {
+	REPLAY_HEADER_LEN = 4 + 2 + 5 + 7 + 11 + 2 * HOUSE_NEUTRAL
+};
+
+typedef struct ReplayRecord {
+	uint8 type;
+	uint32 run;
+	uint32 skip;
+	uint32 len;
+	uint32 speed;
+	const unsigned char *buf;
+} ReplayRecord;
+
+static const unsigned char s_magic[4] = { 'D', 'D', 'R', 'P' };
+
+/* Gameplay enhancements stored in the header, one bit each.  Only
+ * append to this list, or old replays will load the wrong settings.
+ */
+static bool * const s_enhancement[] = {
+	&enhancement_ai_respects_structure_placement,
+	&enhancement_astar_pathfinder,
+	&enhancement_brutal_ai,
+	&enhancement_construction_does_not_pause,
+	&enhancement_fog_covers_units,
+	&enhancement_fog_of_war,
+	&enhancement_i_mean_where_i_clicked,
+	&enhancement_insatiable_sandworms,
+	&enhancement_invisible_saboteurs,
+	&enhancement_nonordos_deviation,
+	&enhancement_permanent_follow_mode,
+	&enhancement_raise_unit_cap,
+	&enhancement_raise_structure_cap,
+	&enhancement_repeat_reinforcements,
+	&enhancement_soldier_engineers,
+	&enhancement_structures_on_concrete_do_not_degrade,
+	&enhancement_targetted_sabotage,
+	&enhancement_true_game_speed_adjustment,
+	&enhancement_true_unit_movement_speed,
+	&enhancement_attack_dir_consistency,
+	&enhancement_extend_sight_range,
+	&enhancement_instant_walls,
+	&enhancement_fix_scenario_typos,
+	&enhancement_read_scenario_structure_health,
+	&enhancement_undelay_ordos_siege_tank_tech,
+	&enhancement_infantry_mini_rockets,
+};
+
+bool g_replay_record = false;
+
+/* Recording. */
+static FILE *s_fp;
+static bool s_started;
+static uint32 s_last;
+static uint32 s_run;
+static int s_gameSpeed;
+static unsigned char s_frame[REPLAY_MAX_FRAME_LEN];
+static int s_frame_len;
+
+/* Playback. */
+static unsigned char *s_data;
+static const unsigned char *s_pos;
+static const unsigned char *s_end;
+static const unsigned char *s_stream;
+static uint32 s_randomState;
+static uint32 s_lcgState;
+static ReplayRecord s_record;
+static uint32 s_tick;
+
+/*--------------------------------------------------------------*/
+
+/**
+ * Pack the gameplay enhancements which affect the simulation, one bit
+ *  each.  Also used to give lockstep peers the host's settings.
+ */
+uint32
+Replay_EncodeEnhancements(void)
+{
+	uint32 enhancements = 0;
+
+	for (unsigned int i = 0; i < lengthof(s_enhancement); i++) {
+		if (*s_enhancement[i])
+			enhancements |= (1u << i);
+	}
+
+	return enhancements;
+}
+
+void
+Replay_DecodeEnhancements(uint32 enhancements)
+{
+	for (unsigned int i = 0; i < lengthof(s_enhancement); i++) {
+		*s_enhancement[i] = (enhancements & (1u << i)) != 0;
+	}
+}
+
+/*--------------------------------------------------------------*/
+
+static bool
+Replay_Write(const unsigned char *buf, size_t len)
+{
+	if (fwrite(buf, 1, len, s_fp) == len)
+		return true;
+
+	Error("Error while writing replay.\n");
+	fclose(s_fp);
+	s_fp = NULL;
+	return false;
+}
+
+static void
+Replay_WriteHeader(void)
+{
+	unsigned char src[REPLAY_HEADER_LEN];
+	unsigned char *buf = src;
+
+	memcpy(buf, s_magic, sizeof(s_magic));
+	buf += sizeof(s_magic);
+	Net_Encode_uint16(&buf, REPLAY_VERSION);
+
+	Net_Encode_uint8 (&buf, g_campaign_selected);
+	Net_Encode_uint8 (&buf, g_campaignID);
+	Net_Encode_uint8 (&buf, g_scenarioID);
+	Net_Encode_uint8 (&buf, g_playerHouseID);
+	Net_Encode_uint8 (&buf, g_gameConfig.gameSpeed);
+
+	Net_Encode_uint32(&buf, Replay_EncodeEnhancements());
+	Net_Encode_uint16(&buf, enhancement_astar_pathfinder_budget);
+	Net_Encode_uint8 (&buf, enhancement_repair_cost_formula);
+
+	Net_Encode_uint32(&buf, g_skirmish.seed);
+	Net_Encode_uint16(&buf, g_skirmish.credits);
+	Net_Encode_uint8 (&buf, g_skirmish.starting_army);
+	Net_Encode_uint8 (&buf, g_skirmish.lose_condition);
+	Net_Encode_uint8 (&buf, g_skirmish.worm_count);
+	Net_Encode_uint8 (&buf, g_skirmish.landscape_params.min_spice_fields);
+	Net_Encode_uint8 (&buf, g_skirmish.landscape_params.max_spice_fields);
+
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		Net_Encode_uint8(&buf, g_skirmish.player_config[h].brain);
+		Net_Encode_uint8(&buf, g_skirmish.player_config[h].team);
+	}
+
+	assert(buf - src == sizeof(src));
+	Replay_Write(src, sizeof(src));
+}
+
+/**
+ * Starts recording a new game to replay_<date>.ddr in the personal data
+ *  directory, if enabled.  Multiplayer games are not recorded, as the
+ *  headless simulation cannot recreate their maps.
+ */
+void
+Replay_Record_Start(void)
+{
+	Replay_Record_Stop();
+
+	if (!g_replay_record
+			|| g_host_type != HOSTTYPE_NONE
+			|| g_campaign_selected == CAMPAIGNID_MULTIPLAYER)
+		return;
+
+	struct tm *tm;
+	time_t timep;
+	char filename[PATH_MAX];
+	char filepath[PATH_MAX];
+
+	timep = time(NULL);
+	tm = localtime(&timep);
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+	strftime(filename, sizeof(filename), "replay_%Y%m%d_%H%M%S.ddr", tm);
+	snprintf(filepath, sizeof(filepath), "%s/%s", g_personal_data_dir, filename);
+#pragma GCC diagnostic pop
+
+	s_fp = fopen(filepath, "wb");
+	if (s_fp == NULL) {
+		Error("Failed to open file '%s' for writing.\n", filepath);
+		return;
+	}
+
+	s_started = false;
+	s_last = 0;
+	s_run = 0;
+	s_frame_len = 0;
+	s_gameSpeed = g_gameConfig.gameSpeed;
+
+	Replay_WriteHeader();
+	Warning("Recording replay to '%s'.\n", filepath);
+}
+
+void
+Replay_Record_Stop(void)
+{
+	if (s_fp == NULL)
+		return;
+
+	unsigned char src[1 + 5];
+	unsigned char *buf = src;
+
+	Net_Encode_uint8(&buf, 'E');
+	Net_Encode_varint(&buf, s_run);
+
+	if (Replay_Write(src, buf - src)) {
+		fclose(s_fp);
+		s_fp = NULL;
+	}
+}
+
+/**
+ * Writes the random number generator states before the first command
+ *  or tick, where playback restores them.
+ */
+static bool
+Replay_WriteRandomState(void)
+{
+	if (s_started)
+		return true;
+
+	unsigned char src[8];
+	unsigned char *buf = src;
+
+	Net_Encode_uint32(&buf, Tools_Random_GetState());
+	Net_Encode_uint32(&buf, Tools_RandomLCG_GetState());
+
+	s_started = true;
+	return Replay_Write(src, sizeof(src));
+}
+
+/**
+ * Records a command, to be written with the next tick of the game logic.
+ */
+void
+Replay_Record_Message(enum HouseType houseID, const unsigned char *buf, int len)
+{
+	if (s_fp == NULL || !Replay_WriteRandomState())
+		return;
+
+	if (s_frame_len + 1 + len > REPLAY_MAX_FRAME_LEN) {
+		Warning("Replay dropped a command at tick %u.\n", s_last + 1);
+		return;
+	}
+
+	s_frame[s_frame_len] = houseID;
+	memcpy(s_frame + s_frame_len + 1, buf, len);
+	s_frame_len += 1 + len;
+}
+
+/**
+ * Records a tick of the game logic, with the commands executed before
+ *  it.  Called before each tick.
+ */
+void
+Replay_Record_Step(void)
+{
+	if (s_fp == NULL)
+		return;
+
+	if (!Replay_WriteRandomState())
+		return;
+
+	/* The game speed can be changed from the options menu, and without
+	 * true game speed adjustment it changes the game logic.
+	 */
+	if (g_gameConfig.gameSpeed != s_gameSpeed) {
+		unsigned char src[1 + 5 + 5];
+		unsigned char *buf = src;
+
+		Net_Encode_uint8(&buf, 'S');
+		Net_Encode_varint(&buf, s_run);
+		Net_Encode_varint(&buf, g_gameConfig.gameSpeed);
+
+		if (!Replay_Write(src, buf - src))
+			return;
+
+		s_run = 0;
+		s_gameSpeed = g_gameConfig.gameSpeed;
+	}
+
+	uint32 tick = g_timerGame - g_tickScenarioStart;
+	if (tick <= s_last)
+		tick = s_last + 1;
+
+	if (s_frame_len == 0 && tick == s_last + 1) {
+		s_run++;
+		s_last = tick;
+		return;
+	}
+
+	unsigned char src[1 + 5 + 5 + 5];
+	unsigned char *buf = src;
+
+	Net_Encode_uint8(&buf, 'F');
+	Net_Encode_varint(&buf, s_run);
+	Net_Encode_varint(&buf, tick - s_last - 1);
+	Net_Encode_varint(&buf, s_frame_len);
+
+	if (Replay_Write(src, buf - src))
+		Replay_Write(s_frame, s_frame_len);
+
+	s_run = 0;
+	s_last = tick;
+	s_frame_len = 0;
+}
+
+/*--------------------------------------------------------------*/
+
+static bool
+Replay_DecodeVarint(const unsigned char **pos, uint32 *val)
+{
+	*val = 0;
+
+	for (int shift = 0; shift < 35 && *pos < s_end; shift += 7) {
+		const uint8 c = *(*pos)++;
+
+		*val |= (uint32)(c & 0x7F) << shift;
+		if ((c & 0x80) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Reads the record at pos.  A truncated replay, for example from a
+ *  crash, ends at its last whole record.
+ */
+static bool
+Replay_ReadRecord(const unsigned char **pos, ReplayRecord *r)
+{
+	memset(r, 0, sizeof(*r));
+
+	if (*pos >= s_end)
+		return false;
+
+	r->type = *(*pos)++;
+
+	if (r->type == 'E')
+		return Replay_DecodeVarint(pos, &r->run);
+
+	if (r->type == 'S') {
+		if (Replay_DecodeVarint(pos, &r->run) && Replay_DecodeVarint(pos, &r->speed) && r->speed < 5)
+			return true;
+
+		r->type = 0;
+		return false;
+	}
+
+	if (r->type != 'F'
+			|| !Replay_DecodeVarint(pos, &r->run)
+			|| !Replay_DecodeVarint(pos, &r->skip)
+			|| !Replay_DecodeVarint(pos, &r->len)
+			|| r->len > (uint32)(s_end - *pos)) {
+		r->type = 0;
+		return false;
+	}
+
+	r->buf = *pos;
+	(*pos) += r->len;
+	return true;
+}
+
+static void
+Replay_ReadHeader(const unsigned char *buf)
+{
+	const uint8 campaign_selected = Net_Decode_uint8(&buf);
+
+	Skirmish_Initialise();
+
+	g_campaign_selected     = campaign_selected;
+	g_campaignID            = Net_Decode_uint8(&buf);
+	g_scenarioID            = Net_Decode_uint8(&buf);
+	g_playerHouseID         = Net_Decode_uint8(&buf);
+	g_gameConfig.gameSpeed  = Net_Decode_uint8(&buf);
+
+	Replay_DecodeEnhancements(Net_Decode_uint32(&buf));
+	enhancement_astar_pathfinder_budget = Net_Decode_uint16(&buf);
+	enhancement_repair_cost_formula     = Net_Decode_uint8(&buf);
+
+	g_skirmish.seed                         = Net_Decode_uint32(&buf);
+	g_skirmish.credits                      = Net_Decode_uint16(&buf);
+	g_skirmish.starting_army                = Net_Decode_uint8(&buf);
+	g_skirmish.lose_condition               = Net_Decode_uint8(&buf);
+	g_skirmish.worm_count                   = Net_Decode_uint8(&buf);
+	g_skirmish.landscape_params.min_spice_fields = Net_Decode_uint8(&buf);
+	g_skirmish.landscape_params.max_spice_fields = Net_Decode_uint8(&buf);
+
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		g_skirmish.player_config[h].brain = Net_Decode_uint8(&buf);
+		g_skirmish.player_config[h].team  = Net_Decode_uint8(&buf);
+	}
+}
+
+/**
+ * Loads a replay, and sets up the settings of the game it recorded.
+ *  The caller then starts the scenario or skirmish.
+ */
+bool
+Replay_Playback_Load(const char *filename)
+{
+	Replay_Playback_Free();
+
+	FILE *fp = fopen(filename, "rb");
+	if (fp == NULL)
+		return false;
+
+	long size = -1;
+	if (fseek(fp, 0, SEEK_END) == 0) {
+		size = ftell(fp);
+		rewind(fp);
+	}
+
+	if (size >= REPLAY_HEADER_LEN) {
+		s_data = malloc(size);
+
+		if (s_data != NULL && fread(s_data, 1, size, fp) != (size_t)size) {
+			free(s_data);
+			s_data = NULL;
+		}
+	}
+
+	fclose(fp);
+
+	if (s_data == NULL)
+		return false;
+
+	const unsigned char *buf = s_data + sizeof(s_magic);
+	const uint16 version
+		= (memcmp(s_data, s_magic, sizeof(s_magic)) == 0)
+		? Net_Decode_uint16(&buf) : 0;
+
+	if (version == 0 || version > REPLAY_VERSION) {
+		Replay_Playback_Free();
+		return false;
+	}
+
+	Replay_ReadHeader(buf);
+
+	s_end = s_data + size;
+	s_stream = s_data + REPLAY_HEADER_LEN;
+	s_pos = s_stream;
+	return true;
+}
+
+/**
+ * Returns the number of ticks in the replay.
+ */
+long
+Replay_Playback_GetLength(void)
+{
+	const unsigned char *pos = s_stream + 8;
+	ReplayRecord r;
+	long ticks = 0;
+
+	if (s_data == NULL || s_end - s_stream < 8)
+		return 0;
+
+	while (Replay_ReadRecord(&pos, &r)) {
+		ticks += r.run + (r.type == 'F' ? 1 : 0);
+
+		if (r.type == 'E')
+			break;
+	}
+
+	return ticks;
+}
+
+/**
+ * Restores the random number generators to their state before the
+ *  first tick.  Called once the scenario or skirmish has been started.
+ */
+void
+Replay_Playback_Start(void)
+{
+	memset(&s_record, 0, sizeof(s_record));
+	s_tick = 0;
+
+	if (s_data == NULL || s_end - s_stream < 8)
+		return;
+
+	s_pos = s_stream;
+	s_randomState = Net_Decode_uint32(&s_pos);
+	s_lcgState = Net_Decode_uint32(&s_pos);
+
+	Tools_Random_Seed(s_randomState);
+	Tools_RandomLCG_SetState(s_lcgState);
+
+	Replay_ReadRecord(&s_pos, &s_record);
+}
+
+/**
+ * Executes the commands for the next tick and advances g_timerGame to
+ *  it.  Returns false at the end of the replay; otherwise the caller
+ *  should run the game logic for the tick.
+ */
+bool
+Replay_Playback_Step(void)
+{
+	uint32 tick;
+
+	/* Speed changes take effect before the tick that follows them. */
+	while (s_record.type == 'S' && s_record.run == 0) {
+		g_gameConfig.gameSpeed = s_record.speed;
+		Replay_ReadRecord(&s_pos, &s_record);
+	}
+
+	if (s_record.run > 0) {
+		s_record.run--;
+		tick = s_tick + 1;
+	} else if (s_record.type == 'F') {
+		const unsigned char *buf = s_record.buf;
+		const unsigned char *end = s_record.buf + s_record.len;
+
+		tick = s_tick + 1 + s_record.skip;
+
+		while (end - buf >= 2) {
+			const enum HouseType houseID = buf[0];
+			const enum ClientServerMsg msg = Net_Decode_ClientServerMsg(buf[1]);
+			const int len = 1 + Net_GetLength_ClientServerMsg(msg);
+
+			if (houseID >= HOUSE_NEUTRAL || msg >= CSMSG_MAX || end - buf < 1 + len)
+				break;
+
+			Server_ProcessMessage(0, houseID, buf + 1, len);
+			buf += 1 + len;
+		}
+
+		Replay_ReadRecord(&s_pos, &s_record);
+	} else {
+		return false;
+	}
+
+	s_tick = tick;
+	g_timerGame = g_tickScenarioStart + tick;
+	return true;
+}
+
+void
+Replay_Playback_Free(void)
+{
+	free(s_data);
+	s_data = NULL;
+	s_pos = s_end = s_stream = NULL;
+	memset(&s_record, 0, sizeof(s_record));
+}
@@ -0,0 +1,29 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include "enumeration.h"
+#include "types.h"
+
+enum {
+	REPLAY_VERSION = 2,
+	REPLAY_MAX_FRAME_LEN = 4096     /* Bytes of commands recorded per tick. */
+};
+
+extern bool g_replay_record;
+
+extern uint32 Replay_EncodeEnhancements(void);
+extern void Replay_DecodeEnhancements(uint32 enhancements);
+
+extern void Replay_Record_Start(void);
+extern void Replay_Record_Stop(void);
+extern void Replay_Record_Message(enum HouseType houseID, const unsigned char *buf, int len);
+extern void Replay_Record_Step(void);
+
+extern bool Replay_Playback_Load(const char *filename);
+extern long Replay_Playback_GetLength(void);
+extern void Replay_Playback_Start(void);
+extern bool Replay_Playback_Step(void);
+extern void Replay_Playback_Free(void);
+
+#endif
@@ -8,6 +8,7 @@
 #include "save.h"
 
 #include "ai.h"
+#include "codec/lzblock.h"
 #include "file.h"
 #include "house.h"
 #include "map.h"
@@ -27,123 +28,250 @@
 #include "team.h"
 #include "unit.h"
 
+typedef struct SaveChunkIndex {
+	uint8 header[4];                                        /*!< The chunk identification string. */
+	uint32 rawLength;                                       /*!< The length of the chunk contents. */
+	uint32 storedLength;                                    /*!< The length after compression. */
+} SaveChunkIndex;
+
+bool g_savegame_compress = false;                           /*!< Whether to save in the compressed container. */
+
 /**
  * Save a chunk of data.
- * @param fp The file to save to.
+ * @param sb The savegame buffer to save to.
  * @param header The chunk identification string (4 chars, always).
  * @param saveProc The proc to call to generate the content of the chunk.
  * @return True if and only if all bytes were written successful.
  */
-static bool Save_Chunk(FILE *fp, const char *header, bool (*saveProc)(FILE *fp))
+static bool Save_Chunk(SaveBuffer *sb, const char *header, bool (*saveProc)(SaveBuffer *sb))
 {
 	uint32 position;
 	uint32 length;
-	uint32 lengthSwapped;
 
-	if (fwrite(header, 4, 1, fp) != 1) return false;
+	if (!SaveBuffer_Write(sb, header, 4)) return false;
 
 	/* Reserve the length field */
 	length = 0;
-	if (fwrite(&length, 4, 1, fp) != 1) return false;
+	if (!SaveBuffer_Write(sb, &length, 4)) return false;
 
 	/* Store the content of the chunk, and remember the length */
-	position = ftell(fp);
-	if (!saveProc(fp)) return false;
-	length = ftell(fp) - position;
+	position = sb->length;
+	if (!saveProc(sb)) return false;
+	length = sb->length - position;
 
 	/* Ensure we are word aligned */
 	if ((length & 1) == 1) {
 		uint8 empty = 0;
-		if (fwrite(&empty, 1, 1, fp) != 1) return false;
+		if (!SaveBuffer_Write(sb, &empty, 1)) return false;
 	}
 
-	/* Write back the chunk size */
-	fseek(fp, position - 4, SEEK_SET);
-	lengthSwapped = HTOBE32(length);
-	if (fwrite(&lengthSwapped, 4, 1, fp) != 1) return false;
-	fseek(fp, 0, SEEK_END);
+	/* Fill in the chunk size */
+	SaveBuffer_Patch_be_uint32(sb, position - 4, length);
 
 	return true;
 }
 
 /**
  * Save the game for real. It creates all the required chunks and stores them
- *  to the file. It updates the field lengths where needed.
+ *  in the buffer. It updates the field lengths where needed.
  *
- * @param fp The file to save to.
+ * @param sb The savegame buffer to save to.
  * @param description The description of the savegame.
  * @return True if and only if all bytes were written successful.
  */
 static bool
-Save_Main(FILE *fp, const char *description)
+Save_Main(SaveBuffer *sb, const char *description)
 {
 	uint32 length;
 	uint32 lengthSwapped;
 
 	/* Write the 'FORM' chunk (in which all other chunks are) */
-	if (fwrite("FORM", 4, 1, fp) != 1) return false;
-	/* Write zero length for now. We come back to this value before closing */
+	if (!SaveBuffer_Write(sb, "FORM", 4)) return false;
+	/* Write zero length for now. We come back to this value at the end */
 	length = 0;
-	if (fwrite(&length, 4, 1, fp) != 1) return false;
+	if (!SaveBuffer_Write(sb, &length, 4)) return false;
 
 	/* Write the 'SCEN' chunk. Never contains content. */
-	if (fwrite("SCEN", 4, 1, fp) != 1) return false;
+	if (!SaveBuffer_Write(sb, "SCEN", 4)) return false;
 
 	/* Write the 'NAME' chunk. Keep ourself word-aligned. */
-	if (fwrite("NAME", 4, 1, fp) != 1) return false;
+	if (!SaveBuffer_Write(sb, "NAME", 4)) return false;
 	length = min(255, strlen(description) + 1);
 	lengthSwapped = HTOBE32(length);
-	if (fwrite(&lengthSwapped, 4, 1, fp) != 1) return false;
-	if (fwrite(description, length, 1, fp) != 1) return false;
+	if (!SaveBuffer_Write(sb, &lengthSwapped, 4)) return false;
+	if (!SaveBuffer_Write(sb, description, length)) return false;
 	/* Ensure we are word aligned */
 	if ((length & 1) == 1) {
 		uint8 empty = 0;
-		if (fwrite(&empty, 1, 1, fp) != 1) return false;
+		if (!SaveBuffer_Write(sb, &empty, 1)) return false;
 	}
 
 	/* Store all additional chunks */
-	if (!Save_Chunk(fp, "INFO", &Info_Save)) return false;
-	if (!Save_Chunk(fp, "PLYR", &House_Save)) return false;
-	if (!Save_Chunk(fp, "UNIT", &Unit_Save)) return false;
-	if (!Save_Chunk(fp, "BLDG", &Structure_Save)) return false;
-	if (!Save_Chunk(fp, "MAP ", &Map_Save)) return false;
-	if (!Save_Chunk(fp, "TEAM", &Team_Save)) return false;
-	if (!Save_Chunk(fp, "ODUN", &UnitNew_Save)) return false;
+	if (!Save_Chunk(sb, "INFO", &Info_Save)) return false;
+	if (!Save_Chunk(sb, "PLYR", &House_Save)) return false;
+	if (!Save_Chunk(sb, "UNIT", &Unit_Save)) return false;
+	if (!Save_Chunk(sb, "BLDG", &Structure_Save)) return false;
+	if (!Save_Chunk(sb, "MAP ", &Map_Save)) return false;
+	if (!Save_Chunk(sb, "TEAM", &Team_Save)) return false;
+	if (!Save_Chunk(sb, "ODUN", &UnitNew_Save)) return false;
 
 	/* Store Dune Dynasty extensions. */
 	if (g_campaign_selected == CAMPAIGNID_SKIRMISH) {
-		if (!Save_Chunk(fp, "DDS2", &Scenario_Save2)) return false;
-		if (!Save_Chunk(fp, "DDS4", &Scenario_Save4)) return false;
+		if (!Save_Chunk(sb, "DDS2", &Scenario_Save2)) return false;
+		if (!Save_Chunk(sb, "DDS4", &Scenario_Save4)) return false;
 	}
 
-	if (!Save_Chunk(fp, "DDS3", &Scenario_Save3)) return false;
-	if (!Save_Chunk(fp, "DDI2", &Info_Save2)) return false;
-	if (!Save_Chunk(fp, "DDH2", &House_Save2)) return false;
-	if (!Save_Chunk(fp, "DDM2", &Map_Save2)) return false;
-	if (!Save_Chunk(fp, "DDB2", &Structure_Save2)) return false;
-	if (!Save_Chunk(fp, "DDU2", &Unit_Save2)) return false;
-	if (!Save_Chunk(fp, "DDAI", &BrutalAI_Save)) return false;
-
-	/* Write the total length of all data in the FORM chunk */
-	length = ftell(fp) - 8;
-	fseek(fp, 4, SEEK_SET);
-	lengthSwapped = HTOBE32(length);
-	if (fwrite(&lengthSwapped, 4, 1, fp) != 1) return false;
+	if (!Save_Chunk(sb, "DDS3", &Scenario_Save3)) return false;
+	if (!Save_Chunk(sb, "DDI2", &Info_Save2)) return false;
+	if (!Save_Chunk(sb, "DDH2", &House_Save2)) return false;
+	if (!Save_Chunk(sb, "DDM2", &Map_Save2)) return false;
+	if (!Save_Chunk(sb, "DDB2", &Structure_Save2)) return false;
+	if (!Save_Chunk(sb, "DDU2", &Unit_Save2)) return false;
+	if (!Save_Chunk(sb, "DDAI", &BrutalAI_Save)) return false;
+
+	/* Fill in the total length of all data in the FORM chunk */
+	SaveBuffer_Patch_be_uint32(sb, 4, sb->length - 8);
 
 	return true;
 }
 
+static uint32
+Save_ChunkLength(const SaveBuffer *sb, uint32 position)
+{
+	const uint8 *p = sb->data + position + 4;
+
+	return ((uint32)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
 /**
- * Save the game to a filename
+ * Compress the contents of every chunk after NAME into a buffer.
  *
- * @param fp The filename of the savegame.
- * @param description The description of the savegame.
+ * @param data The buffer to store the compressed contents in.
+ * @param index The index to fill, with room for SAVEGAME_CONTAINER_CHUNKS_MAX entries.
+ * @param count The number of chunks indexed.
+ * @param raw The savegame built by Save_Main.
+ * @param position The offset of the first chunk after NAME.
+ * @return True if and only if all chunks were compressed.
+ */
+static bool
+Save_CompressChunks(SaveBuffer *data, SaveChunkIndex *index, uint16 *count, const SaveBuffer *raw, uint32 position)
+{
+	*count = 0;
+
+	while (position + 8 <= raw->length) {
+		const uint32 rawLength = Save_ChunkLength(raw, position);
+		const uint8 *source = raw->data + position + 8;
+
+		if (*count >= SAVEGAME_CONTAINER_CHUNKS_MAX) return false;
+		if (!SaveBuffer_Reserve(data, rawLength)) return false;
+
+		SaveChunkIndex *entry = &index[(*count)++];
+		memcpy(entry->header, raw->data + position, 4);
+		entry->rawLength = rawLength;
+		entry->storedLength = 0;
+
+		/* Store the chunk as is unless compressing saves at least a byte */
+		if (rawLength > 1)
+			entry->storedLength = LZBlock_Encode(data->data + data->length, rawLength - 1, source, rawLength);
+
+		if (entry->storedLength == 0 && rawLength != 0) {
+			memcpy(data->data + data->length, source, rawLength);
+			entry->storedLength = rawLength;
+		}
+
+		data->length += entry->storedLength;
+		position += 8 + rawLength + (rawLength & 1);
+	}
+
+	return true;
+}
+
+/**
+ * Repack a savegame built by Save_Main into the compressed container
+ *  described in saveload.h.  The NAME chunk is kept uncompressed at the
+ *  same place, so the save menu reads it as from any other savegame.
+ *
+ * @param sb The savegame buffer to save to.
+ * @param raw The savegame built by Save_Main.
  * @return True if and only if all bytes were written successful.
  */
+static bool
+Save_Compress(SaveBuffer *sb, const SaveBuffer *raw)
+{
+	SaveChunkIndex index[SAVEGAME_CONTAINER_CHUNKS_MAX];
+	SaveBuffer data;
+	uint32 position;
+	uint32 length;
+	uint16 count;
+
+	/* Skip 'FORM', its length and 'SCEN' to find the 'NAME' chunk */
+	length = 8 + Save_ChunkLength(raw, 12);
+	length += length & 1;
+	position = 12 + length;
+
+	SaveBuffer_Init(&data);
+	if (!Save_CompressChunks(&data, index, &count, raw, position)) {
+		SaveBuffer_Free(&data);
+		return false;
+	}
+
+	/* Write the 'FORM' chunk, of our own type, and copy the 'NAME' chunk */
+	bool res = SaveBuffer_Write(sb, "FORM", 4)
+		&& SaveBuffer_Write_le_uint32(sb, 0)
+		&& SaveBuffer_Write(sb, "DDZS", 4)
+		&& SaveBuffer_Write(sb, raw->data + 12, length);
+
+	/* Write the 'DDZI' chunk */
+	res = res
+		&& SaveBuffer_Write(sb, "DDZI", 4)
+		&& SaveBuffer_Write_le_uint32(sb, 0)
+		&& SaveBuffer_Write_le_uint16(sb, SAVEGAME_CONTAINER_VERSION)
+		&& SaveBuffer_Write_le_uint16(sb, count);
+
+	for (uint16 i = 0; res && i < count; i++) {
+		res = SaveBuffer_Write(sb, index[i].header, 4)
+			&& SaveBuffer_Write_le_uint32(sb, index[i].rawLength)
+			&& SaveBuffer_Write_le_uint32(sb, index[i].storedLength);
+	}
+
+	if (res)
+		SaveBuffer_Patch_be_uint32(sb, 12 + length + 4, 4 + 12 * count);
+
+	/* Write the 'DDZD' chunk, word aligned */
+	res = res
+		&& SaveBuffer_Write(sb, "DDZD", 4)
+		&& SaveBuffer_Write_le_uint32(sb, 0)
+		&& SaveBuffer_Write(sb, data.data, data.length);
+
+	if (res) {
+		SaveBuffer_Patch_be_uint32(sb, sb->length - data.length - 4, data.length);
+
+		if ((data.length & 1) == 1) {
+			uint8 empty = 0;
+			res = SaveBuffer_Write(sb, &empty, 1);
+		}
+	}
+
+	SaveBuffer_Free(&data);
+	if (!res) return false;
+
+	/* Fill in the total length of all data in the FORM chunk */
+	SaveBuffer_Patch_be_uint32(sb, 4, sb->length - 8);
+
+	return true;
+}
+
+/**
+ * Build a savegame in memory, to be written out later, possibly on
+ *  another thread.
+ *
+ * @param sb The savegame buffer to save to, initialised by the caller.
+ * @param description The description of the savegame.
+ * @return True if and only if all chunks were stored successfully.
+ */
 bool
-SaveFile(const char *filename, const char *description)
+SaveFile_ToBuffer(SaveBuffer *sb, const char *description)
 {
-	FILE *fp;
 	bool res;
 
 	/* In debug-scenario mode, the whole map is uncovered. Cover it now in
@@ -178,17 +306,54 @@ SaveFile(const char *filename, const char *description)
 		}
 	}
 
-	fp = File_Open_CaseInsensitive(SEARCHDIR_PERSONAL_DATA_DIR, filename, "wb");
-	if (fp == NULL) {
-		GUI_DisplayModalMessage("Failed to open file '%s' for writing.", SHAPE_INVALID, filename);
-		return false;
-	}
-
 	g_validateStrictIfZero++;
-	res = Save_Main(fp, description);
+	if (g_savegame_compress) {
+		SaveBuffer raw;
+
+		SaveBuffer_Init(&raw);
+		res = Save_Main(&raw, description) && Save_Compress(sb, &raw);
+		SaveBuffer_Free(&raw);
+	} else {
+		res = Save_Main(sb, description);
+	}
 	g_validateStrictIfZero--;
 
-	fclose(fp);
+	return res;
+}
+
+/**
+ * Save the game to a filename
+ *
+ * @param fp The filename of the savegame.
+ * @param description The description of the savegame.
+ * @return True if and only if all bytes were written successful.
+ */
+bool
+SaveFile(const char *filename, const char *description)
+{
+	SaveBuffer sb;
+	FILE *fp;
+	bool res;
+
+	/* Build the whole savegame in memory, so that the file is written
+	 * with a single write instead of seeking back for every chunk.
+	 */
+	SaveBuffer_Init(&sb);
+	res = SaveFile_ToBuffer(&sb, description);
+
+	if (res) {
+		fp = File_Open_CaseInsensitive(SEARCHDIR_PERSONAL_DATA_DIR, filename, "wb");
+		if (fp == NULL) {
+			SaveBuffer_Free(&sb);
+			GUI_DisplayModalMessage("Failed to open file '%s' for writing.", SHAPE_INVALID, filename);
+			return false;
+		}
+
+		res = SaveBuffer_WriteFile(&sb, fp);
+		fclose(fp);
+	}
+
+	SaveBuffer_Free(&sb);
 
 	if (!res) {
 		/* TODO -- Also remove the savegame now */
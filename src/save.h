@@ -3,6 +3,11 @@
 #ifndef SAVE_H
 #define SAVE_H
 
+struct SaveBuffer;
+
+extern bool g_savegame_compress;
+
+extern bool SaveFile_ToBuffer(struct SaveBuffer *sb, const char *description);
 extern bool SaveFile(const char *filename, const char *description);
 
 #endif /* SAVE_H */
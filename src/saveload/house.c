@@ -49,11 +49,11 @@ static const SaveLoadDesc s_saveHouse2[] = {
 
 /**
  * Load all Houses from a file.
- * @param fp The file to load from.
+ * @param sb The savegame buffer to load from.
  * @param length The length of the data chunk.
  * @return True if and only if all bytes were read successful.
  */
-bool House_Load(FILE *fp, uint32 length)
+bool House_Load(SaveBuffer *sb, uint32 length)
 {
 	while (length > 0) {
 		House *h;
@@ -62,7 +62,7 @@ bool House_Load(FILE *fp, uint32 length)
 		memset(&hl, 0, sizeof(hl));
 
 		/* Read the next House from disk */
-		if (!SaveLoad_Load(s_saveHouse, fp, &hl)) return false;
+		if (!SaveLoad_Load(s_saveHouse, sb, &hl)) return false;
 
 		length -= SaveLoad_GetLength(s_saveHouse);
 
@@ -96,17 +96,17 @@ bool House_Load(FILE *fp, uint32 length)
 
 /**
  * Load all Houses from a file.
- * @param fp The file to load from.
+ * @param sb The savegame buffer to load from.
  * @param length The length of the data chunk.
  * @return True if and only if all bytes were read successful.
  */
-bool House_LoadOld(FILE *fp, uint32 length)
+bool House_LoadOld(SaveBuffer *sb, uint32 length)
 {
 	while (length > 0) {
 		House hl;
 
 		/* Read the next House from disk */
-		if (!SaveLoad_Load(s_saveHouse, fp, &hl)) return false;
+		if (!SaveLoad_Load(s_saveHouse, sb, &hl)) return false;
 
 		/* See if it is a human house */
 		if (hl.flags.human) {
@@ -123,17 +123,17 @@ bool House_LoadOld(FILE *fp, uint32 length)
 
 /**
  * Save all Houses to a file.
- * @param fp The file to save to.
+ * @param sb The savegame buffer to save to.
  * @return True if and only if all bytes were written successful.
  */
-bool House_Save(FILE *fp)
+bool House_Save(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
 	for (House *h = House_FindFirst(&find, HOUSE_INVALID);
 			h != NULL;
 			h = House_FindNext(&find)) {
-		if (!SaveLoad_Save(s_saveHouse, fp, h)) return false;
+		if (!SaveLoad_Save(s_saveHouse, sb, h)) return false;
 	}
 
 	return true;
@@ -142,14 +142,14 @@ bool House_Save(FILE *fp)
 /*--------------------------------------------------------------*/
 
 bool
-House_Load2(FILE *fp, uint32 length)
+House_Load2(SaveBuffer *sb, uint32 length)
 {
 	uint32 bytes_read = 0;
 
 	while (bytes_read < length) {
 		House hl;
 
-		if (!SaveLoad_Load(s_saveHouse2, fp, &hl))
+		if (!SaveLoad_Load(s_saveHouse2, sb, &hl))
 			return false;
 
 		bytes_read += SaveLoad_GetLength(s_saveHouse2);
@@ -166,14 +166,14 @@ House_Load2(FILE *fp, uint32 length)
 }
 
 bool
-House_Save2(FILE *fp)
+House_Save2(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
 	for (House *h = House_FindFirst(&find, HOUSE_INVALID);
 			h != NULL;
 			h = House_FindNext(&find)) {
-		if (!SaveLoad_Save(s_saveHouse2, fp, h))
+		if (!SaveLoad_Save(s_saveHouse2, sb, h))
 			return false;
 	}
 
@@ -129,14 +129,14 @@ static const SaveLoadDesc s_saveInfo2[] = {
 
 /**
  * Load all kinds of important info from a file.
- * @param fp The file to load from.
+ * @param sb The savegame buffer to load from.
  * @param length The length of the data chunk.
  * @return True if and only if all bytes were read successful.
  */
-bool Info_Load(FILE *fp, uint32 length)
+bool Info_Load(SaveBuffer *sb, uint32 length)
 {
 	if (SaveLoad_GetLength(s_saveInfo) != length) return false;
-	if (!SaveLoad_Load(s_saveInfo, fp, NULL)) return false;
+	if (!SaveLoad_Load(s_saveInfo, sb, NULL)) return false;
 
 	g_selectionPosition = g_selectionRectanglePosition;
 	Map_MoveDirection(0, 0);
@@ -150,15 +150,15 @@ bool Info_Load(FILE *fp, uint32 length)
 
 /**
  * Load all kinds of important info from a file.
- * @param fp The file to load from.
+ * @param sb The savegame buffer to load from.
  * @param length The length of the data chunk.
  * @return True if and only if all bytes were read successful.
  */
-bool Info_LoadOld(FILE *fp, uint32 length)
+bool Info_LoadOld(SaveBuffer *sb, uint32 length)
 {
 	VARIABLE_NOT_USED(length);
 
-	if (!SaveLoad_Load(s_saveInfoOld, fp, NULL)) return false;
+	if (!SaveLoad_Load(s_saveInfoOld, sb, NULL)) return false;
 
 	return true;
 }
@@ -179,10 +179,10 @@ Info_Load_PlayerHouseGlobals(House *h)
 
 /**
  * Save all kinds of important info to the savegame.
- * @param fp The file to save to.
+ * @param sb The savegame buffer to save to.
  * @return True if and only if all bytes were written successful.
  */
-bool Info_Save(FILE *fp)
+bool Info_Save(SaveBuffer *sb)
 {
 	const uint16 savegameVersion = 0x0290;
 
@@ -200,10 +200,10 @@ bool Info_Save(FILE *fp)
 		s_starportID            = STRUCTURE_INDEX_INVALID;
 	}
 
-	if (!fwrite_le_uint16(savegameVersion, fp)) return false;
+	if (!SaveBuffer_Write_le_uint16(sb, savegameVersion)) return false;
 
 	Scenario_Save_OldStats();
-	if (!SaveLoad_Save(s_saveInfo, fp, NULL)) return false;
+	if (!SaveLoad_Save(s_saveInfo, sb, NULL)) return false;
 
 	return true;
 }
@@ -211,13 +211,13 @@ bool Info_Save(FILE *fp)
 /*--------------------------------------------------------------*/
 
 bool
-Info_Load2(FILE *fp, uint32 length)
+Info_Load2(SaveBuffer *sb, uint32 length)
 {
 	Unit_UnselectAll();
 
 	while (length > 0) {
 		Unit ul;
-		if (!SaveLoad_Load(s_saveInfo2, fp, &ul))
+		if (!SaveLoad_Load(s_saveInfo2, sb, &ul))
 			return false;
 
 		length -= SaveLoad_GetLength(s_saveInfo2);
@@ -233,13 +233,13 @@ Info_Load2(FILE *fp, uint32 length)
 }
 
 bool
-Info_Save2(FILE *fp)
+Info_Save2(SaveBuffer *sb)
 {
 	int iter;
 
 	Unit *u = Unit_FirstSelected(&iter);
 	while (u != NULL) {
-		if (!SaveLoad_Save(s_saveInfo2, fp, u))
+		if (!SaveLoad_Save(s_saveInfo2, sb, u))
 			return false;
 
 		u = Unit_NextSelected(&iter);
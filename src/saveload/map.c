@@ -8,16 +8,16 @@
 #include "../timer/timer.h"
 
 /**
- * Load a Tile structure to a file (Little endian)
+ * Load a Tile structure from a savegame buffer (Little endian)
  *
  * @param t The tile to read
- * @param fp The stream
+ * @param sb The savegame buffer
  * @return True if the tile was loaded successfully
  */
-static bool fread_tile(Tile *t, FILE *fp)
+static bool fread_tile(Tile *t, SaveBuffer *sb)
 {
 	uint8 buffer[4];
-	if (fread(buffer, 1, 4, fp) != 4) return false;
+	if (!SaveBuffer_Read(sb, buffer, 4)) return false;
 	t->groundSpriteID = buffer[0] | ((buffer[1] & 1) << 8);
 	t->overlaySpriteID = buffer[1] >> 1;
 	t->houseID      = (buffer[2] & 0x07);
@@ -31,17 +31,19 @@ static bool fread_tile(Tile *t, FILE *fp)
 }
 
 /**
- * Save a Tile structure to a file (Little endian)
+ * Save a Tile structure to a savegame buffer (Little endian)
  *
- * @param t The tile to save
- * @param fp The stream
+ * @param packed The position of the tile
+ * @param sb The savegame buffer
  * @return True if the tile was saved successfully
  */
-static bool fwrite_tile(const Tile *t, const FogOfWarTile *f, FILE *fp)
+static bool fwrite_tile(uint16 packed, SaveBuffer *sb)
 {
+	const Tile *t = &g_map[packed];
+	const FogOfWarTile *f = &g_mapVisible[packed];
 	uint8 buffer[4];
 	uint8 overlaySpriteID = f->fogSpriteID ? f->fogSpriteID : t->overlaySpriteID;
-	const bool isUnveiled = f->isUnveiled & (1 << g_playerHouseID);
+	const bool isUnveiled = Map_IsUnveiledToHouse(g_playerHouseID, packed);
 
 	buffer[0] = t->groundSpriteID & 0xff;
 	buffer[1] = (t->groundSpriteID >> 8) | (overlaySpriteID << 1);
@@ -52,17 +54,17 @@ static bool fwrite_tile(const Tile *t, const FogOfWarTile *f, FILE *fp)
 	          | (t->hasAnimation << 6)
 	          | (t->hasExplosion << 7);
 	buffer[3] = t->index;
-	if (fwrite(buffer, 1, 4, fp) != 4) return false;
+	if (!SaveBuffer_Write(sb, buffer, 4)) return false;
 	return true;
 }
 
 /**
  * Load all Tiles from a file.
- * @param fp The file to load from.
+ * @param sb The savegame buffer to load from.
  * @param length The length of the data chunk.
  * @return True if and only if all bytes were read successful.
  */
-bool Map_Load(FILE *fp, uint32 length)
+bool Map_Load(SaveBuffer *sb, uint32 length)
 {
 	uint16 i;
 
@@ -78,11 +80,11 @@ bool Map_Load(FILE *fp, uint32 length)
 
 		length -= sizeof(uint16) + sizeof(Tile);
 
-		if (!fread_le_uint16(&i, fp)) return false;
+		if (!SaveBuffer_Read_le_uint16(sb, &i)) return false;
 		if (i >= 0x1000) return false;
 
 		t = &g_map[i];
-		if (!fread_tile(t, fp)) return false;
+		if (!fread_tile(t, sb)) return false;
 
 		if (g_mapSpriteID[i] != t->groundSpriteID) {
 			g_mapSpriteID[i] |= 0x8000;
@@ -95,19 +97,17 @@ bool Map_Load(FILE *fp, uint32 length)
 
 /**
  * Save all Tiles to a file.
- * @param fp The file to save to.
+ * @param sb The savegame buffer to save to.
  * @return True if and only if all bytes were written successful.
  */
-bool Map_Save(FILE *fp)
+bool Map_Save(SaveBuffer *sb)
 {
 	uint16 i;
 
 	for (i = 0; i < 0x1000; i++) {
-		Tile *tile = &g_map[i];
-
 		/* Store the index, then the tile itself */
-		if (!fwrite_le_uint16(i, fp)) return false;
-		if (!fwrite_tile(tile, &g_mapVisible[i], fp)) return false;
+		if (!SaveBuffer_Write_le_uint16(sb, i)) return false;
+		if (!fwrite_tile(i, sb)) return false;
 	}
 
 	return true;
@@ -119,15 +119,17 @@ bool Map_Save(FILE *fp)
 void
 Map_Load2Fallback(void)
 {
+	memset(g_mapFog, 0, sizeof(g_mapFog));
+
 	for (uint16 packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++) {
 		Tile *t = &g_map[packed];
 		FogOfWarTile *f = &g_mapVisible[packed];
 
-		memset(f->timeout, 0, sizeof(f->timeout));
+		if (t->isUnveiled_) Map_SetUnveiledToHouseOnly(g_playerHouseID, packed);
+
 		f->groundSpriteID   = t->groundSpriteID;
 		f->houseID          = t->houseID;
 		f->hasStructure     = t->hasStructure;
-		f->isUnveiled       = t->isUnveiled_ ? (1 << g_playerHouseID) : 0;
 		f->fogOverlayBits   = 0;
 
 		if (g_veiledSpriteID - 16 <= t->overlaySpriteID && t->overlaySpriteID <= g_veiledSpriteID) {
@@ -142,7 +144,7 @@ Map_Load2Fallback(void)
 }
 
 bool
-Map_Load2(FILE *fp, uint32 length)
+Map_Load2(SaveBuffer *sb, uint32 length)
 {
 	while (length >= 3 * sizeof(uint16) + 2 * sizeof(uint8)) {
 		uint16 packed;
@@ -151,16 +153,16 @@ Map_Load2(FILE *fp, uint32 length)
 		uint8 houseID;
 		uint8 hasStructure;
 
-		if (fread(&packed,      sizeof(uint16), 1, fp) != 1) return false;
-		if (fread(&timeout,     sizeof(uint16), 1, fp) != 1) return false;
-		if (fread(&spriteID,    sizeof(uint16), 1, fp) != 1) return false;
-		if (fread(&houseID,     sizeof(uint8),  1, fp) != 1) return false;
-		if (fread(&hasStructure,sizeof(uint8),  1, fp) != 1) return false;
+		if (!SaveBuffer_Read(sb, &packed,       sizeof(uint16))) return false;
+		if (!SaveBuffer_Read(sb, &timeout,      sizeof(uint16))) return false;
+		if (!SaveBuffer_Read(sb, &spriteID,     sizeof(uint16))) return false;
+		if (!SaveBuffer_Read(sb, &houseID,      sizeof(uint8)))  return false;
+		if (!SaveBuffer_Read(sb, &hasStructure, sizeof(uint8)))  return false;
 
 		FogOfWarTile *f = &g_mapVisible[packed];
 
 		for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++)
-			f->timeout[h]   = (timeout == 0) ? 0 : (g_timerGame + timeout);
+			g_mapFog[h].timeout[packed] = (timeout == 0) ? 0 : (g_timerGame + timeout);
 
 		f->groundSpriteID   = (spriteID & 0x1FF);
 		f->houseID          = houseID;
@@ -180,21 +182,23 @@ Map_Load2(FILE *fp, uint32 length)
 }
 
 bool
-Map_Save2(FILE *fp)
+Map_Save2(SaveBuffer *sb)
 {
 	for (uint16 packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++) {
 		const FogOfWarTile *f = &g_mapVisible[packed];
-		uint16 timeout      = (f->timeout[g_playerHouseID] <= g_timerGame) ? 0 : (f->timeout[g_playerHouseID] - g_timerGame);
+		const uint32 now    = g_timerGame;
+		const uint32 expiry = g_mapFog[g_playerHouseID].timeout[packed];
+		uint16 timeout      = (expiry <= now) ? 0 : (expiry - now);
 		uint8  overlay      = f->fogSpriteID ? f->fogSpriteID : f->overlaySpriteID;
 		uint16 spriteID     = ((overlay & 0x7F) << 9) | (f->groundSpriteID & 0x1FF);
 		uint8 houseID       = f->houseID;
 		uint8 hasStructure  = f->hasStructure;
 
-		if (fwrite(&packed,         sizeof(uint16), 1, fp) != 1) return false;
-		if (fwrite(&timeout,        sizeof(uint16), 1, fp) != 1) return false;
-		if (fwrite(&spriteID,       sizeof(uint16), 1, fp) != 1) return false;
-		if (fwrite(&houseID,        sizeof(uint8),  1, fp) != 1) return false;
-		if (fwrite(&hasStructure,   sizeof(uint8),  1, fp) != 1) return false;
+		if (!SaveBuffer_Write(sb, &packed,       sizeof(uint16))) return false;
+		if (!SaveBuffer_Write(sb, &timeout,      sizeof(uint16))) return false;
+		if (!SaveBuffer_Write(sb, &spriteID,     sizeof(uint16))) return false;
+		if (!SaveBuffer_Write(sb, &houseID,      sizeof(uint8)))  return false;
+		if (!SaveBuffer_Write(sb, &hasStructure, sizeof(uint8)))  return false;
 	}
 
 	return true;
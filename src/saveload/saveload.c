@@ -1,5 +1,8 @@
 /** @file src/saveload/saveload.c General routines for load/save. */
 
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 #include "errorlog.h"
 
 #include "saveload.h"
@@ -7,7 +10,167 @@
 #include "../house.h"
 #include "../object.h"
 #include "../team.h"
-#include "../file.h"
+
+/*--------------------------------------------------------------*/
+
+void
+SaveBuffer_Init(SaveBuffer *sb)
+{
+	sb->data = NULL;
+	sb->length = 0;
+	sb->capacity = 0;
+	sb->position = 0;
+}
+
+void
+SaveBuffer_Free(SaveBuffer *sb)
+{
+	free(sb->data);
+	SaveBuffer_Init(sb);
+}
+
+/**
+ * Read the whole of a file into the buffer, to be loaded from.
+ * @param sb The buffer, which must be empty.
+ * @param fp The file to read from.
+ * @return True if and only if the whole file was read.
+ */
+bool
+SaveBuffer_ReadFile(SaveBuffer *sb, FILE *fp)
+{
+	if (fseek(fp, 0, SEEK_END) != 0) return false;
+
+	const long size = ftell(fp);
+	if (size <= 0) return false;
+	if (fseek(fp, 0, SEEK_SET) != 0) return false;
+
+	sb->data = malloc(size);
+	if (sb->data == NULL) return false;
+
+	sb->capacity = size;
+	sb->position = 0;
+	if (fread(sb->data, size, 1, fp) != 1) return false;
+
+	sb->length = size;
+	return true;
+}
+
+/**
+ * Write the contents of the buffer to a file with a single write.
+ * @param sb The buffer.
+ * @param fp The file to write to.
+ * @return True if and only if all bytes were written.
+ */
+bool
+SaveBuffer_WriteFile(const SaveBuffer *sb, FILE *fp)
+{
+	if (sb->length == 0)
+		return true;
+
+	return (fwrite(sb->data, sb->length, 1, fp) == 1);
+}
+
+bool
+SaveBuffer_Read(SaveBuffer *sb, void *data, uint32 len)
+{
+	if ((sb->position > sb->length) || (len > sb->length - sb->position))
+		return false;
+
+	memcpy(data, sb->data + sb->position, len);
+	sb->position += len;
+	return true;
+}
+
+bool
+SaveBuffer_Read_le_uint16(SaveBuffer *sb, uint16 *value)
+{
+	uint8 buf[2];
+
+	if (!SaveBuffer_Read(sb, buf, sizeof(buf)))
+		return false;
+
+	*value = buf[0] | (buf[1] << 8);
+	return true;
+}
+
+bool
+SaveBuffer_Read_le_uint32(SaveBuffer *sb, uint32 *value)
+{
+	uint8 buf[4];
+
+	if (!SaveBuffer_Read(sb, buf, sizeof(buf)))
+		return false;
+
+	*value = buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32)buf[3] << 24);
+	return true;
+}
+
+/**
+ * Make room for len more bytes, doubling the allocation so that a whole
+ *  savegame is built with a handful of reallocs.
+ */
+bool
+SaveBuffer_Reserve(SaveBuffer *sb, uint32 len)
+{
+	if (len <= sb->capacity - sb->length)
+		return true;
+
+	uint32 capacity = (sb->capacity == 0) ? 0x10000 : sb->capacity;
+	while (capacity - sb->length < len)
+		capacity *= 2;
+
+	uint8 *data = realloc(sb->data, capacity);
+	if (data == NULL)
+		return false;
+
+	sb->data = data;
+	sb->capacity = capacity;
+	return true;
+}
+
+bool
+SaveBuffer_Write(SaveBuffer *sb, const void *data, uint32 len)
+{
+	if (!SaveBuffer_Reserve(sb, len))
+		return false;
+
+	memcpy(sb->data + sb->length, data, len);
+	sb->length += len;
+	return true;
+}
+
+bool
+SaveBuffer_Write_le_uint16(SaveBuffer *sb, uint16 value)
+{
+	const uint8 buf[2] = { value & 0xFF, value >> 8 };
+
+	return SaveBuffer_Write(sb, buf, sizeof(buf));
+}
+
+bool
+SaveBuffer_Write_le_uint32(SaveBuffer *sb, uint32 value)
+{
+	const uint8 buf[4] = { value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, value >> 24 };
+
+	return SaveBuffer_Write(sb, buf, sizeof(buf));
+}
+
+/**
+ * Overwrite four bytes already written, for chunk lengths which are
+ *  only known once the chunk is complete.
+ */
+void
+SaveBuffer_Patch_be_uint32(SaveBuffer *sb, uint32 offset, uint32 value)
+{
+	assert(offset + 4 <= sb->length);
+
+	sb->data[offset + 0] = value >> 24;
+	sb->data[offset + 1] = (value >> 16) & 0xFF;
+	sb->data[offset + 2] = (value >> 8) & 0xFF;
+	sb->data[offset + 3] = value & 0xFF;
+}
+
+/*--------------------------------------------------------------*/
 
 /**
  * Get the length of the struct how it would be on disk.
@@ -41,13 +204,13 @@ uint32 SaveLoad_GetLength(const SaveLoadDesc *sld)
 }
 
 /**
- * Load from a file into a struct.
+ * Load from a savegame buffer into a struct.
  * @param sld The description of the struct.
- * @param fp The file to read from.
+ * @param sb The buffer to read from.
  * @param object The object instance to read to.
  * @return True if and only if the reading was successful.
  */
-bool SaveLoad_Load(const SaveLoadDesc *sld, FILE *fp, void *object)
+bool SaveLoad_Load(const SaveLoadDesc *sld, SaveBuffer *sb, void *object)
 {
 	while (sld->type_disk != SLDT_NULL) {
 		uint32 value = 0;
@@ -66,7 +229,7 @@ bool SaveLoad_Load(const SaveLoadDesc *sld, FILE *fp, void *object)
 				case SLDT_UINT8: {
 					uint8 v;
 
-					if (fread(&v, sizeof(uint8), 1, fp) != 1) return false;
+					if (!SaveBuffer_Read(sb, &v, sizeof(uint8))) return false;
 
 					value = v;
 				} break;
@@ -74,7 +237,7 @@ bool SaveLoad_Load(const SaveLoadDesc *sld, FILE *fp, void *object)
 				case SLDT_UINT16: {
 					uint16 v;
 
-					if (!fread_le_uint16(&v, fp)) return false;
+					if (!SaveBuffer_Read_le_uint16(sb, &v)) return false;
 
 					value = v;
 				} break;
@@ -82,7 +245,7 @@ bool SaveLoad_Load(const SaveLoadDesc *sld, FILE *fp, void *object)
 				case SLDT_UINT32: {
 					uint32 v;
 
-					if (!fread_le_uint32(&v, fp)) return false;
+					if (!SaveBuffer_Read_le_uint32(sb, &v)) return false;
 
 					value = v;
 				} break;
@@ -91,7 +254,7 @@ bool SaveLoad_Load(const SaveLoadDesc *sld, FILE *fp, void *object)
 				case SLDT_INT8: {
 					int8 v;
 
-					if (fread(&v, sizeof(int8), 1, fp) != 1) return false;
+					if (!SaveBuffer_Read(sb, &v, sizeof(int8))) return false;
 
 					value = v;
 				} break;
@@ -99,7 +262,7 @@ bool SaveLoad_Load(const SaveLoadDesc *sld, FILE *fp, void *object)
 				case SLDT_INT16: {
 					int16 v;
 
-					if (!fread_le_int16(&v, fp)) return false;
+					if (!SaveBuffer_Read_le_uint16(sb, (uint16 *)&v)) return false;
 
 					value = v;
 				} break;
@@ -107,14 +270,14 @@ bool SaveLoad_Load(const SaveLoadDesc *sld, FILE *fp, void *object)
 				case SLDT_INT32: {
 					int32 v;
 
-					if (!fread_le_int32(&v, fp)) return false;
+					if (!SaveBuffer_Read_le_uint32(sb, (uint32 *)&v)) return false;
 
 					value = v;
 				} break;
 
 				case SLDT_CUSTOM: {
 					SaveLoad_CustomCallbackData data;
-					data.fp = fp;
+					data.sb = sb;
 					data.object = object;
 					if (sld->callback(&data, 0, true) == 0) return false;
 				} break;
@@ -198,7 +361,7 @@ bool SaveLoad_Load(const SaveLoadDesc *sld, FILE *fp, void *object)
 
 
 				case SLDT_SLD:
-					if (!SaveLoad_Load(sld->sld, fp, ptr)) return false;
+					if (!SaveLoad_Load(sld->sld, sb, ptr)) return false;
 					break;
 
 				case SLDT_CALLBACK:
@@ -218,13 +381,13 @@ bool SaveLoad_Load(const SaveLoadDesc *sld, FILE *fp, void *object)
 }
 
 /**
- * Save from a struct to a file.
+ * Save from a struct to a savegame buffer.
  * @param sld The description of the struct.
- * @param fp The file to write to.
+ * @param sb The buffer to write to.
  * @param object The object instance to write from.
  * @return True if and only if the writing was successful.
  */
-bool SaveLoad_Save(const SaveLoadDesc *sld, FILE *fp, void *object)
+bool SaveLoad_Save(const SaveLoadDesc *sld, SaveBuffer *sb, void *object)
 {
 	while (sld->type_disk != SLDT_NULL) {
 		uint32 value = 0;
@@ -282,7 +445,7 @@ bool SaveLoad_Save(const SaveLoadDesc *sld, FILE *fp, void *object)
 
 
 				case SLDT_SLD:
-					if (!SaveLoad_Save(sld->sld, fp, ptr)) return false;
+					if (!SaveLoad_Save(sld->sld, sb, ptr)) return false;
 					break;
 
 				case SLDT_CALLBACK:
@@ -304,43 +467,43 @@ bool SaveLoad_Save(const SaveLoadDesc *sld, FILE *fp, void *object)
 				case SLDT_UINT8: {
 					uint8 v = (value > 0xFF) ? 0xFF : (uint8)value;
 
-					if (fwrite(&v, sizeof(uint8), 1, fp) != 1) return false;
+					if (!SaveBuffer_Write(sb, &v, sizeof(uint8))) return false;
 				} break;
 
 				case SLDT_UINT16: {
 					uint16 v = (uint16)value;
 
-					if (!fwrite_le_uint16(v, fp)) return false;
+					if (!SaveBuffer_Write_le_uint16(sb, v)) return false;
 				} break;
 
 				case SLDT_UINT32: {
 					uint32 v = (uint32)value;
 
-					if (!fwrite_le_uint32(v, fp)) return false;
+					if (!SaveBuffer_Write_le_uint32(sb, v)) return false;
 				} break;
 
 
 				case SLDT_INT8: {
 					int8 v = (int8)value;
 
-					if (fwrite(&v, sizeof(int8), 1, fp) != 1) return false;
+					if (!SaveBuffer_Write(sb, &v, sizeof(int8))) return false;
 				} break;
 
 				case SLDT_INT16: {
 					int16 v = (int16)value;
 
-					if (!fwrite_le_int16(v, fp)) return false;
+					if (!SaveBuffer_Write_le_uint16(sb, (uint16)v)) return false;
 				} break;
 
 				case SLDT_INT32: {
 					int32 v = (int32)value;
 
-					if (!fwrite_le_int32(v, fp)) return false;
+					if (!SaveBuffer_Write_le_uint32(sb, (uint32)v)) return false;
 				} break;
 
 				case SLDT_CUSTOM: {
 					SaveLoad_CustomCallbackData data;
-					data.fp = fp;
+					data.sb = sb;
 					data.object = object;
 					if (sld->callback(&data, 0, false) == 0) return false;
 				} break;
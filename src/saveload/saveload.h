@@ -138,8 +138,33 @@ typedef struct SaveLoadDesc {
 	void *address;                                          /*!< The address of the element. */
 } SaveLoadDesc;
 
+/**
+ * A savegame held in memory.  Saving appends to a growable buffer which
+ *  is written to disk at once, and loading reads the whole file first.
+ */
+typedef struct SaveBuffer {
+	uint8 *data;                                            /*!< The contents. */
+	uint32 length;                                          /*!< The number of bytes in data. */
+	uint32 capacity;                                        /*!< The number of bytes allocated for data. */
+	uint32 position;                                        /*!< The offset of the next byte to read. */
+} SaveBuffer;
+
+/**
+ * Compressed savegames are a FORM of type 'DDZS' holding the NAME chunk
+ *  as is, a 'DDZI' index and a 'DDZD' chunk with the contents of the
+ *  other chunks, each compressed with lzblock or stored.  The index has
+ *  a version and a count (uint16 LE), followed by one entry per chunk:
+ *  its identifier, raw length and stored length (uint32 LE).  A chunk
+ *  whose stored length equals its raw length is not compressed.
+ */
+enum {
+	SAVEGAME_CONTAINER_VERSION = 1,
+	SAVEGAME_CONTAINER_CHUNKS_MAX = 64,
+	SAVEGAME_CONTAINER_CHUNK_LENGTH_MAX = 0x1000000
+};
+
 typedef struct SaveLoad_CustomCallbackData {
-	FILE *fp;
+	SaveBuffer *sb;
 	void *object;
 } SaveLoad_CustomCallbackData;
 
@@ -149,45 +174,58 @@ extern const SaveLoadDesc g_saveObject[];
 extern const SaveLoadDesc g_saveScriptEngine[];
 extern const SaveLoadDesc g_saveScenario[];
 
+extern void SaveBuffer_Init(SaveBuffer *sb);
+extern void SaveBuffer_Free(SaveBuffer *sb);
+extern bool SaveBuffer_ReadFile(SaveBuffer *sb, FILE *fp);
+extern bool SaveBuffer_WriteFile(const SaveBuffer *sb, FILE *fp);
+extern bool SaveBuffer_Read(SaveBuffer *sb, void *data, uint32 len);
+extern bool SaveBuffer_Read_le_uint16(SaveBuffer *sb, uint16 *value);
+extern bool SaveBuffer_Read_le_uint32(SaveBuffer *sb, uint32 *value);
+extern bool SaveBuffer_Reserve(SaveBuffer *sb, uint32 len);
+extern bool SaveBuffer_Write(SaveBuffer *sb, const void *data, uint32 len);
+extern bool SaveBuffer_Write_le_uint16(SaveBuffer *sb, uint16 value);
+extern bool SaveBuffer_Write_le_uint32(SaveBuffer *sb, uint32 value);
+extern void SaveBuffer_Patch_be_uint32(SaveBuffer *sb, uint32 offset, uint32 value);
+
 extern uint32 SaveLoad_GetLength(const SaveLoadDesc *sld);
-extern bool SaveLoad_Load(const SaveLoadDesc *sld, FILE *fp, void *object);
-extern bool SaveLoad_Save(const SaveLoadDesc *sld, FILE *fp, void *object);
-
-extern bool House_Load(FILE *fp, uint32 length);
-extern bool House_LoadOld(FILE *fp, uint32 length);
-extern bool House_Save(FILE *fp);
-extern bool House_Load2(FILE *fp, uint32 length);
-extern bool House_Save2(FILE *fp);
-extern bool Info_Load(FILE *fp, uint32 length);
-extern bool Info_LoadOld(FILE *fp, uint32 length);
+extern bool SaveLoad_Load(const SaveLoadDesc *sld, SaveBuffer *sb, void *object);
+extern bool SaveLoad_Save(const SaveLoadDesc *sld, SaveBuffer *sb, void *object);
+
+extern bool House_Load(SaveBuffer *sb, uint32 length);
+extern bool House_LoadOld(SaveBuffer *sb, uint32 length);
+extern bool House_Save(SaveBuffer *sb);
+extern bool House_Load2(SaveBuffer *sb, uint32 length);
+extern bool House_Save2(SaveBuffer *sb);
+extern bool Info_Load(SaveBuffer *sb, uint32 length);
+extern bool Info_LoadOld(SaveBuffer *sb, uint32 length);
 extern void Info_Load_PlayerHouseGlobals(struct House *h);
-extern bool Info_Save(FILE *fp);
-extern bool Info_Load2(FILE *fp, uint32 length);
-extern bool Info_Save2(FILE *fp);
-extern bool Map_Load(FILE *fp, uint32 length);
-extern bool Map_Save(FILE *fp);
+extern bool Info_Save(SaveBuffer *sb);
+extern bool Info_Load2(SaveBuffer *sb, uint32 length);
+extern bool Info_Save2(SaveBuffer *sb);
+extern bool Map_Load(SaveBuffer *sb, uint32 length);
+extern bool Map_Save(SaveBuffer *sb);
 extern void Map_Load2Fallback(void);
-extern bool Map_Load2(FILE *fp, uint32 length);
-extern bool Map_Save2(FILE *fp);
+extern bool Map_Load2(SaveBuffer *sb, uint32 length);
+extern bool Map_Save2(SaveBuffer *sb);
 extern void Scenario_Load_OldStats(void);
 extern void Scenario_Save_OldStats(void);
-extern bool Scenario_Load2(FILE *fp, uint32 length);
-extern bool Scenario_Save2(FILE *fp);
-extern bool Scenario_Load3(FILE *fp, uint32 length);
-extern bool Scenario_Save3(FILE *fp);
-extern bool Scenario_Load4(FILE *fp, uint32 length);
-extern bool Scenario_Save4(FILE *fp);
-extern bool Structure_Load(FILE *fp, uint32 length);
-extern bool Structure_Save(FILE *fp);
-extern bool Structure_Load2(FILE *fp, uint32 length);
-extern bool Structure_Save2(FILE *fp);
-extern bool Team_Load(FILE *fp, uint32 length);
-extern bool Team_Save(FILE *fp);
-extern bool Unit_Load(FILE *fp, uint32 length);
-extern bool Unit_Save(FILE *fp);
-extern bool Unit_Load2(FILE *fp, uint32 length);
-extern bool Unit_Save2(FILE *fp);
-extern bool UnitNew_Load(FILE *fp, uint32 length);
-extern bool UnitNew_Save(FILE *fp);
+extern bool Scenario_Load2(SaveBuffer *sb, uint32 length);
+extern bool Scenario_Save2(SaveBuffer *sb);
+extern bool Scenario_Load3(SaveBuffer *sb, uint32 length);
+extern bool Scenario_Save3(SaveBuffer *sb);
+extern bool Scenario_Load4(SaveBuffer *sb, uint32 length);
+extern bool Scenario_Save4(SaveBuffer *sb);
+extern bool Structure_Load(SaveBuffer *sb, uint32 length);
+extern bool Structure_Save(SaveBuffer *sb);
+extern bool Structure_Load2(SaveBuffer *sb, uint32 length);
+extern bool Structure_Save2(SaveBuffer *sb);
+extern bool Team_Load(SaveBuffer *sb, uint32 length);
+extern bool Team_Save(SaveBuffer *sb);
+extern bool Unit_Load(SaveBuffer *sb, uint32 length);
+extern bool Unit_Save(SaveBuffer *sb);
+extern bool Unit_Load2(SaveBuffer *sb, uint32 length);
+extern bool Unit_Save2(SaveBuffer *sb);
+extern bool UnitNew_Load(SaveBuffer *sb, uint32 length);
+extern bool UnitNew_Save(SaveBuffer *sb);
 
 #endif /* SAVELOAD_SAVELOAD_H */
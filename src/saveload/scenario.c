@@ -79,14 +79,15 @@ Scenario_Save_OldStats(void)
 /*--------------------------------------------------------------*/
 
 bool
-Scenario_Load2(FILE *fp, uint32 length)
+Scenario_Load2(SaveBuffer *sb, uint32 length)
 {
 	if (length != HOUSE_NEUTRAL)
 		return false;
 
 	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
 		char c;
-		fread(&c, sizeof(char), 1, fp);
+		if (!SaveBuffer_Read(sb, &c, sizeof(char)))
+			return false;
 
 		     if (c == ' ') g_skirmish.player_config[h].brain = BRAIN_NONE;
 		else if (c == 'H') g_skirmish.player_config[h].brain = BRAIN_HUMAN;
@@ -97,42 +98,44 @@ Scenario_Load2(FILE *fp, uint32 length)
 }
 
 bool
-Scenario_Save2(FILE *fp)
+Scenario_Save2(SaveBuffer *sb)
 {
 	const char brain_char[3] = { ' ', 'H', 'C' };
 
 	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
 		char c = brain_char[g_skirmish.player_config[h].brain];
-		fwrite(&c, sizeof(char), 1, fp);
+		if (!SaveBuffer_Write(sb, &c, sizeof(char)))
+			return false;
 	}
 
 	return true;
 }
 
 bool
-Scenario_Load3(FILE *fp, uint32 length)
+Scenario_Load3(SaveBuffer *sb, uint32 length)
 {
 	if (SaveLoad_GetLength(s_saveScenario3) != length)
 		return false;
 
-	return SaveLoad_Load(s_saveScenario3, fp, &g_scenario);
+	return SaveLoad_Load(s_saveScenario3, sb, &g_scenario);
 }
 
 bool
-Scenario_Save3(FILE *fp)
+Scenario_Save3(SaveBuffer *sb)
 {
-	return SaveLoad_Save(s_saveScenario3, fp, &g_scenario);
+	return SaveLoad_Save(s_saveScenario3, sb, &g_scenario);
 }
 
 bool
-Scenario_Load4(FILE *fp, uint32 length)
+Scenario_Load4(SaveBuffer *sb, uint32 length)
 {
 	if (length != HOUSE_NEUTRAL)
 		return false;
 
 	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
 		char c;
-		fread(&c, sizeof(char), 1, fp);
+		if (!SaveBuffer_Read(sb, &c, sizeof(char)))
+			return false;
 
 		     if (c == ' ') g_skirmish.player_config[h].team = TEAM_NONE;
 		else if (c == '1') g_skirmish.player_config[h].team = TEAM_1;
@@ -147,13 +150,14 @@ Scenario_Load4(FILE *fp, uint32 length)
 }
 
 bool
-Scenario_Save4(FILE *fp)
+Scenario_Save4(SaveBuffer *sb)
 {
 	const char team_char[7] = { ' ', '1', '2', '3', '4', '5', '6' };
 
 	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
 		char c = team_char[g_skirmish.player_config[h].team];
-		fwrite(&c, sizeof(char), 1, fp);
+		if (!SaveBuffer_Write(sb, &c, sizeof(char)))
+			return false;
 	}
 
 	return true;
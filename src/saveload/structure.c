@@ -47,11 +47,11 @@ static const SaveLoadDesc s_saveBuildQueue[] = {
 
 /**
  * Load all Structures from a file.
- * @param fp The file to load from.
+ * @param sb The savegame buffer to load from.
  * @param length The length of the data chunk.
  * @return True if and only if all bytes were read successful.
  */
-bool Structure_Load(FILE *fp, uint32 length)
+bool Structure_Load(SaveBuffer *sb, uint32 length)
 {
 	while (length > 0) {
 		Structure *s;
@@ -60,7 +60,7 @@ bool Structure_Load(FILE *fp, uint32 length)
 		memset(&sl, 0, sizeof(sl));
 
 		/* Read the next Structure from disk */
-		if (!SaveLoad_Load(s_saveStructure, fp, &sl)) return false;
+		if (!SaveLoad_Load(s_saveStructure, sb, &sl)) return false;
 
 		length -= SaveLoad_GetLength(s_saveStructure);
 
@@ -90,10 +90,10 @@ bool Structure_Load(FILE *fp, uint32 length)
 
 /**
  * Save all Structures to a file. It converts pointers to indices where needed.
- * @param fp The file to save to.
+ * @param sb The savegame buffer to save to.
  * @return True if and only if all bytes were written successful.
  */
-bool Structure_Save(FILE *fp)
+bool Structure_Save(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
@@ -102,7 +102,7 @@ bool Structure_Save(FILE *fp)
 			s = Structure_FindNext(&find)) {
 		Structure ss = *s;
 
-		if (!SaveLoad_Save(s_saveStructure, fp, &ss)) return false;
+		if (!SaveLoad_Save(s_saveStructure, sb, &ss)) return false;
 	}
 
 	return true;
@@ -111,15 +111,15 @@ bool Structure_Save(FILE *fp)
 /*--------------------------------------------------------------*/
 
 bool
-Structure_Load2(FILE *fp, uint32 length)
+Structure_Load2(SaveBuffer *sb, uint32 length)
 {
 	while (length > 0) {
 		Structure sl;
-		if (!SaveLoad_Load(s_saveStructure2, fp, &sl))
+		if (!SaveLoad_Load(s_saveStructure2, sb, &sl))
 			return false;
 
 		SaveLoad_CustomCallbackData data;
-		data.fp = NULL;
+		data.sb = NULL;
 		data.object = &sl;
 
 		length -= SaveLoad_GetLength(s_saveStructure2);
@@ -163,14 +163,14 @@ Structure_Load2(FILE *fp, uint32 length)
 }
 
 bool
-Structure_Save2(FILE *fp)
+Structure_Save2(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
 	for (Structure *s = Structure_FindFirst(&find, HOUSE_INVALID, STRUCTURE_INVALID);
 			s != NULL;
 			s = Structure_FindNext(&find)) {
-		if (!SaveLoad_Save(s_saveStructure2, fp, s))
+		if (!SaveLoad_Save(s_saveStructure2, sb, s))
 			return false;
 	}
 
@@ -181,21 +181,21 @@ static uint32
 SaveLoad_Structure_BuildQueue(void *object, uint32 value, bool loading)
 {
 	SaveLoad_CustomCallbackData *data = object;
-	FILE *fp = data->fp;
+	SaveBuffer *sb = data->sb;
 	Structure *s = data->object;
 	uint32 size = 0;
 	uint32 elem_size = SaveLoad_GetLength(s_saveBuildQueue);
 	VARIABLE_NOT_USED(value);
 
-	/* If fp == NULL, then it is a size query. */
-	if (fp == NULL) {
+	/* If sb == NULL, then it is a size query. */
+	if (sb == NULL) {
 		uint32 count = BuildQueue_Count(&s->queue, 0xFFFF);
 
 		size = sizeof(count) + count * elem_size;
 	} else if (loading) {
 		uint32 count;
 
-		if (fread(&count, sizeof(uint32), 1, fp) != 1)
+		if (!SaveBuffer_Read(sb, &count, sizeof(uint32)))
 			return 0;
 
 		size += sizeof(count);
@@ -212,7 +212,7 @@ SaveLoad_Structure_BuildQueue(void *object, uint32 value, bool loading)
 		BuildQueue_Init(&s->queue);
 		while (count > 0) {
 			BuildQueueItem item;
-			if (!SaveLoad_Load(s_saveBuildQueue, fp, &item))
+			if (!SaveLoad_Load(s_saveBuildQueue, sb, &item))
 				return 0;
 
 			size += elem_size;
@@ -262,14 +262,14 @@ SaveLoad_Structure_BuildQueue(void *object, uint32 value, bool loading)
 
 		uint32 count = BuildQueue_Count(queue, 0xFFFF);
 
-		if (fwrite(&count, sizeof(uint32), 1, fp) != 1)
+		if (!SaveBuffer_Write(sb, &count, sizeof(uint32)))
 			return 0;
 
 		size += sizeof(count);
 
 		BuildQueueItem *item = queue->first;
 		while (item != NULL) {
-			if (!SaveLoad_Save(s_saveBuildQueue, fp, item))
+			if (!SaveLoad_Save(s_saveBuildQueue, sb, item))
 				return 0;
 
 			size += elem_size;
@@ -30,11 +30,11 @@ static const SaveLoadDesc s_saveTeam[] = {
 
 /**
  * Load all Teams from a file.
- * @param fp The file to load from.
+ * @param sb The savegame buffer to load from.
  * @param length The length of the data chunk.
  * @return True if and only if all bytes were read successful.
  */
-bool Team_Load(FILE *fp, uint32 length)
+bool Team_Load(SaveBuffer *sb, uint32 length)
 {
 	while (length > 0) {
 		Team *t;
@@ -43,7 +43,7 @@ bool Team_Load(FILE *fp, uint32 length)
 		memset(&tl, 0, sizeof(tl));
 
 		/* Read the next Structure from disk */
-		if (!SaveLoad_Load(s_saveTeam, fp, &tl)) return false;
+		if (!SaveLoad_Load(s_saveTeam, sb, &tl)) return false;
 
 		length -= SaveLoad_GetLength(s_saveTeam);
 
@@ -66,10 +66,10 @@ bool Team_Load(FILE *fp, uint32 length)
 
 /**
  * Save all Teams to a file. It converts pointers to indices where needed.
- * @param fp The file to save to.
+ * @param sb The savegame buffer to save to.
  * @return True if and only if all bytes were written successful.
  */
-bool Team_Save(FILE *fp)
+bool Team_Save(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
@@ -78,7 +78,7 @@ bool Team_Save(FILE *fp)
 			t = Team_FindNext(&find)) {
 		Team st = *t;
 
-		if (!SaveLoad_Save(s_saveTeam, fp, &st)) return false;
+		if (!SaveLoad_Save(s_saveTeam, sb, &st)) return false;
 	}
 
 	return true;
@@ -73,11 +73,11 @@ assert_compile(sizeof(enum SquadID) == sizeof(uint32));
 
 /**
  * Load all Units from a file.
- * @param fp The file to load from.
+ * @param sb The savegame buffer to load from.
  * @param length The length of the data chunk.
  * @return True if and only if all bytes were read successful.
  */
-bool Unit_Load(FILE *fp, uint32 length)
+bool Unit_Load(SaveBuffer *sb, uint32 length)
 {
 	while (length > 0) {
 		Unit *u;
@@ -86,7 +86,7 @@ bool Unit_Load(FILE *fp, uint32 length)
 		memset(&ul, 0, sizeof(ul));
 
 		/* Read the next Unit from disk */
-		if (!SaveLoad_Load(s_saveUnit, fp, &ul)) return false;
+		if (!SaveLoad_Load(s_saveUnit, sb, &ul)) return false;
 
 		length -= SaveLoad_GetLength(s_saveUnit);
 
@@ -131,10 +131,10 @@ bool Unit_Load(FILE *fp, uint32 length)
 
 /**
  * Save all Units to a file. It converts pointers to indices where needed.
- * @param fp The file to save to.
+ * @param sb The savegame buffer to save to.
  * @return True if and only if all bytes were written successful.
  */
-bool Unit_Save(FILE *fp)
+bool Unit_Save(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
@@ -146,7 +146,7 @@ bool Unit_Save(FILE *fp)
 		/* In original Dune II savegames, speed was shifted right by 4. */
 		su.speed >>= 4;
 
-		if (!SaveLoad_Save(s_saveUnit, fp, &su)) return false;
+		if (!SaveLoad_Save(s_saveUnit, sb, &su)) return false;
 	}
 
 	return true;
@@ -154,18 +154,18 @@ bool Unit_Save(FILE *fp)
 
 /**
  * Load all new information of Units from a file.
- * @param fp The file to load from.
+ * @param sb The savegame buffer to load from.
  * @param length The length of the data chunk.
  * @return True if and only if all bytes were read successful.
  */
-bool UnitNew_Load(FILE *fp, uint32 length)
+bool UnitNew_Load(SaveBuffer *sb, uint32 length)
 {
 	while (length > 0) {
 		Unit *u;
 		Object o;
 
 		/* Read the next index from disk */
-		if (!SaveLoad_Load(s_saveUnitNewIndex, fp, &o)) return false;
+		if (!SaveLoad_Load(s_saveUnitNewIndex, sb, &o)) return false;
 
 		length -= SaveLoad_GetLength(s_saveUnitNewIndex);
 
@@ -174,7 +174,7 @@ bool UnitNew_Load(FILE *fp, uint32 length)
 		if (u == NULL) return false;
 
 		/* Read the "new" information for this unit */
-		if (!SaveLoad_Load(s_saveUnitNew, fp, u)) return false;
+		if (!SaveLoad_Load(s_saveUnitNew, sb, u)) return false;
 
 		length -= SaveLoad_GetLength(s_saveUnitNew);
 	}
@@ -186,10 +186,10 @@ bool UnitNew_Load(FILE *fp, uint32 length)
 /**
  * Save all new Units information to a file. It converts pointers to indices
  *   where needed.
- * @param fp The file to save to.
+ * @param sb The savegame buffer to save to.
  * @return True if and only if all bytes were written successful.
  */
-bool UnitNew_Save(FILE *fp)
+bool UnitNew_Save(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
@@ -198,8 +198,8 @@ bool UnitNew_Save(FILE *fp)
 			u = Unit_FindNext(&find)) {
 		Unit su = *u;
 
-		if (!SaveLoad_Save(s_saveUnitNewIndex, fp, &su.o)) return false;
-		if (!SaveLoad_Save(s_saveUnitNew, fp, &su)) return false;
+		if (!SaveLoad_Save(s_saveUnitNewIndex, sb, &su.o)) return false;
+		if (!SaveLoad_Save(s_saveUnitNew, sb, &su)) return false;
 	}
 
 	return true;
@@ -226,11 +226,11 @@ SaveLoad_Unit_ExtraFlags(void *object, uint32 value, bool loading)
 }
 
 bool
-Unit_Load2(FILE *fp, uint32 length)
+Unit_Load2(SaveBuffer *sb, uint32 length)
 {
 	while (length > 0) {
 		Unit ul;
-		if (!SaveLoad_Load(s_saveUnit2, fp, &ul))
+		if (!SaveLoad_Load(s_saveUnit2, sb, &ul))
 			return false;
 
 		length -= SaveLoad_GetLength(s_saveUnit2);
@@ -253,14 +253,14 @@ Unit_Load2(FILE *fp, uint32 length)
 }
 
 bool
-Unit_Save2(FILE *fp)
+Unit_Save2(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
 	for (Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
 			u != NULL;
 			u = Unit_FindNext(&find)) {
-		if (!SaveLoad_Save(s_saveUnit2, fp, u))
+		if (!SaveLoad_Save(s_saveUnit2, sb, u))
 			return false;
 	}
 
@@ -1216,6 +1216,7 @@ Scenario_Create_Unit(enum HouseType houseType, enum UnitType unitType,
 	u->o.hitpoints   = hitpoints * g_table_unitInfo[unitType].o.hitpoints / 256;
 	u->o.position    = position;
 	u->orientation[0].current = orientation;
+	UnitPool_GridUpdate(u);
 	u->actionID     = actionType;
 	u->nextActionID = ACTION_INVALID;
 
@@ -1367,7 +1368,7 @@ static void Scenario_Load_Map(const char *key, char *settings)
 	if (g_mapSpriteID[packed] != t->groundSpriteID) g_mapSpriteID[packed] |= 0x8000;
 
 	if (isUnveiled) {
-		f->isUnveiled = (1 << g_playerHouseID);
+		Map_SetUnveiledToHouseOnly(g_playerHouseID, packed);
 		f->fogSpriteID = 0;
 	} else {
 		f->fogSpriteID = g_veiledSpriteID;
@@ -153,6 +153,7 @@ uint16 Script_Structure_RefineSpice(ScriptEngine *script)
 	h = House_Get_ByIndex(s->o.houseID);
 	h->credits += creditsStep;
 	u->amount -= harvesterStep;
+	UnitPool_MarkDirty(u);
 
 	if (u->amount == 0) u->o.flags.s.inTransport = false;
 	s->o.script.delay = 6;
@@ -335,6 +336,7 @@ uint16 Script_Structure_Unknown0C5A(ScriptEngine *script)
 		new_hitpoints = clamp(u->o.hitpoints, new_hitpoints, ui->o.hitpoints);
 
 		u->o.hitpoints = new_hitpoints;
+		UnitPool_MarkDirty(u);
 
 		s->countDown = 0;
 		return 1;
@@ -471,6 +473,7 @@ uint16 Script_Structure_RotateTurret(ScriptEngine *script)
 	rotation &= 0x7;
 
 	/* Set the new sprites */
+	Map_MarkDirty(Tile_PackTile(s->o.position));
 	tile->groundSpriteID = baseSpriteID + rotation;
 	s->rotationSpriteDiff = rotation;
 
@@ -22,6 +22,7 @@
 #include "../map.h"
 #include "../net/server.h"
 #include "../opendune.h"
+#include "../pathfinder.h"
 #include "../pool/pool.h"
 #include "../pool/pool_house.h"
 #include "../pool/pool_structure.h"
@@ -153,6 +154,7 @@ uint16 Script_Unit_TransportDeliver(ScriptEngine *script)
 			uint16 ret = 0;
 
 			if (s->state == STRUCTURE_STATE_BUSY) {
+				StructurePool_MarkDirty(s);
 				s->o.linkedID = u->o.linkedID;
 				u->o.linkedID = 0xFF;
 				u->o.flags.s.inTransport = false;
@@ -265,6 +267,8 @@ uint16 Script_Unit_Pickup(ScriptEngine *script)
 			u2 = Unit_Get_ByIndex(s->o.linkedID);
 
 			/* Pickup the unit */
+			StructurePool_MarkDirty(s);
+			UnitPool_MarkDirty(u2);
 			u->o.linkedID = u2->o.index & 0xFF;
 			s->o.linkedID = u2->o.linkedID;
 			u2->o.linkedID = 0xFF;
@@ -464,6 +468,7 @@ uint16 Script_Unit_MoveToTarget(ScriptEngine *script)
 
 		u->o.position.x += clamp((int16)(tile.x - u->o.position.x), -16, 16);
 		u->o.position.y += clamp((int16)(tile.y - u->o.position.y), -16, 16);
+		UnitPool_GridUpdate(u);
 
 		Unit_UpdateMap(2, u);
 
@@ -1357,6 +1362,7 @@ Script_Unit_Pathfinder_FindNearbyDestination(Unit *u, uint16 packedSrc, uint16 p
 	else if (dist_src_dest <= (256 * 3  )) end = 20;
 	else end = lengthof(offset);
 
+	const enum UnitMovementType mt = g_table_unitInfo[u->o.type].movementType;
 	const int x0 = Tile_GetPackedX(packedDst);
 	const int y0 = Tile_GetPackedY(packedDst);
 
@@ -1369,6 +1375,9 @@ Script_Unit_Pathfinder_FindNearbyDestination(Unit *u, uint16 packedSrc, uint16 p
 			continue;
 
 		uint16 this_dest = packedDst + (MAP_SIZE_MAX * offset[i].dy) + offset[i].dx;
+		if (enhancement_astar_pathfinder && !Pathfinder_IsReachable(mt, packedSrc, this_dest))
+			continue;
+
 		if (Unit_GetTileEnterScore(u, this_dest, 0) == 256)
 			continue;
 
@@ -1421,24 +1430,41 @@ uint16 Script_Unit_CalculateRoute(ScriptEngine *script)
 	}
 
 	if (u->route[0] == 0xFF) {
-		Pathfinder_Data res;
-		uint8 buffer[42];
+		if (enhancement_astar_pathfinder
+				&& u->o.type == UNIT_SANDWORM
+				&& !Pathfinder_IsReachable(MOVEMENT_SLITHER, packedSrc, packedDst)) {
+			/* Sandworms cannot leave the sand, so do not search. */
+		} else if (enhancement_astar_pathfinder) {
+			/* The A* pathfinder already leads to the closest reachable
+			 * tile, so it does not need the fallback below.  The unit
+			 * waits until its request has been answered.
+			 */
+			uint8 buffer[15];
+			const uint16 routeSize = Pathfinder_Queue_GetRoute(u, packedSrc, packedDst, buffer, lengthof(buffer));
 
-		res = Script_Unit_Pathfinder(packedSrc, packedDst, buffer, 40);
+			if (routeSize == 0) return 1;
 
-		/* Fallback case: the path finder fails if there are no empty
-		 * spaces on the direct path between packedSrc and packedDst.
-		 * This causes units to sit around, even if there are spots
-		 * closer to the target than its current position.
-		 */
-		if (g_dune2_enhanced && res.buffer[0] == 0xFF) {
-			uint16 altDst = Script_Unit_Pathfinder_FindNearbyDestination(u, packedSrc, packedDst);
+			memcpy(u->route, buffer, min(routeSize, 14));
+		} else {
+			Pathfinder_Data res;
+			uint8 buffer[42];
 
-			if (altDst != 0)
-				res = Script_Unit_Pathfinder(packedSrc, altDst, buffer, 40);
-		}
+			res = Script_Unit_Pathfinder(packedSrc, packedDst, buffer, 40);
 
-		memcpy(u->route, res.buffer, min(res.routeSize, 14));
+			/* Fallback case: the path finder fails if there are no empty
+			 * spaces on the direct path between packedSrc and packedDst.
+			 * This causes units to sit around, even if there are spots
+			 * closer to the target than its current position.
+			 */
+			if (g_dune2_enhanced && res.buffer[0] == 0xFF) {
+				uint16 altDst = Script_Unit_Pathfinder_FindNearbyDestination(u, packedSrc, packedDst);
+
+				if (altDst != 0)
+					res = Script_Unit_Pathfinder(packedSrc, altDst, buffer, 40);
+			}
+
+			memcpy(u->route, res.buffer, min(res.routeSize, 14));
+		}
 
 		if (u->route[0] == 0xFF) {
 			/* ENHANCEMENT -- Follow mode similar to Sega Mega Drive version of Dune II. */
@@ -1590,6 +1616,7 @@ uint16 Script_Unit_StartAnimation(ScriptEngine *script)
 	if (u->o.script.variables[1] == 1) animationUnitID += 2;
 
 	g_map[position].houseID = Unit_GetHouseID(u);
+	Map_MarkDirty(position);
 
 	assert(animationUnitID < 4);
 	if (g_table_unitInfo[u->o.type].displayMode == DISPLAYMODE_INFANTRY_3_FRAMES) {
@@ -1806,9 +1833,11 @@ uint16 Script_Unit_IsValidDestination(ScriptEngine *script)
 			if (u->o.linkedID == 0xFF) return 1;
 			u2 = Unit_Get_ByIndex(u->o.linkedID);
 			u2->o.position = Tools_Index_GetTile(encoded);
+			UnitPool_GridUpdate(u2);
 			if (!Unit_IsTileOccupied(u2)) return 0;
 			u2->o.position.x = 0xFFFF;
 			u2->o.position.y = 0xFFFF;
+			UnitPool_GridUpdate(u2);
 			return 1;
 
 		case IT_STRUCTURE: {
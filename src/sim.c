@@ -0,0 +1,384 @@
+/** @file src/sim.c Headless simulation benchmark.
+ *
+ * dunedynasty-sim loads a campaign scenario or a skirmish seed and runs
+ * GameLoop_Server_Logic for a fixed number of ticks as fast as possible.
+ * No display or audio device is created, and the game timers are
+ * driven by timer_sim.c, so a given scenario and seed always simulates
+ * the same ticks.  At the end it reports the throughput in ticks per
+ * second and the per-tick latency percentiles.
+ *
+ * With -r, it instead plays back a replay recorded by the game,
+ * executing the player's commands at the ticks they were recorded.
+ */
+
+#include <allegro5/allegro.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "errorlog.h"
+#include "os/common.h"
+#include "os/math.h"
+
+#include "ai.h"
+#include "common_a5.h"
+#include "crashlog/crashlog.h"
+#include "file.h"
+#include "gameloop.h"
+#include "gfx.h"
+#include "house.h"
+#include "mods/skirmish.h"
+#include "opendune.h"
+#include "pool/pool.h"
+#include "pool/pool_house.h"
+#include "pool/pool_structure.h"
+#include "pool/pool_team.h"
+#include "pool/pool_unit.h"
+#include "profile.h"
+#include "replay.h"
+#include "scenario.h"
+#include "script/script.h"
+#include "sprites.h"
+#include "string.h"
+#include "structure.h"
+#include "timer/timer.h"
+#include "timer/timer_a5.h"
+#include "timer/timer_sim.h"
+#include "tools/random_lcg.h"
+#include "tools/random_xorshift.h"
+#include "unit.h"
+#include "worldhash.h"
+
+typedef struct SimOptions {
+	long ticks;
+	uint32 seed;
+	int scenarioID;
+	enum HouseType houseID;
+	int ai_count;
+	const char *csv;
+	const char *replay;
+} SimOptions;
+
+static void
+Sim_Usage(const char *argv0)
+{
+	fprintf(stderr,
+			"Usage: %s [options]\n"
+			"  -n <ticks>     number of game ticks to simulate (default 10000,\n"
+			"                 or the length of the replay)\n"
+			"  -s <seed>      skirmish map seed (default 0)\n"
+			"  -m <scenario>  play campaign scenario 1-22 instead of a skirmish\n"
+			"  -p <house>     player house 0-5 (default 1, Atreides)\n"
+			"  -a <count>     number of CPU opponents in skirmish 1-5 (default 3)\n"
+			"  -c <file>      write per-phase tick times to a CSV file\n"
+			"  -r <file>      play back a replay instead of -s, -m, -p and -a\n",
+			argv0);
+}
+
+static bool
+Sim_ParseOptions(int argc, char **argv, SimOptions *opt)
+{
+	opt->ticks = 0;
+	opt->seed = 0;
+	opt->scenarioID = 0;
+	opt->houseID = HOUSE_ATREIDES;
+	opt->ai_count = 3;
+	opt->csv = NULL;
+	opt->replay = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+		if (arg[0] != '-' || arg[1] == '\0' || arg[2] != '\0' || val == NULL)
+			return false;
+
+		switch (arg[1]) {
+			case 'n': opt->ticks = strtol(val, NULL, 10); break;
+			case 's': opt->seed = strtoul(val, NULL, 10); break;
+			case 'm': opt->scenarioID = atoi(val); break;
+			case 'p': opt->houseID = atoi(val); break;
+			case 'a': opt->ai_count = atoi(val); break;
+			case 'c': opt->csv = val; break;
+			case 'r': opt->replay = val; break;
+			default:
+				return false;
+		}
+
+		i++;
+	}
+
+	return (opt->ticks >= 0)
+		&& (0 <= opt->scenarioID && opt->scenarioID <= 22)
+		&& (HOUSE_HARKONNEN <= opt->houseID && opt->houseID < HOUSE_NEUTRAL)
+		&& (1 <= opt->ai_count && opt->ai_count < HOUSE_NEUTRAL);
+}
+
+static bool
+Sim_Init(const SimOptions *opt)
+{
+	if (!A5_InitSystem())
+		return false;
+
+	ErrorLog_Init(g_personal_data_dir);
+
+	memcpy(g_table_houseInfo, g_table_houseInfo_original, sizeof(g_table_houseInfo_original));
+	memcpy(g_table_structureInfo, g_table_structureInfo_original, sizeof(g_table_structureInfo_original));
+	memcpy(g_table_unitInfo, g_table_unitInfo_original, sizeof(g_table_unitInfo_original));
+
+	GFX_Init();
+	TimerA5_Init();
+
+	srand(opt->seed);
+	Tools_RandomLCG_Seed(opt->seed);
+	Random_Xorshift_Seed(opt->seed, 1, 2, 3);
+
+	String_Init();
+	Game_CreateCampaigns();
+	Sprites_LoadTiles();
+
+	g_readBufferSize = 0x6D60;
+	g_readBuffer = calloc(1, g_readBufferSize);
+
+	Script_LoadFromFile("TEAM.EMC", g_scriptTeam, g_scriptFunctionsTeam, NULL);
+	Script_LoadFromFile("BUILD.EMC", g_scriptStructure, g_scriptFunctionsStructure, NULL);
+
+	Unit_Init();
+	UnitAI_ClearSquads();
+	Team_Init();
+	House_Init();
+	Structure_Init();
+
+	return true;
+}
+
+static bool
+Sim_StartSkirmish(const SimOptions *opt)
+{
+	g_campaign_selected = CAMPAIGNID_SKIRMISH;
+	g_campaignID = 7;
+	g_scenarioID = 20;
+
+	Skirmish_Initialise();
+	g_skirmish.seed = opt->seed;
+	g_skirmish.player_config[opt->houseID].brain = BRAIN_HUMAN;
+
+	int ai_count = 0;
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL && ai_count < opt->ai_count; h++) {
+		if (h == opt->houseID)
+			continue;
+
+		g_skirmish.player_config[h].brain = BRAIN_CPU;
+		ai_count++;
+	}
+
+	Campaign_Load();
+	Skirmish_Prepare();
+
+	if (!Skirmish_GenerateMap1(true)) {
+		fprintf(stderr, "Seed %u does not produce a playable map\n", opt->seed);
+		return false;
+	}
+
+	Game_Prepare();
+	return true;
+}
+
+/**
+ * Starts the skirmish recorded in the replay, whose settings
+ *  Replay_Playback_Load has already applied.
+ */
+static bool
+Sim_StartSkirmishReplay(void)
+{
+	Campaign_Load();
+	Skirmish_Prepare();
+
+	if (!Skirmish_GenerateMap1(true)) {
+		fprintf(stderr, "Seed %u does not produce a playable map\n", g_skirmish.seed);
+		return false;
+	}
+
+	Game_Prepare();
+	return true;
+}
+
+static bool
+Sim_StartScenario(const SimOptions *opt)
+{
+	if (opt->replay == NULL) {
+		g_campaign_selected = CAMPAIGNID_DUNE_II;
+		g_campaignID = (opt->scenarioID + 1) / 3;
+		g_scenarioID = opt->scenarioID;
+		g_playerHouseID = opt->houseID;
+	}
+
+	Campaign_Load();
+	Game_Init();
+
+	g_validateStrictIfZero++;
+	const bool loaded = Scenario_Load(opt->scenarioID, opt->houseID);
+	if (loaded)
+		Game_Prepare();
+	g_validateStrictIfZero--;
+
+	if (!loaded)
+		fprintf(stderr, "Could not load scenario %d\n", opt->scenarioID);
+
+	return loaded;
+}
+
+static int
+Sim_CompareDouble(const void *a, const void *b)
+{
+	const double x = *(const double *)a;
+	const double y = *(const double *)b;
+
+	return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static double
+Sim_Percentile(const double *sorted, long count, int percent)
+{
+	long i = (count * percent + 99) / 100 - 1;
+
+	return sorted[clamp(0, i, count - 1)];
+}
+
+static void
+Sim_Report(const SimOptions *opt, double *latency, double elapsed)
+{
+	PoolFindStruct find;
+	int units = 0;
+	int structures = 0;
+
+	for (const Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
+			u != NULL;
+			u = Unit_FindNext(&find)) {
+		units++;
+	}
+
+	for (const Structure *s = Structure_FindFirst(&find, HOUSE_INVALID, STRUCTURE_INVALID);
+			s != NULL;
+			s = Structure_FindNext(&find)) {
+		structures++;
+	}
+
+	printf("ticks:      %ld\n", opt->ticks);
+	printf("elapsed:    %.3f s\n", elapsed);
+
+	/* A replay can end before the first tick. */
+	if (opt->ticks > 0) {
+		qsort(latency, opt->ticks, sizeof(latency[0]), Sim_CompareDouble);
+
+		if (elapsed > 0.0)
+			printf("ticks/sec:  %.1f\n", opt->ticks / elapsed);
+
+		printf("latency:    p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+				1000.0 * Sim_Percentile(latency, opt->ticks, 50),
+				1000.0 * Sim_Percentile(latency, opt->ticks, 90),
+				1000.0 * Sim_Percentile(latency, opt->ticks, 99),
+				1000.0 * latency[opt->ticks - 1]);
+	}
+
+	printf("objects:    %d units, %d structures\n", units, structures);
+	printf("hash:       %08X\n", WorldHash_Compute());
+}
+
+int main(int argc, char **argv)
+{
+	SimOptions opt;
+
+	if (!Sim_ParseOptions(argc, argv, &opt)) {
+		Sim_Usage(argv[0]);
+		return 1;
+	}
+
+	CrashLog_Init();
+	FileHash_Init();
+
+	/* The replay sets the enhancements, which must be known before
+	 * the pools are initialised.
+	 */
+	if (opt.replay != NULL) {
+		if (!Replay_Playback_Load(opt.replay)) {
+			fprintf(stderr, "Could not load replay %s\n", opt.replay);
+			return 1;
+		}
+
+		opt.scenarioID = g_scenarioID;
+		opt.houseID = g_playerHouseID;
+
+		const long length = Replay_Playback_GetLength();
+		if (opt.ticks == 0 || opt.ticks > length)
+			opt.ticks = length;
+
+		if (opt.ticks == 0) {
+			fprintf(stderr, "Replay %s is empty\n", opt.replay);
+			return 1;
+		}
+	} else if (opt.ticks == 0) {
+		opt.ticks = 10000;
+	}
+
+	if (!Sim_Init(&opt))
+		return 1;
+
+	bool started;
+	if (opt.replay != NULL) {
+		started
+			= (g_campaign_selected == CAMPAIGNID_SKIRMISH)
+			? Sim_StartSkirmishReplay() : Sim_StartScenario(&opt);
+	} else {
+		started
+			= (opt.scenarioID == 0)
+			? Sim_StartSkirmish(&opt) : Sim_StartScenario(&opt);
+	}
+
+	if (!started)
+		return 1;
+
+	double *latency = malloc(opt.ticks * sizeof(latency[0]));
+	assert(latency != NULL);
+
+	g_gameMode = GM_NORMAL;
+	g_gameOverlay = GAMEOVERLAY_NONE;
+	g_inGame = true;
+
+	Timer_SetTimer(TIMER_GUI, true);
+	Timer_SetTimer(TIMER_GAME, true);
+	g_tickScenarioStart = g_timerGame;
+
+	if (opt.csv != NULL && !Profile_OpenCSV(opt.csv)) {
+		fprintf(stderr, "Could not open %s\n", opt.csv);
+		return 1;
+	}
+
+	if (opt.replay != NULL)
+		Replay_Playback_Start();
+
+	const double start = al_get_time();
+
+	for (long tick = 0; tick < opt.ticks; tick++) {
+		const double t0 = al_get_time();
+
+		TimerSim_Advance();
+		if (opt.replay == NULL) {
+			g_timerGame = Timer_GameTicks();
+		} else if (!Replay_Playback_Step()) {
+			opt.ticks = tick;
+			break;
+		}
+
+		GameLoop_Server_Logic();
+
+		latency[tick] = al_get_time() - t0;
+	}
+
+	Sim_Report(&opt, latency, al_get_time() - start);
+	Profile_CloseCSV();
+	Replay_Playback_Free();
+
+	free(latency);
+	return 0;
+}
@@ -0,0 +1,215 @@
+/**
+ * @file src/snapshot.c
+ *
+ * In-memory copies of the whole simulation state: the map, fog of war,
+ * the unit, structure, house and team pools (including their scripts
+ * and build queues), explosions, animations, Brutal AI squads and the
+ * random number generators.  Everything except the build queues and
+ * the heaps is copied as flat blocks, so saving and loading costs a
+ * few memcpys instead of a pass through SaveFile and LoadFile.
+ *
+ * Times are restored relative to the current game tick, as savegames
+ * do.  Callers that rewind the clock, such as a rollback, should set
+ * g_timerGame back to the snapshot's tick before loading it.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "os/common.h"
+
+#include "snapshot.h"
+
+#include "ai.h"
+#include "animation.h"
+#include "binheap.h"
+#include "explosion.h"
+#include "map.h"
+#include "pathfinder.h"
+#include "pool/pool_house.h"
+#include "pool/pool_structure.h"
+#include "pool/pool_team.h"
+#include "pool/pool_unit.h"
+#include "scenario.h"
+#include "timer/timer.h"
+#include "tools/random_general.h"
+#include "tools/random_lcg.h"
+#include "tools/random_starport.h"
+#include "unit.h"
+
+typedef struct WorldSnapshot {
+	Tile map[MAP_SIZE_MAX * MAP_SIZE_MAX];
+	uint16 mapSpriteID[MAP_SIZE_MAX * MAP_SIZE_MAX];
+	FogOfWarTile mapVisible[MAP_SIZE_MAX * MAP_SIZE_MAX];
+	FogOfWarHouse mapFog[HOUSE_MAX];
+
+	struct HousePool *house_pool;
+	struct StructurePool *structure_pool;
+	struct TeamPool *team_pool;
+	struct UnitPool *unit_pool;
+	struct AISquadPool *squad_pool;
+	BinHeap explosions;
+	BinHeap animations;
+
+	Scenario scenario;
+	int16 starportAvailable[UNIT_MAX];
+
+	int64_t timerGame;                  /*!< g_timerGame when taken. */
+	int64_t timerGUI;                   /*!< Timer_GetTicks() when taken, for explosions and animations. */
+	int64_t tickScenario;               /*!< Ticks since the start of the scenario. */
+
+	uint32 randomGeneral;
+	uint32 randomLCG;
+	uint16 starportInitialSeed;
+	uint32 starportState;
+} WorldSnapshot;
+
+assert_compile(sizeof(((WorldSnapshot *)NULL)->map) == sizeof(g_map));
+assert_compile(sizeof(((WorldSnapshot *)NULL)->mapSpriteID) == sizeof(g_mapSpriteID));
+assert_compile(sizeof(((WorldSnapshot *)NULL)->mapVisible) == sizeof(g_mapVisible));
+assert_compile(sizeof(((WorldSnapshot *)NULL)->mapFog) == sizeof(g_mapFog));
+assert_compile(sizeof(((WorldSnapshot *)NULL)->starportAvailable) == sizeof(g_starportAvailable));
+
+static WorldSnapshot *s_quicksave;
+
+/*--------------------------------------------------------------*/
+
+WorldSnapshot *
+WorldSnapshot_Alloc(void)
+{
+	WorldSnapshot *snapshot = calloc(1, sizeof(*snapshot));
+	assert(snapshot != NULL);
+
+	snapshot->house_pool = HousePool_Alloc();
+	snapshot->structure_pool = StructurePool_Alloc();
+	snapshot->team_pool = TeamPool_Alloc();
+	snapshot->unit_pool = UnitPool_Alloc();
+	snapshot->squad_pool = AISquadPool_Alloc();
+
+	return snapshot;
+}
+
+void
+WorldSnapshot_Free(WorldSnapshot *snapshot)
+{
+	if (snapshot == NULL)
+		return;
+
+	HousePool_Free(snapshot->house_pool);
+	StructurePool_Free(snapshot->structure_pool);
+	TeamPool_Free(snapshot->team_pool);
+	UnitPool_Free(snapshot->unit_pool);
+	AISquadPool_Free(snapshot->squad_pool);
+	BinHeap_Free(&snapshot->explosions);
+	BinHeap_Free(&snapshot->animations);
+
+	free(snapshot);
+}
+
+/**
+ * Copy the current world into the snapshot, replacing its contents.
+ */
+void
+WorldSnapshot_Save(WorldSnapshot *snapshot)
+{
+	memcpy(snapshot->map, g_map, sizeof(g_map));
+	memcpy(snapshot->mapSpriteID, g_mapSpriteID, sizeof(g_mapSpriteID));
+	memcpy(snapshot->mapVisible, g_mapVisible, sizeof(g_mapVisible));
+	memcpy(snapshot->mapFog, g_mapFog, sizeof(g_mapFog));
+
+	HousePool_SaveTo(snapshot->house_pool);
+	StructurePool_SaveTo(snapshot->structure_pool);
+	TeamPool_SaveTo(snapshot->team_pool);
+	UnitPool_SaveTo(snapshot->unit_pool);
+	AISquadPool_SaveTo(snapshot->squad_pool);
+	Explosion_SaveTo(&snapshot->explosions);
+	Animation_SaveTo(&snapshot->animations);
+
+	snapshot->scenario = g_scenario;
+	memcpy(snapshot->starportAvailable, g_starportAvailable, sizeof(g_starportAvailable));
+
+	snapshot->timerGame = g_timerGame;
+	snapshot->timerGUI = Timer_GetTicks();
+	snapshot->tickScenario = g_timerGame - g_tickScenarioStart;
+
+	snapshot->randomGeneral = Tools_Random_GetState();
+	snapshot->randomLCG = Tools_RandomLCG_GetState();
+	snapshot->starportInitialSeed = Random_Starport_GetInitialSeed();
+	snapshot->starportState = Random_Starport_GetState();
+}
+
+/**
+ * Replace the current world with the snapshot, which is left intact
+ *  and may be loaded again.
+ */
+void
+WorldSnapshot_Load(const WorldSnapshot *snapshot)
+{
+	const int64_t dt = g_timerGame - snapshot->timerGame;
+	const int64_t dtGUI = Timer_GetTicks() - snapshot->timerGUI;
+
+	memcpy(g_map, snapshot->map, sizeof(g_map));
+	memcpy(g_mapSpriteID, snapshot->mapSpriteID, sizeof(g_mapSpriteID));
+	memcpy(g_mapVisible, snapshot->mapVisible, sizeof(g_mapVisible));
+	memcpy(g_mapFog, snapshot->mapFog, sizeof(g_mapFog));
+
+	if (dt != 0) {
+		for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_MAX; h++) {
+			for (uint16 packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++) {
+				if (g_mapFog[h].timeout[packed] != 0)
+					g_mapFog[h].timeout[packed] += dt;
+			}
+		}
+	}
+
+	HousePool_LoadFrom(snapshot->house_pool);
+	StructurePool_LoadFrom(snapshot->structure_pool);
+	TeamPool_LoadFrom(snapshot->team_pool);
+	UnitPool_LoadFrom(snapshot->unit_pool);
+	AISquadPool_LoadFrom(snapshot->squad_pool, dt);
+	Explosion_LoadFrom(&snapshot->explosions, dtGUI);
+	Animation_LoadFrom(&snapshot->animations, dtGUI);
+
+	g_scenario = snapshot->scenario;
+	memcpy(g_starportAvailable, snapshot->starportAvailable, sizeof(g_starportAvailable));
+	g_tickScenarioStart = g_timerGame - snapshot->tickScenario;
+
+	Tools_Random_Seed(snapshot->randomGeneral);
+	Tools_RandomLCG_SetState(snapshot->randomLCG);
+	Random_Starport_SetState(snapshot->starportInitialSeed, snapshot->starportState);
+
+	Pathfinder_InvalidateAll();
+	Unit_ResetVision();
+	Map_Journal_Invalidate();
+}
+
+/*--------------------------------------------------------------*/
+
+void
+WorldSnapshot_QuickSave(void)
+{
+	if (s_quicksave == NULL)
+		s_quicksave = WorldSnapshot_Alloc();
+
+	WorldSnapshot_Save(s_quicksave);
+}
+
+bool
+WorldSnapshot_QuickLoad(void)
+{
+	if (s_quicksave == NULL)
+		return false;
+
+	WorldSnapshot_Load(s_quicksave);
+	return true;
+}
+
+/**
+ * Forget the quicksave, which belongs to the game being left.
+ */
+void
+WorldSnapshot_QuickDiscard(void)
+{
+	WorldSnapshot_Free(s_quicksave);
+	s_quicksave = NULL;
+}
@@ -0,0 +1,17 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+
+struct WorldSnapshot;
+
+extern struct WorldSnapshot *WorldSnapshot_Alloc(void);
+extern void WorldSnapshot_Free(struct WorldSnapshot *snapshot);
+extern void WorldSnapshot_Save(struct WorldSnapshot *snapshot);
+extern void WorldSnapshot_Load(const struct WorldSnapshot *snapshot);
+
+extern void WorldSnapshot_QuickSave(void);
+extern bool WorldSnapshot_QuickLoad(void);
+extern void WorldSnapshot_QuickDiscard(void);
+
+#endif
@@ -19,6 +19,7 @@
 #include "gui/gui.h"
 #include "house.h"
 #include "ini.h"
+#include "map.h"
 #include "scenario.h"
 #include "script/script.h"
 #include "string.h"
@@ -231,6 +232,7 @@ void Sprites_LoadTiles(void)
 	g_builtSlabSpriteID = g_iconMap[g_iconMap[ICM_ICONGROUP_CONCRETE_SLAB] + 2];
 	g_landscapeSpriteID = g_iconMap[g_iconMap[ICM_ICONGROUP_LANDSCAPE]];
 	g_wallSpriteID      = g_iconMap[g_iconMap[ICM_ICONGROUP_WALLS]];
+	Map_InitLandscapeTypes();
 
 	Script_LoadFromFile("UNIT.EMC", g_scriptUnit, g_scriptFunctionsUnit, GFX_Screen_Get_ByIndex(SCREEN_2));
 }
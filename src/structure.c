@@ -25,6 +25,7 @@
 #include "newui/actionpanel.h"
 #include "newui/menubar.h"
 #include "opendune.h"
+#include "pathfinder.h"
 #include "pool/pool.h"
 #include "pool/pool_house.h"
 #include "pool/pool_structure.h"
@@ -107,6 +108,8 @@ void GameLoop_Structure(void)
 			Structure_RemoveFog(UNVEILCAUSE_STRUCTURE_VISION, s);
 
 		if (tickPalace && s->o.type == STRUCTURE_PALACE) {
+			StructurePool_MarkDirty(s);
+
 			if (s->countDown != 0) {
 				s->countDown--;
 			}
@@ -122,6 +125,8 @@ void GameLoop_Structure(void)
 		}
 
 		if (tickStructure) {
+			StructurePool_MarkDirty(s);
+
 			if (s->o.flags.s.upgrading) {
 				uint16 upgradeCost = si->o.buildCredits / 40;
 
@@ -427,6 +432,8 @@ void GameLoop_Structure(void)
 						if (!Script_Run(&s->o.script)) break;
 					}
 
+					StructurePool_MarkDirty(s);
+
 					/* ENHANCEMENT -- Dune2 aborts all other structures if one gives a script error. This doesn't seem correct */
 					if (!g_dune2_enhanced && i != 3) return;
 				} else {
@@ -528,6 +535,8 @@ bool Structure_Place(Structure *s, uint16 position, enum HouseType houseID)
 
 	if (position == 0xFFFF) return false;
 
+	StructurePool_MarkDirty(s);
+
 	si = &g_table_structureInfo[s->o.type];
 
 	/* ENHANCEMENT -- If the construction yard was captured, we need to reset the house.
@@ -556,6 +565,7 @@ bool Structure_Place(Structure *s, uint16 position, enum HouseType houseID)
 				return false;
 
 			t = &g_map[position];
+			Map_MarkDirty(position);
 			t->groundSpriteID = g_wallSpriteID + 1;
 			t->overlaySpriteID = 0;
 			/* ENHANCEMENT -- Dune2 wrongfully only removes the lower 2 bits, where the lower 3 bits are the owner. This is no longer visible. */
@@ -568,6 +578,7 @@ bool Structure_Place(Structure *s, uint16 position, enum HouseType houseID)
 
 			Structure_ConnectWall(position, true);
 			Structure_Free(s);
+			Pathfinder_InvalidateTile(position);
 
 		} return true;
 
@@ -584,6 +595,7 @@ bool Structure_Place(Structure *s, uint16 position, enum HouseType houseID)
 				if (Structure_IsValidBuildLocation(houseID, curPos, STRUCTURE_SLAB_1x1) == 0)
 					continue;
 
+				Map_MarkDirty(curPos);
 				t->groundSpriteID = g_builtSlabSpriteID;
 				t->overlaySpriteID = 0;
 				t->houseID = s->o.houseID;
@@ -605,6 +617,7 @@ bool Structure_Place(Structure *s, uint16 position, enum HouseType houseID)
 					if (Structure_IsValidBuildLocation(houseID, curPos, STRUCTURE_SLAB_1x1) == 0)
 						continue;
 
+					Map_MarkDirty(curPos);
 					t->groundSpriteID = g_builtSlabSpriteID;
 					t->overlaySpriteID = 0;
 					t->houseID = s->o.houseID;
@@ -698,6 +711,7 @@ bool Structure_Place(Structure *s, uint16 position, enum HouseType houseID)
 			u = Unit_Get_ByPackedTile(curPos);
 
 			Unit_Remove(u);
+			Pathfinder_InvalidateTile(curPos);
 
 			/* ENHANCEMENT -- In Dune2, it only removes the fog around the top-left tile of a structure, leaving for big structures the right in the fog. */
 			if (g_dune2_enhanced) {
@@ -981,6 +995,8 @@ Structure_Server_ActivateSpecial(Structure *s)
 	House *h = House_Get_ByIndex(s->o.houseID);
 	const HouseInfo *hi = &g_table_houseInfo[s->o.houseID];
 
+	StructurePool_MarkDirty(s);
+
 	switch (hi->specialWeapon) {
 		case HOUSE_WEAPON_MISSILE: {
 			Unit *u;
@@ -1145,6 +1161,7 @@ static void Structure_Destroy(Structure *s)
 
 	House *h = House_Get_ByIndex(s->o.houseID);
 
+	StructurePool_MarkDirty(s);
 	s->o.script.variables[0] = 1;
 	s->o.flags.s.allocated = false;
 	s->o.flags.s.repairing = false;
@@ -1237,6 +1254,8 @@ bool Structure_Damage(Structure *s, uint16 damage, uint16 range)
 	if (damage == 0) return false;
 	if (s->o.script.variables[0] == 1) return false;
 
+	StructurePool_MarkDirty(s);
+
 	si = &g_table_structureInfo[s->o.type];
 
 	if (s->o.hitpoints >= damage) {
@@ -1446,6 +1465,7 @@ bool Structure_ConnectWall(uint16 position, bool recurse)
 	tile = &g_map[position];
 	if (tile->groundSpriteID == spriteID) return false;
 
+	Map_MarkDirty(position);
 	tile->groundSpriteID = spriteID;
 	g_mapSpriteID[position] |= 0x8000;
 
@@ -1570,7 +1590,9 @@ void Structure_Remove(Structure *s)
 		Animation_Stop_ByTile(curPacked);
 
 		t = &g_map[curPacked];
+		Map_MarkDirty(curPacked);
 		t->hasStructure = false;
+		Pathfinder_InvalidateTile(curPacked);
 
 		if (g_debugScenario) {
 			t->groundSpriteID = g_mapSpriteID[curPacked] & 0x1FF;
@@ -1656,6 +1678,8 @@ void Structure_Server_CancelBuild(Structure *s)
 
 	if (s == NULL || s->o.linkedID == 0xFF) return;
 
+	StructurePool_MarkDirty(s);
+
 	if (s->o.type == STRUCTURE_CONSTRUCTION_YARD) {
 		Structure *s2 = Structure_Get_ByIndex(s->o.linkedID);
 		oi = &g_table_structureInfo[s2->o.type].o;
@@ -1696,6 +1720,8 @@ bool Structure_Server_BuildObject(Structure *s, uint16 objectType)
 
 	if (!si->o.flags.factory) return false;
 
+	StructurePool_MarkDirty(s);
+
 	Structure_Server_SetRepairingState(s, 0);
 
 	if (objectType == 0xFFFD) {
@@ -1801,6 +1827,8 @@ Structure_Server_SetUpgradingState(Structure *s, int state)
 {
 	bool ret = false;
 
+	StructurePool_MarkDirty(s);
+
 	if (state == -1) state = s->o.flags.s.upgrading ? 0 : 1;
 
 	if (state == 0 && s->o.flags.s.upgrading) {
@@ -1846,6 +1874,8 @@ Structure_Server_SetRepairingState(Structure *s, int state)
 
 	if (!s->o.flags.s.allocated) state = 0;
 
+	StructurePool_MarkDirty(s);
+
 	if (state == -1) state = s->o.flags.s.repairing ? 0 : 1;
 
 	if (state == 0 && s->o.flags.s.repairing) {
@@ -1885,6 +1915,8 @@ void Structure_UpdateMap(Structure *s)
 	if (!s->o.flags.s.used) return;
 	if (s->o.flags.s.isNotOnMap) return;
 
+	StructurePool_MarkDirty(s);
+
 	si = &g_table_structureInfo[s->o.type];
 
 	layout = g_table_structure_layoutTiles[si->layout];
@@ -1899,6 +1931,7 @@ void Structure_UpdateMap(Structure *s)
 		position = Tile_PackTile(s->o.position) + layout[i];
 
 		t = &g_map[position];
+		Map_MarkDirty(position);
 		t->houseID = s->o.houseID;
 		t->hasStructure = true;
 		t->index = s->o.index + 1;
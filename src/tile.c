@@ -6,6 +6,51 @@
 #include "map.h"
 #include "tools/coord.h"
 
+enum {
+	TILE_STENCIL_RADIUS_MAX = 15,
+	TILE_STENCIL_SIZE_MAX = (2 * TILE_STENCIL_RADIUS_MAX + 1) * (2 * TILE_STENCIL_RADIUS_MAX + 1)
+};
+
+/**
+ * The offsets of the tiles within a radius, in the order the square
+ *  around the centre used to be scanned.
+ */
+typedef struct TileStencil {
+	uint16 count;                                           /*!< Number of tiles, or 0 if not built yet. */
+	int8 dx[TILE_STENCIL_SIZE_MAX];                         /*!< Horizontal offset of each tile. */
+	int8 dy[TILE_STENCIL_SIZE_MAX];                         /*!< Vertical offset of each tile. */
+} TileStencil;
+
+static TileStencil s_stencil[TILE_STENCIL_RADIUS_MAX + 1];
+
+static const TileStencil *
+Tile_GetStencil(uint16 radius)
+{
+	TileStencil *st = &s_stencil[radius];
+
+	if (st->count != 0)
+		return st;
+
+	/* Distances only depend on the offsets, so measure them from a
+	 * tile in the middle of the map.
+	 */
+	const tile32 centre = Tile_MakeXY(MAP_SIZE_MAX / 2, MAP_SIZE_MAX / 2);
+
+	for (int i = -radius; i <= radius; i++) {
+		for (int j = -radius; j <= radius; j++) {
+			const tile32 t = Tile_MakeXY(MAP_SIZE_MAX / 2 + i, MAP_SIZE_MAX / 2 + j);
+			if (Tile_GetDistanceRoundedUp(centre, t) > radius)
+				continue;
+
+			st->dx[st->count] = i;
+			st->dy[st->count] = j;
+			st->count++;
+		}
+	}
+
+	return st;
+}
+
 static void
 Map_UnveilTileForHouses(enum HouseFlag houses, enum TileUnveilCause cause,
 		uint16 packed, bool unveil)
@@ -39,6 +84,24 @@ Tile_RefreshFogInRadius(enum HouseFlag houses, enum TileUnveilCause cause,
 
 	const int x = Tile_GetPackedX(packed);
 	const int y = Tile_GetPackedY(packed);
+
+	if (radius <= TILE_STENCIL_RADIUS_MAX) {
+		const TileStencil *st = Tile_GetStencil(radius);
+
+		for (int k = 0; k < st->count; k++) {
+			if (!(0 <= (x + st->dx[k]) && (x + st->dx[k]) < MAP_SIZE_MAX))
+				continue;
+
+			if (!(0 <= (y + st->dy[k]) && (y + st->dy[k]) < MAP_SIZE_MAX))
+				continue;
+
+			packed = Tile_PackXY(x + st->dx[k], y + st->dy[k]);
+			Map_UnveilTileForHouses(houses, cause, packed, unveil);
+		}
+
+		return;
+	}
+
 	tile = Tile_MakeXY(x, y);
 
 	for (int i = -radius; i <= radius; i++) {
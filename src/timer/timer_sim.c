@@ -0,0 +1,97 @@
+/* timer_sim.c
+ *
+ * Timer backend for the headless simulator.  Instead of Allegro timers
+ * firing in real time, the timers only advance when the simulator
+ * calls TimerSim_Advance, so every run of the same scenario and seed
+ * produces the same sequence of ticks.
+ */
+
+#include <assert.h>
+#include "types.h"
+
+#include "timer_a5.h"
+#include "timer_sim.h"
+
+static int64_t s_timer_count[2];
+static bool s_timer_started[2];
+
+bool
+TimerA5_Init(void)
+{
+	s_timer_count[TIMER_GUI] = 0;
+	s_timer_count[TIMER_GAME] = 0;
+	s_timer_started[TIMER_GUI] = false;
+	s_timer_started[TIMER_GAME] = false;
+	return true;
+}
+
+void
+TimerA5_Uninit(void)
+{
+}
+
+void
+TimerSim_Advance(void)
+{
+	for (enum TimerType timer = TIMER_GUI; timer <= TIMER_GAME; timer++) {
+		if (s_timer_started[timer])
+			s_timer_count[timer]++;
+	}
+}
+
+/*--------------------------------------------------------------*/
+
+bool
+Timer_SetTimer(enum TimerType timer, bool set)
+{
+	assert(timer <= TIMER_GAME);
+
+	s_timer_started[timer] = set;
+	return set;
+}
+
+int64_t
+Timer_GetTimer(enum TimerType timer)
+{
+	assert(timer <= TIMER_GAME);
+
+	return s_timer_count[timer];
+}
+
+bool
+Timer_IsStarted(enum TimerType timer)
+{
+	assert(timer <= TIMER_GAME);
+
+	return s_timer_started[timer];
+}
+
+void
+Timer_RegisterSource(void)
+{
+}
+
+void
+Timer_UnregisterSource(void)
+{
+}
+
+enum TimerType
+Timer_WaitForEvent(void)
+{
+	TimerSim_Advance();
+	return TIMER_GAME;
+}
+
+void
+Timer_Sleep(int tics)
+{
+	for (int i = 0; i < tics; i++)
+		TimerSim_Advance();
+}
+
+bool
+Timer_QueueIsEmpty(void)
+{
+	return true;
+}
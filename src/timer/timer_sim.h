@@ -0,0 +1,8 @@
+#ifndef TIMER_TIMERSIM_H
+#define TIMER_TIMERSIM_H
+
+#include "timer.h"
+
+extern void TimerSim_Advance(void);
+
+#endif
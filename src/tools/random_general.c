@@ -24,6 +24,15 @@ Tools_Random_Seed(uint32 seed)
 	s_seed[3] = (seed >> 24) & 0xFF;
 }
 
+/**
+ * @brief   Returns s_seed as passed to Tools_Random_Seed, for checksums.
+ */
+uint32
+Tools_Random_GetState(void)
+{
+	return ((uint32)s_seed[3] << 24) | ((uint32)s_seed[2] << 16) | ((uint32)s_seed[1] << 8) | s_seed[0];
+}
+
 /**
  * @brief   f__2BB4_0004_0027_DC1D.
  * @details Likely to have been hand-written assembly.
@@ -19,6 +19,24 @@ Tools_RandomLCG_Seed(uint16 seed)
 	s_seed = seed;
 }
 
+/**
+ * @brief   Returns the LCG state, for checksums.
+ */
+uint32
+Tools_RandomLCG_GetState(void)
+{
+	return s_seed;
+}
+
+/**
+ * @brief   Restores a state returned by Tools_RandomLCG_GetState, for replays.
+ */
+void
+Tools_RandomLCG_SetState(uint32 state)
+{
+	s_seed = state;
+}
+
 /**
  * @brief   f__01F7_07E5_0011_F68B.
  * @details Exact: int rand(void).
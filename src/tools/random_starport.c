@@ -48,6 +48,25 @@ Random_Starport_GetInitialSeed(void)
 	return s_initialSeed;
 }
 
+/**
+ * @brief   Returns the current starport LCG state, for checksums.
+ */
+uint32
+Random_Starport_GetState(void)
+{
+	return s_seed;
+}
+
+/**
+ * @brief   Sets the current starport LCG state, for world snapshots.
+ */
+void
+Random_Starport_SetState(uint16 initialSeed, uint32 state)
+{
+	s_initialSeed = initialSeed;
+	s_seed = state;
+}
+
 /**
  * @brief   Restores the starport LCG to the initial state.
  * @details @see Tools_RandomLCG_Seed.
@@ -10,6 +10,8 @@
 extern int64_t Random_Starport_GetSeedTime(void);
 extern uint16  Random_Starport_GetSeed(uint16 scenarioID, enum HouseType houseID);
 extern uint16  Random_Starport_GetInitialSeed(void);
+extern uint32  Random_Starport_GetState(void);
+extern void    Random_Starport_SetState(uint16 initialSeed, uint32 state);
 extern void    Random_Starport_Reseed(void);
 extern void    Random_Starport_Seed(uint16 seed);
 extern uint16  Random_Starport_CalculatePrice(uint16 credits);
@@ -22,11 +22,13 @@
 #include "gui/widget.h"
 #include "house.h"
 #include "map.h"
+#include "net/lockstep.h"
 #include "net/net.h"
 #include "net/server.h"
 #include "newui/actionpanel.h"
 #include "newui/menubar.h"
 #include "opendune.h"
+#include "pathfinder.h"
 #include "pool/pool.h"
 #include "pool/pool_house.h"
 #include "pool/pool_structure.h"
@@ -305,6 +307,7 @@ static void Unit_Rotate(Unit *unit, uint16 level)
 	}
 
 	unit->orientation[level].current = newCurrent;
+	UnitPool_MarkDirty(unit);
 
 	if (Orientation_256To16(newCurrent) == Orientation_256To16(current) && Orientation_256To8(newCurrent) == Orientation_256To8(current)) return;
 
@@ -413,7 +416,7 @@ void GameLoop_Unit(void)
 		 * allow them to refresh previously scouted tiles for vision.
 		 */
 		if (enhancement_fog_of_war)
-			Unit_RefreshFog(UNVEILCAUSE_UNIT_VISION, u, ui->flags.isGroundUnit);
+			Unit_RefreshVision(u, ui->flags.isGroundUnit);
 
 		if (tickUnknown4 && u->targetAttack != 0 && ui->o.flags.hasTurret) {
 			tile32 tile;
@@ -533,6 +536,8 @@ void GameLoop_Unit(void)
 						if (!Script_Run(&u->o.script))
 							break;
 					}
+
+					UnitPool_MarkDirty(u);
 				}
 			} else {
 				u->o.script.delay--;
@@ -659,6 +664,7 @@ Unit *Unit_Create(uint16 index, uint8 typeID, uint8 houseID, tile32 position, in
 	u->lastPosition     = position;
 	u->o.position       = position;
 	u->o.hitpoints      = ui->o.hitpoints;
+	UnitPool_GridUpdate(u);
 	u->currentDestination.x = 0;
 	u->currentDestination.y = 0;
 	u->originEncoded    = 0x0000;
@@ -729,6 +735,8 @@ Unit_Server_SetAction(Unit *u, enum UnitActionType action)
 	if (u == NULL) return;
 	if (u->actionID == ACTION_DESTRUCT || u->actionID == ACTION_DIE || action == ACTION_INVALID) return;
 
+	UnitPool_MarkDirty(u);
+
 	/* ENHANCEMENT -- When sandworms are insatiable, change ambush to
 	 * area guard to prevent eating too many units in quick succession.
 	 */
@@ -843,6 +851,7 @@ void Unit_Sort(void)
 		if ((int16)y1 > (int16)y2) {
 			g_unitFindArray[i] = u2;
 			g_unitFindArray[i + 1] = u1;
+			UnitPool_FindOrderChanged();
 		}
 	}
 
@@ -1119,6 +1128,7 @@ bool Unit_SetPosition(Unit *u, tile32 position)
 	u->o.flags.s.isNotOnMap = false;
 
 	u->o.position = Tile_Center(position);
+	UnitPool_GridUpdate(u);
 
 	if (u->originEncoded == 0) Unit_FindClosestRefinery(u);
 
@@ -1134,7 +1144,19 @@ bool Unit_SetPosition(Unit *u, tile32 position)
 	u->targetMove = 0;
 	u->targetAttack = 0;
 
-	if (Map_IsUnveiledToHouse(g_playerHouseID, Tile_PackTile(u->o.position))) {
+	if (Lockstep_IsRunning()) {
+		/* As in Unit_UpdateMap, use each human house's fog rather than
+		 * the local player's.
+		 */
+		const uint16 packed = Tile_PackTile(u->o.position);
+
+		for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+			if (House_IsHuman(h) && Map_IsUnveiledToHouse(h, packed)) {
+				u->o.seenByHouses &= ~(1 << u->o.houseID);
+				Unit_HouseUnitCount_Add(u, h);
+			}
+		}
+	} else if (Map_IsUnveiledToHouse(g_playerHouseID, Tile_PackTile(u->o.position))) {
 		/* A new unit being delivered fresh from the factory; force a seenByHouses
 		 *  update and add it to the statistics etc. */
 		u->o.seenByHouses &= ~(1 << u->o.houseID);
@@ -1208,9 +1230,29 @@ Unit *Unit_FindBestTargetUnit(Unit *u, uint16 mode)
 	distance = g_table_unitInfo[u->o.type].fireDistance << 8;
 	if (mode == 2) distance <<= 1;
 
-	for (Unit *target = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
-			target != NULL;
-			target = Unit_FindNext(&find)) {
+	/* Modes 1 and 2 only consider units within range, so only visit
+	 * those near enough.  The candidates are in the same order as
+	 * Unit_FindNext, so ties are broken identically.
+	 */
+	Unit *candidate[UNIT_INDEX_MAX_RAISED];
+	uint16 count;
+
+	if (mode == 1) {
+		count = Unit_FindInRadius(u->o.position, distance, candidate);
+	} else if (mode == 2) {
+		count = Unit_FindInRadius(position, distance, candidate);
+	} else {
+		count = 0;
+		for (Unit *target = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
+				target != NULL;
+				target = Unit_FindNext(&find)) {
+			candidate[count++] = target;
+		}
+	}
+
+	for (uint16 i = 0; i < count; i++) {
+		Unit *target = candidate[i];
+
 		if (mode != 0 && mode != 4) {
 			if (mode == 1) {
 				if (Tile_GetDistance(u->o.position, target->o.position) > distance) continue;
@@ -1253,6 +1295,13 @@ static uint16 Unit_Sandworm_GetTargetPriority(Unit *unit, Unit *target)
 	if (!g_table_landscapeInfo[Map_GetLandscapeType(packed)].isSand)
 		return 0;
 
+	/* ENHANCEMENT -- Ignore units on sand that the sandworm cannot
+	 * reach, rather than failing to find a route and waiting.
+	 */
+	if (enhancement_astar_pathfinder
+			&& !Pathfinder_IsReachable(MOVEMENT_SLITHER, Tile_PackTile(unit->o.position), packed))
+		return 0;
+
 	/* SINGLE PLAYER -- Sandworms will only target units in scouted
 	 * territory.  Presumably this was done to prevent sandworms
 	 * attacking stationary CPU units, and out-of-sight worm attacks.
@@ -1294,6 +1343,36 @@ Unit *Unit_Sandworm_FindBestTarget(Unit *unit)
 
 	if (unit == NULL) return NULL;
 
+	/* Priority falls with distance: a unit at least r tiles away has
+	 * priority at most 0x1388 * 4 / r.  Search increasingly large
+	 * areas, stopping once the best target found beats anything that
+	 * could lie outside.  Otherwise, fall back to all units.
+	 */
+	static const uint16 radius[] = { 4, 8, 16 };
+	Unit *candidate[UNIT_INDEX_MAX_RAISED];
+
+	for (unsigned int r = 0; r < lengthof(radius); r++) {
+		const uint16 count = Unit_FindInRadius(unit->o.position, radius[r] << 8, candidate);
+
+		best = NULL;
+		bestPriority = 0;
+
+		for (uint16 i = 0; i < count; i++) {
+			const uint16 priority = Unit_Sandworm_GetTargetPriority(unit, candidate[i]);
+
+			if (priority >= bestPriority) {
+				best = candidate[i];
+				bestPriority = priority;
+			}
+		}
+
+		if (bestPriority > 0x1388 * 4 / radius[r])
+			return best;
+	}
+
+	best = NULL;
+	bestPriority = 0;
+
 	for (Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
 			u != NULL;
 			u = Unit_FindNext(&find)) {
@@ -1446,6 +1525,7 @@ bool Unit_Deviation_Decrease(Unit *unit, uint16 amount)
 	}
 
 	if (unit->deviated > amount) {
+		UnitPool_MarkDirty(unit);
 		unit->deviated -= amount;
 		return false;
 	}
@@ -1497,6 +1577,59 @@ Unit_RemoveFog(enum TileUnveilCause cause, const Unit *unit)
 	Unit_RefreshFog(cause, unit, true);
 }
 
+/**
+ * The last vision refresh of a unit.  Refreshing every tick would
+ *  only push the timeouts of the same tiles a little further.
+ */
+typedef struct UnitVision {
+	uint16 packed;                                          /*!< The tile the unit was on. */
+	uint16 radius;                                          /*!< The vision radius. */
+	enum HouseFlag houses;                                  /*!< The houses sharing the vision. */
+	bool unveil;                                            /*!< Whether new tiles were unveiled. */
+	uint32 timeout;                                         /*!< The timeout given to the tiles. */
+} UnitVision;
+
+static UnitVision s_unitVision[UNIT_INDEX_MAX_RAISED];
+
+void
+Unit_ResetVision(void)
+{
+	memset(s_unitVision, 0, sizeof(s_unitVision));
+}
+
+/**
+ * Keep the tiles around a unit visible, as Unit_RefreshFog with
+ *  UNVEILCAUSE_UNIT_VISION.  The tiles are only refreshed when the unit
+ *  has entered another tile, or half of their timeout has passed.
+ */
+void
+Unit_RefreshVision(const Unit *unit, bool unveil)
+{
+	if (unit == NULL) return;
+	if (unit->o.flags.s.isNotOnMap) return;
+	if (unit->o.flags.s.inTransport) return;
+
+	UnitVision *v = &s_unitVision[unit->o.index];
+	const uint32 now = g_timerGame;
+	const uint32 timeout = Map_GetUnveilTimeout(UNVEILCAUSE_UNIT_VISION);
+	const uint16 packed = Tile_PackTile(unit->o.position);
+	const uint16 radius = Unit_GetFogUncoverRadius(unit->o.type, g_table_unitInfo[unit->o.type].o.fogUncoverRadius);
+	const enum HouseFlag houses = House_GetAllies(Unit_GetHouseID(unit));
+
+	if (v->packed == packed && v->radius == radius && v->houses == houses && v->unveil == unveil
+			&& (int32)(v->timeout - now) > (int32)(timeout - now) / 2) {
+		return;
+	}
+
+	v->packed = packed;
+	v->radius = radius;
+	v->houses = houses;
+	v->unveil = unveil;
+	v->timeout = timeout;
+
+	Unit_RefreshFog(UNVEILCAUSE_UNIT_VISION, unit, unveil);
+}
+
 /**
  * Deviate the given unit.
  *
@@ -1716,6 +1849,7 @@ bool Unit_Move(Unit *unit, uint16 distance)
 
 			if (type == LST_WALL || type == LST_STRUCTURE || type == LST_ENTIRELY_MOUNTAIN) {
 				unit->o.position = newPosition;
+				UnitPool_GridUpdate(unit);
 
 				Map_MakeExplosion((ui->explosionType + unit->o.hitpoints / 10) & 3, unit->o.position, unit->o.hitpoints, unit->originEncoded);
 
@@ -1833,6 +1967,7 @@ bool Unit_Move(Unit *unit, uint16 distance)
 
 	unit->distanceToDestination = distance;
 	unit->o.position = newPosition;
+	UnitPool_GridUpdate(unit);
 
 	Unit_UpdateMap(1, unit);
 
@@ -1865,6 +2000,8 @@ bool Unit_Damage(Unit *unit, uint16 damage, uint16 range)
 
 	if (!ui->flags.isNormalUnit && unit->o.type != UNIT_SANDWORM) return false;
 
+	UnitPool_MarkDirty(unit);
+
 	if (unit->o.hitpoints != 0) alive = true;
 
 	if (unit->o.hitpoints >= damage) {
@@ -2010,6 +2147,8 @@ void Unit_SetOrientation(Unit *unit, int8 orientation, bool rotateInstantly, uin
 
 	if (unit == NULL) return;
 
+	UnitPool_MarkDirty(unit);
+
 	unit->orientation[level].speed = 0;
 	unit->orientation[level].target = orientation;
 
@@ -2582,6 +2721,9 @@ void Unit_EnterStructure(Unit *unit, Structure *s)
 
 	if (unit == NULL || s == NULL) return;
 
+	UnitPool_MarkDirty(unit);
+	StructurePool_MarkDirty(s);
+
 	ui = &g_table_unitInfo[unit->o.type];
 	si = &g_table_structureInfo[s->o.type];
 
@@ -2651,7 +2793,10 @@ void Unit_EnterStructure(Unit *unit, Structure *s)
 
 		if (s->o.linkedID != 0xFF) {
 			Unit *u = Unit_Get_ByIndex(s->o.linkedID);
-			if (u != NULL) u->o.houseID = Unit_GetHouseID(unit);
+			if (u != NULL) {
+				u->o.houseID = Unit_GetHouseID(unit);
+				UnitPool_MarkDirty(u);
+			}
 		}
 
 		House_CalculatePowerAndCredit(h);
@@ -2783,7 +2928,6 @@ int16 Unit_GetTileEnterScore(Unit *unit, uint16 packed, uint16 orient8)
 	const UnitInfo *ui;
 	Unit *u;
 	Structure *s;
-	uint16 type;
 	uint16 res;
 
 	if (unit == NULL) return 0;
@@ -2807,15 +2951,13 @@ int16 Unit_GetTileEnterScore(Unit *unit, uint16 packed, uint16 orient8)
 		return -res;
 	}
 
-	type = Map_GetLandscapeType(packed);
-
 	if (g_dune2_enhanced) {
-		res = g_table_landscapeInfo[type].movementSpeed[ui->movementType] * ui->movingSpeedFactor / 256;
+		res = Map_GetMovementSpeed(packed, ui->movementType) * ui->movingSpeedFactor / 256;
 	} else {
-		res = g_table_landscapeInfo[type].movementSpeed[ui->movementType];
+		res = Map_GetMovementSpeed(packed, ui->movementType);
 	}
 
-	if (unit->o.type == UNIT_SABOTEUR && type == LST_WALL) {
+	if (unit->o.type == UNIT_SABOTEUR && Map_GetLandscapeType(packed) == LST_WALL) {
 		if (!House_AreAllied(g_map[packed].houseID, Unit_GetHouseID(unit))) res = 255;
 	}
 
@@ -2918,7 +3060,11 @@ void Unit_UpdateMap(uint16 type, Unit *unit)
 	Tile *t;
 	uint16 radius;
 
-	if (unit == NULL || unit->o.flags.s.isNotOnMap || !unit->o.flags.s.used) return;
+	if (unit == NULL) return;
+
+	UnitPool_MarkDirty(unit);
+
+	if (unit->o.flags.s.isNotOnMap || !unit->o.flags.s.used) return;
 
 	ui = &g_table_unitInfo[unit->o.type];
 
@@ -2930,13 +3076,42 @@ void Unit_UpdateMap(uint16 type, Unit *unit)
 	position = unit->o.position;
 	packed = Tile_PackTile(position);
 	t = &g_map[packed];
+	Map_MarkDirty(packed);
+
+	if (Lockstep_IsRunning()) {
+		/* Every peer runs this, so use each human house's fog rather
+		 * than the local player's view of the map.
+		 */
+		bool seen = false;
 
-	if ((g_mapVisible[packed].fogOverlayBits != 0xF) || (unit->o.houseID == g_playerHouseID)) {
+		for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+			if (!House_IsHuman(h))
+				continue;
+
+			if (unit->o.houseID == h || Map_IsUnveiledToHouse(h, packed)) {
+				Unit_HouseUnitCount_Add(unit, h);
+				seen = true;
+			}
+		}
+
+		if (!seen)
+			Unit_HouseUnitCount_Remove(unit);
+	} else if ((g_mapVisible[packed].fogOverlayBits != 0xF) || (unit->o.houseID == g_playerHouseID)) {
 		Unit_HouseUnitCount_Add(unit, g_playerHouseID);
 	} else {
 		Unit_HouseUnitCount_Remove(unit);
 	}
 
+	/* Units keeping still no longer refresh their vision every tick,
+	 * so let houses that can see the tile notice the unit entering.
+	 */
+	if (type == 1 && enhancement_fog_of_war) {
+		for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+			if (House_IsHuman(h) && Map_IsUnveiledToHouse(h, packed) && !Map_HasFogTimedOut(h, packed))
+				Unit_HouseUnitCount_Add(unit, h);
+		}
+	}
+
 	if (type == 1) {
 		if (unit->o.type != UNIT_SANDWORM) {
 			Tile_RemoveFogInRadius(House_GetAllies(Unit_GetHouseID(unit)),
@@ -2973,6 +3148,7 @@ void Unit_RemoveFromTile(Unit *unit, uint16 packed)
 	Tile *t = &g_map[packed];
 
 	if (t->hasUnit && Unit_Get_ByPackedTile(packed) == unit && (packed != Tile_PackTile(unit->currentDestination) || unit->o.flags.s.bulletIsBig)) {
+		Map_MarkDirty(packed);
 		t->index = 0;
 		t->hasUnit = false;
 	}
@@ -3190,7 +3366,7 @@ Unit_Client_HouseUnitCount_Add(Unit *unit, enum HouseType houseID)
 void
 Unit_HouseUnitCount_Add(Unit *unit, uint8 houseID)
 {
-	if (g_host_type != HOSTTYPE_DEDICATED_CLIENT) {
+	if (g_host_type != HOSTTYPE_DEDICATED_CLIENT || Lockstep_IsRunning()) {
 		Unit_Server_HouseUnitCount_Add(unit, houseID);
 	} else {
 		Unit_Client_HouseUnitCount_Add(unit, houseID);
@@ -166,6 +166,8 @@ extern void Unit_SetTarget(Unit* unit, uint16 encoded);
 extern bool Unit_Deviation_Decrease(Unit* unit, uint16 amount);
 extern void Unit_RefreshFog(enum TileUnveilCause cause, const Unit *u, bool unveil);
 extern void Unit_RemoveFog(enum TileUnveilCause cause, const Unit *u);
+extern void Unit_ResetVision(void);
+extern void Unit_RefreshVision(const Unit *u, bool unveil);
 extern bool Unit_Deviate(Unit *unit, uint16 probability, uint8 houseID);
 extern bool Unit_Move(Unit *unit, uint16 distance);
 extern bool Unit_Damage(Unit *unit, uint16 damage, uint16 range);
@@ -52,6 +52,9 @@
 #include "../map.h"
 #include "../newui/viewport.h"
 #include "../opendune.h"
+#include "../pool/pool.h"
+#include "../pool/pool_unit.h"
+#include "../profile.h"
 #include "../scenario.h"
 #include "../sprites.h"
 #include "../structure.h"
@@ -177,9 +180,12 @@ static ALLEGRO_MOUSE_CURSOR *s_cursor[CURSOR_MAX];
 
 static ALLEGRO_BITMAP *s_minimap;
 static int s_minimap_colour[MAP_SIZE_MAX * MAP_SIZE_MAX];
+static MapJournalCursor s_minimap_cursor;
+static int s_minimap_key = -1;            /* Draw mode and settings the colours were computed for. */
 
 static bool take_screenshot = false;
 static bool show_fps = false;
+static bool show_profile = false;
 static FadeInAux s_fadeInAux;
 
 /* VideoA5_GetNextXY:
@@ -534,6 +540,13 @@ VideoA5_ToggleFPS(void)
 	show_fps = !show_fps;
 }
 
+void
+VideoA5_ToggleProfile(void)
+{
+	show_profile = !show_profile;
+	Profile_Enable(show_profile);
+}
+
 void
 VideoA5_CaptureScreenshot(void)
 {
@@ -621,6 +634,16 @@ VideoA5_CreateWhiteMaskIndexed(unsigned char *buf,
 	}
 }
 
+static void
+VideoA5_DrawDebugText(int x, int y, const char *str)
+{
+	/* Don't clobber the current font state. */
+	for (int i = 0; str[i] != '\0'; i++) {
+		const unsigned char c = str[i];
+		al_draw_tinted_bitmap(s_font[2][c], paltoRGB[15], x + 6 * i, y, 0);
+	}
+}
+
 void
 VideoA5_Tick(void)
 {
@@ -653,12 +676,8 @@ VideoA5_Tick(void)
 		const double curr_time = al_get_time();
 		char str[16];
 
-		/* Don't clobber the current font state. */
-		int len = snprintf(str, sizeof(str), "FPS:%4.2f", l_last_fps);
-		for (int i = 0; i < len; i++) {
-			const unsigned char c = str[i];
-			al_draw_tinted_bitmap(s_font[2][c], paltoRGB[15], 2 + 6 * i, 40, 0);
-		}
+		snprintf(str, sizeof(str), "FPS:%4.2f", l_last_fps);
+		VideoA5_DrawDebugText(2, 40, str);
 
 		l_fps++;
 		if (curr_time - l_last_time >= 0.5f) {
@@ -668,6 +687,21 @@ VideoA5_Tick(void)
 		}
 	}
 
+	if (show_profile) {
+		char str[40];
+
+		/* Mean and 99th percentile of recent samples, in milliseconds. */
+		VideoA5_DrawDebugText(2, 52, "phase       mean    p99");
+		for (enum ProfilePhase phase = 0; phase < PROFILE_MAX; phase++) {
+			double mean, p99;
+
+			Profile_GetStats(phase, &mean, &p99);
+			snprintf(str, sizeof(str), "%-9s %6.2f %6.2f",
+					Profile_GetPhaseName(phase), 1000.0 * mean, 1000.0 * p99);
+			VideoA5_DrawDebugText(2, 62 + 10 * phase, str);
+		}
+	}
+
 	/* Draw software mouse cursor for people who have trouble with hardware cursors. */
 	if (!g_gameConfig.hardwareCursor && !g_mouseHidden) {
 		const int size = (TRUE_DISPLAY_WIDTH >= 640) ? 32 : 16;
@@ -2746,6 +2780,44 @@ VideoA5_DrawWSAStatic(int frame, int x, int y)
 
 /*--------------------------------------------------------------*/
 
+static int
+VideoA5_GetMinimapColour(uint16 packed, enum MinimapDrawMode mode)
+{
+	const Tile *t = &g_map[packed];
+	int colour = 12;
+
+	if (mode == 1) {
+		uint16 type = Map_GetLandscapeTypeOriginal(packed);
+		colour = g_table_landscapeInfo[type].radarColour;
+	} else if (g_playerHouse->flags.radarActivated
+			&& Map_IsUnveiledToHouse(g_playerHouseID, packed)) {
+		Unit *u;
+
+		if (enhancement_fog_of_war && Map_HasFogTimedOut(g_playerHouseID, packed)) {
+		} else if (t->hasUnit && ((u = Unit_Get_ByPackedTile(packed)) != NULL)) {
+			/* Sandworms are drawn separately because they glow. */
+			if (u->o.type != UNIT_SANDWORM)
+				colour = g_table_houseInfo[Unit_GetHouseID(u)].minimapColor;
+		}
+
+		if (colour == 12) {
+			uint16 type = Map_GetLandscapeTypeVisible(packed);
+
+			if (g_table_landscapeInfo[type].radarColour == 0xFFFF) {
+				colour = g_table_houseInfo[t->houseID].minimapColor;
+			} else if (enhancement_fog_of_war && Map_HasFogTimedOut(g_playerHouseID, packed)) {
+				colour = -g_table_landscapeInfo[type].radarColour;
+			} else {
+				colour = g_table_landscapeInfo[type].radarColour;
+			}
+		}
+	} else if (t->hasStructure && t->houseID == g_playerHouseID) {
+		colour = g_table_houseInfo[t->houseID].minimapColor;
+	}
+
+	return colour;
+}
+
 void
 Video_DrawMinimap(int left, int top, int map_scale, enum MinimapDrawMode mode)
 {
@@ -2760,54 +2832,63 @@ Video_DrawMinimap(int left, int top, int map_scale, enum MinimapDrawMode mode)
 		return;
 	}
 
-	for (int y = 0; y < mapInfo->sizeY; y++) {
-		uint16 packed = Tile_PackXY(mapInfo->minX, mapInfo->minY + y);
-		int i = mapInfo->sizeX * y;
+	/* Only tiles in the journal need their colour recomputed, unless
+	 * something affecting every tile has changed.
+	 */
+	const int key = (mode << 0)
+		| (map_scale << 2)
+		| (g_playerHouse->flags.radarActivated << 4)
+		| (enhancement_fog_of_war << 5)
+		| (g_playerHouseID << 6);
 
-		for (int x = 0; x < mapInfo->sizeX; x++, i++, packed++) {
-			const Tile *t = &g_map[packed];
-			int colour = 12;
+	if (s_minimap_key != key) {
+		s_minimap_key = key;
+		Map_Journal_ResetCursor(&s_minimap_cursor);
+	}
 
-			if (mode == 1) {
-				uint16 type = Map_GetLandscapeTypeOriginal(packed);
-				colour = g_table_landscapeInfo[type].radarColour;
-			} else if (g_playerHouse->flags.radarActivated
-					&& Map_IsUnveiledToHouse(g_playerHouseID, packed)) {
-				Unit *u;
-
-				if (enhancement_fog_of_war && g_mapVisible[packed].timeout[g_playerHouseID] <= g_timerGame) {
-				} else if (t->hasUnit && ((u = Unit_Get_ByPackedTile(packed)) != NULL)) {
-					if (u->o.type == UNIT_SANDWORM) {
-						/* Really shouldn't have more than 3, but anyway. */
-						if (num_sandworms < 4) {
-							sandworm_position[2*num_sandworms + 0] = x;
-							sandworm_position[2*num_sandworms + 1] = y;
-							num_sandworms++;
-						}
-					} else {
-						colour = g_table_houseInfo[Unit_GetHouseID(u)].minimapColor;
-					}
-				}
+	uint16 packed;
+	while ((packed = Map_Journal_Next(&s_minimap_cursor)) != MAP_JOURNAL_END) {
+		const int x = Tile_GetPackedX(packed) - mapInfo->minX;
+		const int y = Tile_GetPackedY(packed) - mapInfo->minY;
 
-				if (colour == 12) {
-					uint16 type = Map_GetLandscapeTypeVisible(packed);
+		if (!(0 <= x && x < mapInfo->sizeX && 0 <= y && y < mapInfo->sizeY))
+			continue;
 
-					if (g_table_landscapeInfo[type].radarColour == 0xFFFF) {
-						colour = g_table_houseInfo[t->houseID].minimapColor;
-					} else if (enhancement_fog_of_war && g_mapVisible[packed].timeout[g_playerHouseID] <= g_timerGame) {
-						colour = -g_table_landscapeInfo[type].radarColour;
-					} else {
-						colour = g_table_landscapeInfo[type].radarColour;
-					}
-				}
-			} else if (t->hasStructure && t->houseID == g_playerHouseID) {
-				colour = g_table_houseInfo[t->houseID].minimapColor;
-			}
+		const int i = mapInfo->sizeX * y + x;
+		const int colour = VideoA5_GetMinimapColour(packed, mode);
 
-			if (s_minimap_colour[i] != colour) {
-				s_minimap_colour[i] = colour;
-				redraw = true;
-			}
+		if (s_minimap_colour[i] != colour) {
+			s_minimap_colour[i] = colour;
+			redraw = true;
+		}
+	}
+
+	if (mode != 1 && g_playerHouse->flags.radarActivated) {
+		PoolFindStruct find;
+
+		for (const Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_SANDWORM);
+				u != NULL && num_sandworms < 4;
+				u = Unit_FindNext(&find)) {
+			if (u->o.flags.s.isNotOnMap)
+				continue;
+
+			packed = Tile_PackTile(u->o.position);
+			const int x = Tile_GetPackedX(packed) - mapInfo->minX;
+			const int y = Tile_GetPackedY(packed) - mapInfo->minY;
+
+			if (!(0 <= x && x < mapInfo->sizeX && 0 <= y && y < mapInfo->sizeY))
+				continue;
+
+			if (!g_map[packed].hasUnit || Unit_Get_ByPackedTile(packed) != u)
+				continue;
+
+			if (!Map_IsUnveiledToHouse(g_playerHouseID, packed)
+					|| (enhancement_fog_of_war && Map_HasFogTimedOut(g_playerHouseID, packed)))
+				continue;
+
+			sandworm_position[2*num_sandworms + 0] = x;
+			sandworm_position[2*num_sandworms + 1] = y;
+			num_sandworms++;
 		}
 	}
 
@@ -3032,6 +3113,7 @@ VideoA5_DisplayFound(void)
 	scratch = NULL;
 
 	memset(s_minimap_colour, 0, sizeof(s_minimap_colour));
+	s_minimap_key = -1;
 }
 
 int
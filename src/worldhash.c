@@ -0,0 +1,351 @@
+/**
+ * @file src/worldhash.c
+ *
+ * Checksum of the simulation state, for detecting when peers diverge
+ * and for checking that optimisations do not change the simulation.
+ * The checksum covers the unit, structure, house and team pools, the
+ * map, and the random number generators.
+ */
+
+#include <string.h>
+
+#include "worldhash.h"
+
+#include "house.h"
+#include "map.h"
+#include "os/common.h"
+#include "os/math.h"
+#include "pool/pool.h"
+#include "pool/pool_house.h"
+#include "pool/pool_structure.h"
+#include "pool/pool_team.h"
+#include "pool/pool_unit.h"
+#include "structure.h"
+#include "team.h"
+#include "timer/timer.h"
+#include "tools/random_general.h"
+#include "tools/random_lcg.h"
+#include "tools/random_starport.h"
+#include "unit.h"
+
+static struct {
+	uint32 tick;
+	uint32 hash;
+} s_history[WORLDHASH_HISTORY];
+
+static int s_historyCount;
+static int64_t s_scenarioStart = -1;
+static uint32 s_nextTick;
+
+/*--------------------------------------------------------------*/
+
+/* FNV-1a, a word at a time. */
+static uint32
+WorldHash_Add(uint32 hash, uint32 value)
+{
+	return (hash ^ value) * 0x01000193;
+}
+
+static uint32
+WorldHash_AddBuildQueue(uint32 hash, const BuildQueue *queue)
+{
+	for (const BuildQueueItem *item = queue->first; item != NULL; item = item->next) {
+		hash = WorldHash_Add(hash, item->objectType);
+		hash = WorldHash_Add(hash, item->credits);
+	}
+
+	return hash;
+}
+
+static uint32
+WorldHash_AddScriptEngine(uint32 hash, const ScriptEngine *script)
+{
+	const uint32 offset
+		= (script->script != NULL && script->scriptInfo != NULL)
+		? (uint32)(script->script - script->scriptInfo->start) : 0xFFFFFFFF;
+
+	hash = WorldHash_Add(hash, offset);
+	hash = WorldHash_Add(hash, script->delay);
+	hash = WorldHash_Add(hash, script->returnValue);
+	hash = WorldHash_Add(hash, script->framePointer);
+	hash = WorldHash_Add(hash, script->stackPointer);
+	hash = WorldHash_Add(hash, script->isSubroutine);
+
+	for (unsigned int i = 0; i < lengthof(script->variables); i++)
+		hash = WorldHash_Add(hash, script->variables[i]);
+
+	for (unsigned int i = 0; i < lengthof(script->stack); i++)
+		hash = WorldHash_Add(hash, script->stack[i]);
+
+	return hash;
+}
+
+static uint32
+WorldHash_AddObject(uint32 hash, const Object *o)
+{
+	hash = WorldHash_Add(hash, o->index);
+	hash = WorldHash_Add(hash, o->type);
+	hash = WorldHash_Add(hash, o->linkedID);
+	hash = WorldHash_Add(hash, o->flags.all);
+	hash = WorldHash_Add(hash, o->houseID);
+	hash = WorldHash_Add(hash, o->seenByHouses);
+	hash = WorldHash_Add(hash, (o->position.x << 16) | o->position.y);
+	hash = WorldHash_Add(hash, o->hitpoints);
+
+	return WorldHash_AddScriptEngine(hash, &o->script);
+}
+
+static uint32
+WorldHash_Unit(const Unit *u)
+{
+	uint32 hash = WorldHash_AddObject(0x811C9DC5, &u->o);
+
+	hash = WorldHash_Add(hash, (u->currentDestination.x << 16) | u->currentDestination.y);
+	hash = WorldHash_Add(hash, u->originEncoded);
+	hash = WorldHash_Add(hash, u->actionID);
+	hash = WorldHash_Add(hash, u->nextActionID);
+	hash = WorldHash_Add(hash, u->fireDelay);
+	hash = WorldHash_Add(hash, u->distanceToDestination);
+	hash = WorldHash_Add(hash, u->targetAttack);
+	hash = WorldHash_Add(hash, u->targetMove);
+	hash = WorldHash_Add(hash, u->amount);
+	hash = WorldHash_Add(hash, u->deviated);
+	hash = WorldHash_Add(hash, u->deviatedHouse);
+	hash = WorldHash_Add(hash, (u->targetLast.x << 16) | u->targetLast.y);
+	hash = WorldHash_Add(hash, (u->targetPreLast.x << 16) | u->targetPreLast.y);
+
+	for (int i = 0; i < 2; i++) {
+		hash = WorldHash_Add(hash, (uint8)u->orientation[i].speed);
+		hash = WorldHash_Add(hash, (uint8)u->orientation[i].target);
+		hash = WorldHash_Add(hash, (uint8)u->orientation[i].current);
+	}
+
+	hash = WorldHash_Add(hash, u->speedPerTick);
+	hash = WorldHash_Add(hash, u->speedRemainder);
+	hash = WorldHash_Add(hash, u->speed);
+	hash = WorldHash_Add(hash, u->movingSpeed);
+	hash = WorldHash_Add(hash, u->wobbleIndex);
+	hash = WorldHash_Add(hash, (uint8)u->spriteOffset);
+	hash = WorldHash_Add(hash, u->blinkCounter);
+	hash = WorldHash_Add(hash, u->team);
+	hash = WorldHash_Add(hash, u->timer);
+
+	for (unsigned int i = 0; i < lengthof(u->route); i++)
+		hash = WorldHash_Add(hash, u->route[i]);
+
+	hash = WorldHash_Add(hash, (u->lastPosition.x << 16) | u->lastPosition.y);
+	hash = WorldHash_Add(hash, u->permanentFollow);
+	hash = WorldHash_Add(hash, u->detonateAtTarget);
+	hash = WorldHash_Add(hash, u->deviationDecremented);
+	hash = WorldHash_Add(hash, u->squadID);
+	hash = WorldHash_Add(hash, u->aiSquad);
+
+	return hash;
+}
+
+static uint32
+WorldHash_Structure(const Structure *s)
+{
+	uint32 hash = WorldHash_AddObject(0x811C9DC5, &s->o);
+
+	hash = WorldHash_Add(hash, s->creatorHouseID);
+	hash = WorldHash_Add(hash, s->rotationSpriteDiff);
+	hash = WorldHash_Add(hash, s->objectType);
+	hash = WorldHash_Add(hash, s->upgradeLevel);
+	hash = WorldHash_Add(hash, s->upgradeTimeLeft);
+	hash = WorldHash_Add(hash, s->countDown);
+	hash = WorldHash_Add(hash, s->buildCostRemainder);
+	hash = WorldHash_Add(hash, (uint16)s->state);
+	hash = WorldHash_Add(hash, s->hitpointsMax);
+	hash = WorldHash_Add(hash, s->squadID);
+	hash = WorldHash_Add(hash, s->rallyPoint);
+	hash = WorldHash_Add(hash, s->factoryOffsetY);
+
+	return WorldHash_AddBuildQueue(hash, &s->queue);
+}
+
+/* unitCountEnemy, unitCountAllied and flags.radarActivated are only
+ * kept for the local player's sidebar, so they differ between peers.
+ */
+static uint32
+WorldHash_House(const House *h)
+{
+	uint32 hash = 0x811C9DC5;
+
+	hash = WorldHash_Add(hash, h->index);
+	hash = WorldHash_Add(hash, h->harvestersIncoming);
+	hash = WorldHash_Add(hash, h->flags.used);
+	hash = WorldHash_Add(hash, h->flags.human);
+	hash = WorldHash_Add(hash, h->flags.doneFullScaleAttack);
+	hash = WorldHash_Add(hash, h->flags.isAIActive);
+	hash = WorldHash_Add(hash, h->unitCount);
+	hash = WorldHash_Add(hash, h->unitCountMax);
+	hash = WorldHash_Add(hash, h->structuresBuilt);
+	hash = WorldHash_Add(hash, h->credits);
+	hash = WorldHash_Add(hash, h->creditsStorage);
+	hash = WorldHash_Add(hash, h->powerProduction);
+	hash = WorldHash_Add(hash, h->powerUsage);
+	hash = WorldHash_Add(hash, h->windtrapCount);
+	hash = WorldHash_Add(hash, h->creditsQuota);
+	hash = WorldHash_Add(hash, (h->palacePosition.x << 16) | h->palacePosition.y);
+	hash = WorldHash_Add(hash, h->timerUnitAttack);
+	hash = WorldHash_Add(hash, h->timerSandwormAttack);
+	hash = WorldHash_Add(hash, h->timerStructureAttack);
+	hash = WorldHash_Add(hash, h->starportTimeLeft);
+	hash = WorldHash_Add(hash, h->starportLinkedID);
+
+	for (int i = 0; i < 5; i++) {
+		hash = WorldHash_Add(hash, h->ai_structureRebuild[i][0]);
+		hash = WorldHash_Add(hash, h->ai_structureRebuild[i][1]);
+	}
+
+	hash = WorldHash_Add(hash, h->creditsStorageNoSilo);
+	hash = WorldHash_Add(hash, h->constructionYardPosition);
+	hash = WorldHash_Add(hash, h->structureActiveID);
+	hash = WorldHash_Add(hash, h->starportID);
+	hash = WorldHash_Add(hash, h->houseMissileID);
+	hash = WorldHash_Add(hash, h->houseMissileCountdown);
+
+	for (unsigned int i = 0; i < lengthof(h->starportCount); i++)
+		hash = WorldHash_Add(hash, h->starportCount[i]);
+
+	return WorldHash_AddBuildQueue(hash, &h->starportQueue);
+}
+
+static uint32
+WorldHash_Team(const Team *t)
+{
+	uint32 hash = 0x811C9DC5;
+	uint32 flags = 0;
+
+	memcpy(&flags, &t->flags, min(sizeof(flags), sizeof(t->flags)));
+
+	hash = WorldHash_Add(hash, t->index);
+	hash = WorldHash_Add(hash, flags);
+	hash = WorldHash_Add(hash, t->members);
+	hash = WorldHash_Add(hash, t->minMembers);
+	hash = WorldHash_Add(hash, t->maxMembers);
+	hash = WorldHash_Add(hash, t->movementType);
+	hash = WorldHash_Add(hash, t->action);
+	hash = WorldHash_Add(hash, t->actionStart);
+	hash = WorldHash_Add(hash, t->houseID);
+	hash = WorldHash_Add(hash, (t->position.x << 16) | t->position.y);
+	hash = WorldHash_Add(hash, t->targetTile);
+	hash = WorldHash_Add(hash, t->target);
+
+	return WorldHash_AddScriptEngine(hash, &t->script);
+}
+
+/**
+ * Computes the checksum of the current simulation state.  Objects are
+ *  combined by addition so that the order of the pools' find arrays,
+ *  which are sorted for drawing, does not matter.
+ */
+uint32
+WorldHash_Compute(void)
+{
+	PoolFindStruct find;
+	uint32 objects = 0;
+	uint32 hash = 0x811C9DC5;
+
+	for (const Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
+			u != NULL;
+			u = Unit_FindNext(&find)) {
+		objects += WorldHash_Unit(u);
+	}
+
+	for (const Structure *s = Structure_FindFirst(&find, HOUSE_INVALID, STRUCTURE_INVALID);
+			s != NULL;
+			s = Structure_FindNext(&find)) {
+		objects += WorldHash_Structure(s);
+	}
+
+	for (const House *h = House_FindFirst(&find, HOUSE_INVALID);
+			h != NULL;
+			h = House_FindNext(&find)) {
+		objects += WorldHash_House(h);
+	}
+
+	for (const Team *t = Team_FindFirst(&find, HOUSE_INVALID);
+			t != NULL;
+			t = Team_FindNext(&find)) {
+		objects += WorldHash_Team(t);
+	}
+
+	hash = WorldHash_Add(hash, objects);
+
+	for (int packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++) {
+		uint32 tile;
+
+		memcpy(&tile, &g_map[packed], sizeof(tile));
+		hash = WorldHash_Add(hash, tile);
+	}
+
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_MAX; h++) {
+		for (int y = 0; y < MAP_SIZE_MAX; y++) {
+			const uint64_t row = g_mapFog[h].isUnveiled[y];
+
+			hash = WorldHash_Add(hash, (uint32)row);
+			hash = WorldHash_Add(hash, (uint32)(row >> 32));
+		}
+	}
+
+	hash = WorldHash_Add(hash, Tools_Random_GetState());
+	hash = WorldHash_Add(hash, Tools_RandomLCG_GetState());
+	hash = WorldHash_Add(hash, Random_Starport_GetState());
+
+	return hash;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+ * Records the checksum every WORLDHASH_INTERVAL ticks of the scenario.
+ *  Called after each tick of the game logic.
+ */
+void
+WorldHash_Tick(void)
+{
+	if (s_scenarioStart != g_tickScenarioStart) {
+		s_scenarioStart = g_tickScenarioStart;
+		s_historyCount = 0;
+		s_nextTick = WORLDHASH_INTERVAL;
+	}
+
+	const int64_t tick = g_timerGame - g_tickScenarioStart;
+	if (tick < s_nextTick)
+		return;
+
+	const int i = s_historyCount % WORLDHASH_HISTORY;
+
+	s_history[i].tick = tick;
+	s_history[i].hash = WorldHash_Compute();
+	s_historyCount++;
+	s_nextTick = tick - (tick % WORLDHASH_INTERVAL) + WORLDHASH_INTERVAL;
+}
+
+bool
+WorldHash_Get(uint32 tick, uint32 *hash)
+{
+	for (int i = 0; i < WORLDHASH_HISTORY && i < s_historyCount; i++) {
+		if (s_history[i].tick == tick) {
+			*hash = s_history[i].hash;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool
+WorldHash_GetLatest(uint32 *tick, uint32 *hash)
+{
+	if (s_historyCount <= 0)
+		return false;
+
+	const int i = (s_historyCount - 1) % WORLDHASH_HISTORY;
+
+	*tick = s_history[i].tick;
+	*hash = s_history[i].hash;
+	return true;
+}
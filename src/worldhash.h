@@ -0,0 +1,17 @@
+#ifndef WORLDHASH_H
+#define WORLDHASH_H
+
+#include <stdbool.h>
+#include "types.h"
+
+enum {
+	WORLDHASH_INTERVAL = 60,        /* Ticks between checksums. */
+	WORLDHASH_HISTORY = 8           /* Checksums kept for comparison with other peers. */
+};
+
+extern uint32 WorldHash_Compute(void);
+extern void WorldHash_Tick(void);
+extern bool WorldHash_Get(uint32 tick, uint32 *hash);
+extern bool WorldHash_GetLatest(uint32 *tick, uint32 *hash);
+
+#endif